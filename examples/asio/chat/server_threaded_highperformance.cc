@@ -59,7 +59,7 @@ class ChatServer : noncopyable
                        const string& message,
                        Timestamp)
   {
-    EventLoop::Functor f = std::bind(&ChatServer::distributeMessage, this, message);
+    auto f = std::bind(&ChatServer::distributeMessage, this, message);
     LOG_DEBUG;
 
     MutexLockGuard lock(mutex_);
@@ -0,0 +1,87 @@
+#include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/TcpClient.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Download client for comparing download3 and download4:
+// starts N concurrent downloads, discards the data, and reports
+// the aggregate throughput once every connection has been closed.
+
+class Bench : noncopyable
+{
+ public:
+  Bench(EventLoop* loop, const InetAddress& serverAddr, int connections)
+    : loop_(loop),
+      remaining_(connections),
+      bytes_(0)
+  {
+    for (int i = 0; i < connections; ++i)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "download%d", i);
+      TcpClient* client = new TcpClient(loop, serverAddr, name);
+      client->setConnectionCallback(
+          std::bind(&Bench::onConnection, this, _1));
+      client->setMessageCallback(
+          std::bind(&Bench::onMessage, this, _1, _2, _3));
+      clients_.emplace_back(client);
+    }
+  }
+
+  void start()
+  {
+    start_ = Timestamp::now();
+    for (auto& client : clients_)
+    {
+      client->connect();
+    }
+  }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (!conn->connected() && --remaining_ == 0)
+    {
+      double seconds = timeDifference(Timestamp::now(), start_);
+      printf("%zd connections, %.3f seconds, %.2f MiB, %.2f MiB/s\n",
+             clients_.size(), seconds, static_cast<double>(bytes_) / 1024 / 1024,
+             static_cast<double>(bytes_) / 1024 / 1024 / seconds);
+      loop_->queueInLoop(std::bind(&EventLoop::quit, loop_));
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+  {
+    bytes_ += buf->readableBytes();
+    buf->retrieveAll();
+  }
+
+  EventLoop* loop_;
+  std::vector<std::unique_ptr<TcpClient>> clients_;
+  int remaining_;
+  int64_t bytes_;
+  Timestamp start_;
+};
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    fprintf(stderr, "Usage: %s <host_ip> <connections>\n", argv[0]);
+    return 1;
+  }
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  InetAddress serverAddr(argv[1], 2021);
+  Bench bench(&loop, serverAddr, atoi(argv[2]));
+  bench.start();
+  loop.loop();
+}
@@ -7,6 +7,8 @@
 #include <muduo/net/EventLoop.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -80,8 +82,9 @@ int main(int argc, char* argv[])
   numPipes = 100;
   numActive = 1;
   numWrites = 100;
+  const char* poller = NULL;
   int c;
-  while ((c = getopt(argc, argv, "n:a:w:")) != -1)
+  while ((c = getopt(argc, argv, "n:a:w:p:")) != -1)
   {
     switch (c)
     {
@@ -94,6 +97,9 @@ int main(int argc, char* argv[])
       case 'w':
         numWrites = atoi(optarg);
         break;
+      case 'p':
+        poller = optarg;
+        break;
       default:
         fprintf(stderr, "Illegal argument \"%c\"\n", c);
         return 1;
@@ -117,6 +123,16 @@ int main(int argc, char* argv[])
     }
   }
 
+  // -p epoll|poll|iouring, see Poller::newDefaultPoller()
+  if (poller && strcmp(poller, "poll") == 0)
+  {
+    ::setenv("MUDUO_USE_POLL", "1", 1);
+  }
+  else if (poller && strcmp(poller, "iouring") == 0)
+  {
+    ::setenv("MUDUO_USE_IOURING", "1", 1);
+  }
+
   EventLoop loop;
   g_loop = &loop;
 
@@ -82,18 +82,27 @@ class Client : noncopyable
          int blockSize,
          int sessionCount,
          int timeout,
-         int threadCount)
+         int threadCount,
+         int busyPollUs)
     : loop_(loop),
       threadPool_(loop, "pingpong-client"),
       sessionCount_(sessionCount),
-      timeout_(timeout)
+      timeout_(timeout),
+      busyPollUs_(busyPollUs)
   {
     loop->runAfter(timeout, std::bind(&Client::handleTimeout, this));
     if (threadCount > 1)
     {
       threadPool_.setThreadNum(threadCount);
     }
-    threadPool_.start();
+    if (busyPollUs > 0)
+    {
+      threadPool_.start(std::bind(&EventLoop::setBusyPoll, _1, busyPollUs));
+    }
+    else
+    {
+      threadPool_.start();
+    }
 
     for (int i = 0; i < blockSize; ++i)
     {
@@ -115,6 +124,11 @@ class Client : noncopyable
     return message_;
   }
 
+  int busyPollUs() const
+  {
+    return busyPollUs_;
+  }
+
   void onConnect()
   {
     if (numConnected_.incrementAndGet() == sessionCount_)
@@ -142,6 +156,15 @@ class Client : noncopyable
                << " average message size";
       LOG_WARN << static_cast<double>(totalBytesRead) / (timeout_ * 1024 * 1024)
                << " MiB/s throughput";
+      // every session has one message in flight
+      LOG_WARN << static_cast<double>(timeout_) * 1e6 * sessionCount_
+                  / static_cast<double>(totalMessagesRead)
+               << " us average round trip";
+      for (EventLoop* loop : threadPool_.getAllLoops())
+      {
+        LOG_WARN << "loop " << loop << " spin " << loop->spinMicroSeconds() / 1000
+                 << " ms, block " << loop->blockMicroSeconds() / 1000 << " ms";
+      }
       conn->getLoop()->queueInLoop(std::bind(&Client::quit, this));
     }
   }
@@ -166,6 +189,7 @@ class Client : noncopyable
   EventLoopThreadPool threadPool_;
   int sessionCount_;
   int timeout_;
+  int busyPollUs_;
   std::vector<std::unique_ptr<Session>> sessions_;
   string message_;
   AtomicInt32 numConnected_;
@@ -176,6 +200,10 @@ void Session::onConnection(const TcpConnectionPtr& conn)
   if (conn->connected())
   {
     conn->setTcpNoDelay(true);
+    if (owner_->busyPollUs() > 0)
+    {
+      conn->setBusyPoll(owner_->busyPollUs());
+    }
     conn->send(owner_->message());
     owner_->onConnect();
   }
@@ -187,10 +215,10 @@ void Session::onConnection(const TcpConnectionPtr& conn)
 
 int main(int argc, char* argv[])
 {
-  if (argc != 7)
+  if (argc != 7 && argc != 8)
   {
     fprintf(stderr, "Usage: client <host_ip> <port> <threads> <blocksize> ");
-    fprintf(stderr, "<sessions> <time>\n");
+    fprintf(stderr, "<sessions> <time> [busy_poll_us]\n");
   }
   else
   {
@@ -203,11 +231,12 @@ int main(int argc, char* argv[])
     int blockSize = atoi(argv[4]);
     int sessionCount = atoi(argv[5]);
     int timeout = atoi(argv[6]);
+    int busyPollUs = argc > 7 ? atoi(argv[7]) : 0;
 
     EventLoop loop;
     InetAddress serverAddr(ip, port);
 
-    Client client(&loop, serverAddr, blockSize, sessionCount, timeout, threadCount);
+    Client client(&loop, serverAddr, blockSize, sessionCount, timeout, threadCount, busyPollUs);
     loop.loop();
   }
 }
@@ -14,14 +14,25 @@
 using namespace muduo;
 using namespace muduo::net;
 
+int g_busyPollUs = 0;
+
 void onConnection(const TcpConnectionPtr& conn)
 {
   if (conn->connected())
   {
     conn->setTcpNoDelay(true);
+    if (g_busyPollUs > 0)
+    {
+      conn->setBusyPoll(g_busyPollUs);
+    }
   }
 }
 
+void setBusyPoll(EventLoop* loop)
+{
+  loop->setBusyPoll(g_busyPollUs);
+}
+
 void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
 {
   conn->send(buf);
@@ -31,7 +42,7 @@ int main(int argc, char* argv[])
 {
   if (argc < 4)
   {
-    fprintf(stderr, "Usage: server <address> <port> <threads>\n");
+    fprintf(stderr, "Usage: server <address> <port> <threads> [busy_poll_us]\n");
   }
   else
   {
@@ -42,6 +53,7 @@ int main(int argc, char* argv[])
     uint16_t port = static_cast<uint16_t>(atoi(argv[2]));
     InetAddress listenAddr(ip, port);
     int threadCount = atoi(argv[3]);
+    g_busyPollUs = argc > 4 ? atoi(argv[4]) : 0;
 
     EventLoop loop;
 
@@ -54,6 +66,10 @@ int main(int argc, char* argv[])
     {
       server.setThreadNum(threadCount);
     }
+    if (g_busyPollUs > 0)
+    {
+      server.setThreadInitCallback(setBusyPoll);
+    }
 
     server.start();
 
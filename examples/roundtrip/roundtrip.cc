@@ -9,6 +9,22 @@ using namespace muduo;
 using namespace muduo::net;
 
 const size_t frameLen = 2*sizeof(int64_t);
+int g_busyPollUs = 0;  // EventLoop::setBusyPoll() and SO_BUSY_POLL
+
+void reportBusyPoll(EventLoop* loop)
+{
+  LOG_INFO << "spin " << loop->spinMicroSeconds() / 1000
+           << " ms, block " << loop->blockMicroSeconds() / 1000 << " ms";
+}
+
+void setBusyPoll(EventLoop* loop)
+{
+  if (g_busyPollUs > 0)
+  {
+    loop->setBusyPoll(g_busyPollUs);
+    loop->runEvery(5.0, std::bind(reportBusyPoll, loop));
+  }
+}
 
 void serverConnectionCallback(const TcpConnectionPtr& conn)
 {
@@ -18,6 +34,10 @@ void serverConnectionCallback(const TcpConnectionPtr& conn)
   if (conn->connected())
   {
     conn->setTcpNoDelay(true);
+    if (g_busyPollUs > 0)
+    {
+      conn->setBusyPoll(g_busyPollUs);
+    }
   }
   else
   {
@@ -45,6 +65,7 @@ void runServer(uint16_t port)
   server.setConnectionCallback(serverConnectionCallback);
   server.setMessageCallback(serverMessageCallback);
   server.start();
+  setBusyPoll(&loop);
   loop.loop();
 }
 
@@ -59,6 +80,10 @@ void clientConnectionCallback(const TcpConnectionPtr& conn)
   {
     clientConnection = conn;
     conn->setTcpNoDelay(true); //消息一到，立刻发送；不需要等到更多消息到来再发送
+    if (g_busyPollUs > 0)
+    {
+      conn->setBusyPoll(g_busyPollUs);
+    }
   }
   else
   {
@@ -103,6 +128,7 @@ void runClient(const char* ip, uint16_t port)
   client.setMessageCallback(clientMessageCallback);
   client.connect();
   loop.runEvery(0.2, sendMyTime);
+  setBusyPoll(&loop);
   loop.loop();
 }
 
@@ -111,6 +137,7 @@ int main(int argc, char* argv[])
   if (argc > 2)
   {
     uint16_t port = static_cast<uint16_t>(atoi(argv[2]));
+    g_busyPollUs = argc > 3 ? atoi(argv[3]) : 0;
     if (strcmp(argv[1], "-s") == 0)
     {
       runServer(port);
@@ -122,7 +149,7 @@ int main(int argc, char* argv[])
   }
   else
   {
-    printf("Usage:\n%s -s port\n%s ip port\n", argv[0], argv[0]);
+    printf("Usage:\n%s -s port [busy_poll_us]\n%s ip port [busy_poll_us]\n", argv[0], argv[0]);
   }
 }
 
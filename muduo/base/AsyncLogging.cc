@@ -4,13 +4,419 @@
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
 
 #include <muduo/base/AsyncLogging.h>
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/LockFreeBoundedQueue.h>
 #include <muduo/base/LogFile.h>
 #include <muduo/base/Timestamp.h>
 
+#include <algorithm>
+#include <functional>
+#include <queue>
+
 #include <stdio.h>
 
 using namespace muduo;
 
+namespace muduo
+{
+namespace detail
+{
+
+///
+/// Lines of one thread for one AsyncLogging.
+///
+/// The thread appends records, time, length and kind before the line, to its
+/// current chunk and publishes how far it wrote, the backend reads up
+/// to there without waiting for the chunk to fill.  A full chunk goes to
+/// the backend on full_, which gives it back on free_ once written, or
+/// frees it if the thread has spares already.  Chunks are numbered as
+/// they become current, so the backend knows how far it read even when
+/// it still sees a chunk as current after taking it off full_.
+///
+/// Only full chunks the backend has not written yet count against
+/// kMaxChunks, of all stagings, the current chunk is taken at the first
+/// line and the spares are given up when the thread stays idle.
+///
+class LogStaging : noncopyable
+{
+ public:
+  typedef FixedBuffer<kMediumBuffer> Buffer;
+
+  struct Chunk
+  {
+    Buffer buffer;
+    std::atomic<int> committed;  // bytes of whole records in buffer
+    std::atomic<int64_t> sequence;
+  };
+
+  struct Record
+  {
+    int64_t micros;
+    const char* data;
+    int len;
+    int binary;  // a BinaryLogger record
+  };
+
+  // 前端太快，所有线程待写的满chunk共 kMaxChunks 个（约25个kLargeBuffer），超出则丢弃
+  static const int kMaxChunks = 25 * kLargeBuffer / kMediumBuffer;
+  static const int kSpareChunks = 4;
+  static const int kHeaderSize = static_cast<int>(sizeof(int64_t) + 2 * sizeof(int));
+
+  LogStaging()
+    : full_(kMaxChunks),
+      free_(kSpareChunks),
+      current_(NULL),
+      dropped_(0),
+      retired_(false),
+      nextSequence_(0),
+      readSequence_(0),
+      readOffset_(0),
+      active_(false)
+  {
+  }
+
+  ~LogStaging()
+  {
+    Chunk* chunk = NULL;
+    while (full_.tryTake(&chunk))
+    {
+      numFull_.fetch_sub(1, std::memory_order_relaxed);
+      delete chunk;
+    }
+    releaseSpares();
+    delete current_.load(std::memory_order_relaxed);
+  }
+
+  /// In the owner thread, returns true if it handed a full chunk off.
+  bool append(int64_t micros, const char* logline, int len, int binary)
+  {
+    // FixedBuffer::append() wants more room than it copies
+    len = std::min(len, kMediumBuffer - kHeaderSize - 1);
+    bool handedOff = false;
+    Chunk* chunk = current_.load(std::memory_order_relaxed);
+    if (chunk == NULL || chunk->buffer.avail() <= kHeaderSize + len)
+    {
+      if (chunk != NULL)
+      {
+        if (numFull_.fetch_add(1, std::memory_order_relaxed) >= kMaxChunks)
+        {
+          // the backend is behind, keeps the chunk until it catches up
+          numFull_.fetch_sub(1, std::memory_order_relaxed);
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+        bool ok = full_.tryPut(chunk);
+        assert(ok); (void)ok;
+        handedOff = true;
+      }
+      chunk = takeFreeChunk();
+      // after full_, so the backend finds the full chunk before this one
+      current_.store(chunk, std::memory_order_release);
+    }
+    Buffer& buf = chunk->buffer;
+    ::memcpy(buf.current(), &micros, sizeof micros);
+    buf.add(sizeof micros);
+    ::memcpy(buf.current(), &len, sizeof len);
+    buf.add(sizeof len);
+    ::memcpy(buf.current(), &binary, sizeof binary);
+    buf.add(sizeof binary);
+    ::memcpy(buf.current(), logline, len);
+    buf.add(len);
+    chunk->committed.store(buf.length(), std::memory_order_release);
+    return handedOff;
+  }
+
+  /// The owner thread is gone, after its last append().
+  void retire() { retired_.store(true, std::memory_order_release); }
+  bool retired() const { return retired_.load(std::memory_order_acquire); }
+
+  /// In the backend thread, appends records staged since the last call,
+  /// in order, to @c records.  The chunks read through are appended to
+  /// @c consumed, recycle() them after the records are written.
+  void collect(std::vector<Record>* records, std::vector<Chunk*>* consumed)
+  {
+    for (;;)
+    {
+      // current before full_, a chunk handed off meanwhile is read first
+      Chunk* current = current_.load(std::memory_order_acquire);
+      Chunk* full = NULL;
+      if (full_.tryTake(&full))
+      {
+        read(full, records);
+        readSequence_ = full->sequence.load(std::memory_order_relaxed) + 1;
+        readOffset_ = 0;
+        consumed->push_back(full);
+      }
+      else
+      {
+        if (current != NULL)
+        {
+          read(current, records);
+        }
+        break;
+      }
+    }
+  }
+
+  void recycle(Chunk* chunk)
+  {
+    numFull_.fetch_sub(1, std::memory_order_relaxed);
+    if (free_.size() >= kSpareChunks || !free_.tryPut(chunk))
+    {
+      delete chunk;
+    }
+  }
+
+  /// In the backend thread, true if anything was staged since the last call.
+  bool takeActive()
+  {
+    bool active = active_;
+    active_ = false;
+    return active;
+  }
+
+  /// In the backend thread, or with the owner gone, deletes the spare chunks.
+  void releaseSpares()
+  {
+    Chunk* chunk = NULL;
+    while (free_.tryTake(&chunk))
+    {
+      delete chunk;
+    }
+  }
+
+  /// In the backend thread, lines dropped since the last call.
+  int64_t takeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+ private:
+  Chunk* takeFreeChunk()
+  {
+    Chunk* chunk = NULL;
+    if (free_.tryTake(&chunk))
+    {
+      chunk->buffer.reset();
+    }
+    else
+    {
+      chunk = new Chunk;
+      chunk->buffer.bzero();  // faults its pages in here, not line by line
+    }
+    chunk->committed.store(0, std::memory_order_relaxed);
+    chunk->sequence.store(nextSequence_++, std::memory_order_release);
+    return chunk;
+  }
+
+  void read(Chunk* chunk, std::vector<Record>* records)
+  {
+    int64_t sequence = chunk->sequence.load(std::memory_order_acquire);
+    if (sequence < readSequence_)
+    {
+      return;  // read through already
+    }
+    int offset = sequence == readSequence_ ? readOffset_ : 0;
+    const int end = chunk->committed.load(std::memory_order_acquire);
+    if (offset < end)
+    {
+      active_ = true;
+    }
+    const char* data = chunk->buffer.data();
+    while (offset < end)
+    {
+      Record record;
+      ::memcpy(&record.micros, data + offset, sizeof record.micros);
+      ::memcpy(&record.len, data + offset + sizeof record.micros, sizeof record.len);
+      ::memcpy(&record.binary, data + offset + sizeof record.micros + sizeof record.len,
+               sizeof record.binary);
+      record.data = data + offset + kHeaderSize;
+      records->push_back(record);
+      offset += kHeaderSize + record.len;
+    }
+    assert(offset == end);
+    readSequence_ = sequence;
+    readOffset_ = end;
+  }
+
+  static std::atomic<int> numFull_;  // handed off and not written, of every staging
+
+  LockFreeBoundedQueue<Chunk*, true> full_;  // owner to backend
+  LockFreeBoundedQueue<Chunk*, false> free_;  // backend to owner, or back to the backend
+  std::atomic<Chunk*> current_;  // NULL until the first line
+  std::atomic<int64_t> dropped_;
+  std::atomic<bool> retired_;
+
+  int64_t nextSequence_;  // owner thread
+
+  // backend thread, how far it read
+  int64_t readSequence_;
+  int readOffset_;
+  bool active_;  // read anything since takeActive()
+};
+
+std::atomic<int> LogStaging::numFull_(0);
+
+}  // namespace detail
+}  // namespace muduo
+
+namespace
+{
+
+std::atomic<int64_t> g_numCreated(0);
+
+// the last AsyncLogging this thread appended to, and its staging
+__thread int64_t t_lastId = 0;
+__thread detail::LogStaging* t_lastStaging = NULL;
+__thread bool t_exiting = false;
+
+// Every staging of this thread, retired on thread exit.
+struct ThreadStagings
+{
+  ~ThreadStagings()
+  {
+    t_lastId = 0;
+    t_lastStaging = NULL;
+    t_exiting = true;
+    for (const auto& staging : stagings)
+    {
+      staging.second->retire();
+    }
+  }
+
+  std::vector<std::pair<int64_t, std::shared_ptr<detail::LogStaging>>> stagings;
+};
+
+thread_local ThreadStagings t_stagings;
+
+typedef detail::LogStaging::Record Record;
+
+// Writes through a large buffer, LogFile sees big appends as before.
+// Writing binary, every line is a frame, and every LogFile::append()
+// has the site frames of its records, so does every file it rolls to.
+class Writer : noncopyable
+{
+ public:
+  Writer(LogFile* output, bool binary)
+    : output_(output),
+      binary_(binary),
+      buffer_(new detail::FixedBuffer<detail::kLargeBuffer>),
+      generation_(1)
+  {
+  }
+
+  void append(const char* data, int len)
+  {
+    if (binary_)
+    {
+      reserve(binarylog::kFrameHeaderSize + len);
+      binarylog::writeFrameHeader(buffer_->current(), binarylog::kTextFrame, len);
+      buffer_->add(binarylog::kFrameHeaderSize);
+    }
+    else
+    {
+      reserve(len);
+    }
+    buffer_->append(data, len);
+  }
+
+  void appendRecord(const char* record, int len)
+  {
+    uint32_t id = binaryRecordSite(record, len);
+    const LogSite* site = LogSite::find(id);
+    assert(site != NULL);
+    if (!binary_)
+    {
+      line_.resetBuffer();
+      formatBinaryRecord(site->info(), record, len, Logger::timeZone(), &line_);
+      append(line_.buffer().data(), line_.buffer().length());
+      return;
+    }
+
+    LogSiteInfo info = site->info();
+    int siteFrame = binarylog::siteFrameSize(info);
+    reserve(siteFrame + binarylog::kFrameHeaderSize + len);
+    if (id >= siteGenerations_.size())
+    {
+      siteGenerations_.resize(id + 1);
+    }
+    if (siteGenerations_[id] != generation_)
+    {
+      siteGenerations_[id] = generation_;
+      binarylog::writeSiteFrame(buffer_->current(), id, info);
+      buffer_->add(siteFrame);
+    }
+    binarylog::writeFrameHeader(buffer_->current(), binarylog::kRecordFrame, len);
+    buffer_->add(binarylog::kFrameHeaderSize);
+    buffer_->append(record, len);
+  }
+
+  void flush()
+  {
+    if (buffer_->length() > 0)
+    {
+      output_->append(buffer_->data(), buffer_->length());
+      buffer_->reset();
+      ++generation_;
+    }
+  }
+
+ private:
+  void reserve(int len)
+  {
+    if (buffer_->avail() <= len)
+    {
+      flush();
+    }
+  }
+
+  LogFile* output_;
+  const bool binary_;
+  std::unique_ptr<detail::FixedBuffer<detail::kLargeBuffer>> buffer_;
+  LogStream line_;
+  // site frames written since the last flush() are of this generation
+  std::vector<int64_t> siteGenerations_;
+  int64_t generation_;
+};
+
+// Merges the runs of records, records[runEnds[i-1], runEnds[i]) each,
+// by time, taking ties and every run in order.
+void writeMerged(const std::vector<Record>& records,
+                 const std::vector<size_t>& runEnds,
+                 Writer* writer)
+{
+  typedef std::pair<int64_t, size_t> Head;  // time, run
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+  std::vector<size_t> next(runEnds.size());
+  size_t begin = 0;
+  for (size_t run = 0; run < runEnds.size(); ++run)
+  {
+    next[run] = begin;
+    if (begin < runEnds[run])
+    {
+      heads.push(Head(records[begin].micros, run));
+    }
+    begin = runEnds[run];
+  }
+  while (!heads.empty())
+  {
+    size_t run = heads.top().second;
+    heads.pop();
+    const Record& record = records[next[run]];
+    if (record.binary)
+    {
+      writer->appendRecord(record.data, record.len);
+    }
+    else
+    {
+      writer->append(record.data, record.len);
+    }
+    if (++next[run] < runEnds[run])
+    {
+      heads.push(Head(records[next[run]].micros, run));
+    }
+  }
+}
+
+}  // namespace
+
 AsyncLogging::AsyncLogging(const string& basename,
                            off_t rollSize,
                            int flushInterval)
@@ -18,132 +424,172 @@ AsyncLogging::AsyncLogging(const string& basename,
     running_(false),
     basename_(basename),
     rollSize_(rollSize),
+    writeBinary_(false),
+    fileMode_(FileUtil::AppendFile::kBuffered),
+    id_(++g_numCreated),
     thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
     latch_(1),
     mutex_(),
     cond_(mutex_),
-    currentBuffer_(new Buffer),
-    nextBuffer_(new Buffer),
-    buffers_()
+    wakeupPending_(false),
+    newStagings_()
 {
-  currentBuffer_->bzero(); //清空缓冲区
-  nextBuffer_->bzero();
-  buffers_.reserve(16);//预留16个空间
 }
 
 void AsyncLogging::append(const char* logline, int len)
 {
-  muduo::MutexLockGuard lock(mutex_);
-  if (currentBuffer_->avail() > len)
+  append(Timestamp::now().microSecondsSinceEpoch(), logline, len, false);
+}
+
+void AsyncLogging::appendBinary(const char* record, int len)
+{
+  append(binaryRecordTime(record, len), record, len, true);
+}
+
+void AsyncLogging::append(int64_t micros, const char* data, int len, bool binary)
+{
+  if (t_exiting)
   {
-    // 当前缓冲区未满，将数据追加到末尾
-    currentBuffer_->append(logline, len);
+    // thread-local destructors logging, a staging for this line only
+    StagingPtr staging(new detail::LogStaging);
+    staging->append(micros, data, len, binary);
+    staging->retire();
+    registerStaging(staging);
+    return;
   }
-  else
+  detail::LogStaging* staging = t_lastId == id_ ? t_lastStaging : stagingOfThisThread();
+  if (staging->append(micros, data, len, binary))
   {
-    // 当前缓冲区已满，将当前缓冲区添加到待写入文件的已填满的缓冲区列表
-    buffers_.push_back(std::move(currentBuffer_));
+    wakeup(); //通知后端开始写日志（条件变量来通知）
+  }
+}
 
-// 将当前缓冲区设置为预备缓冲区
-    if (nextBuffer_)
-    {
-      currentBuffer_ = std::move(nextBuffer_);
-    }
-    else
+detail::LogStaging* AsyncLogging::stagingOfThisThread()
+{
+  detail::LogStaging* staging = NULL;
+  for (const auto& entry : t_stagings.stagings)
+  {
+    if (entry.first == id_)
     {
-      // 这种情况，极少发生，前端写入速度太快，一下子把两块缓冲区都写完
-      // 那么，只好分配一块新的缓冲区
-      currentBuffer_.reset(new Buffer); // Rarely happens
+      staging = entry.second.get();
+      break;
     }
-    currentBuffer_->append(logline, len);
-    cond_.notify(); //通知后端开始写日志（条件变量来通知）
   }
+  if (staging == NULL)
+  {
+    StagingPtr newStaging(new detail::LogStaging);
+    t_stagings.stagings.push_back(std::make_pair(id_, newStaging));
+    registerStaging(newStaging);
+    staging = newStaging.get();
+  }
+  t_lastId = id_;
+  t_lastStaging = staging;
+  return staging;
+}
+
+void AsyncLogging::registerStaging(const StagingPtr& staging)
+{
+  muduo::MutexLockGuard lock(mutex_);
+  newStagings_.push_back(staging);
+}
+
+void AsyncLogging::wakeup()
+{
+  muduo::MutexLockGuard lock(mutex_);
+  wakeupPending_ = true;
+  cond_.notify();
 }
 
 void AsyncLogging::threadFunc()
 {
   assert(running_ == true);
   latch_.countDown();
-  LogFile output(basename_, rollSize_, false);
-  // 准备两块空闲缓冲区
-  BufferPtr newBuffer1(new Buffer);
-  BufferPtr newBuffer2(new Buffer);
-  newBuffer1->bzero();
-  newBuffer2->bzero();
-  BufferVector buffersToWrite;
-  buffersToWrite.reserve(16);
-  while (running_)
+  LogFile output(basename_, rollSize_, false, flushInterval_, 1024, fileMode_);
+  output.setRollCallback(rollCallback_);
+  Writer writer(&output, writeBinary_);
+  std::vector<StagingPtr> stagings;
+  std::vector<Record> records;
+  std::vector<size_t> runEnds;
+  std::vector<std::vector<detail::LogStaging::Chunk*>> consumed;
+  std::vector<bool> retired;
+  Timestamp lastTrim = Timestamp::now();
+  bool running = true;
+  while (running)
   {
-    assert(newBuffer1 && newBuffer1->length() == 0);
-    assert(newBuffer2 && newBuffer2->length() == 0);
-    assert(buffersToWrite.empty()); 
-
+    // one more round after stop(), for the lines appended before it
+    running = running_;
     {
       muduo::MutexLockGuard lock(mutex_);
-      if (buffers_.empty())  // unusual usage! //（条件变量一般用while循环，用if可能会产生虚假唤醒）注意，这里是一个非常规用法
+      if (!wakeupPending_ && running)  // unusual usage! //（条件变量一般用while循环，用if可能会产生虚假唤醒）注意，这里是一个非常规用法
       {
-        cond_.waitForSeconds(flushInterval_); //等待前端写满一个或者多个buffer，或者一个超时时间到来
-      }
-      buffers_.push_back(std::move(currentBuffer_)); //将当前缓冲区移入buffers_
-      currentBuffer_ = std::move(newBuffer1); //将空闲的newBuffer1置为当前缓冲区
-      buffersToWrite.swap(buffers_); //buffers与buffersToWrite交换，这样后面的代码可以在临界区之外安全地访问buffersToWrite
-      if (!nextBuffer_)
-      {
-        nextBuffer_ = std::move(newBuffer2);
-        // 确保前端始终有一个预备buffer可供调配，减少前端临界区分配内存的概率，缩短前端临界区长度
+        cond_.waitForSeconds(flushInterval_); //等待前端写满一个或者多个chunk，或者一个超时时间到来
       }
+      wakeupPending_ = false;
+      stagings.insert(stagings.end(), newStagings_.begin(), newStagings_.end());
+      newStagings_.clear();
     }
 
-    assert(!buffersToWrite.empty());
+    records.clear();
+    runEnds.clear();
+    consumed.resize(stagings.size());
+    retired.resize(stagings.size());
+    int64_t dropped = 0;
+    for (size_t i = 0; i < stagings.size(); ++i)
+    {
+      retired[i] = stagings[i]->retired();  // before collect(), its lines are all there
+      stagings[i]->collect(&records, &consumed[i]);
+      runEnds.push_back(records.size());
+      dropped += stagings[i]->takeDropped();
+    }
 
 // 消息堆积
-/* 
+/*
   前端陷入死循环，拼命发送日志信息，超过后端的处理能力，这就是典型的生产速度超过消费
-  速度问题，会造成数据在内存中堆积，严重时引发性能问题（可用内存不足）或程序崩溃（分配内存失败）
+  速度问题，每个线程的chunk用完后，前端丢弃日志，以免内存耗尽
  */
-    if (buffersToWrite.size() > 25)
+    if (dropped > 0)
     {
       char buf[256];
-      snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
-               Timestamp::now().toFormattedString().c_str(),
-               buffersToWrite.size()-2);
+      snprintf(buf, sizeof buf, "Dropped %lld log messages at %s\n",
+               static_cast<long long>(dropped),
+               Timestamp::now().toFormattedString().c_str());
       fputs(buf, stderr);
-      output.append(buf, static_cast<int>(strlen(buf)));
-      buffersToWrite.erase(buffersToWrite.begin()+2, buffersToWrite.end()); //丢掉多余日志，以腾出内存，仅保存2个buffer
-    }
-
-    for (const auto& buffer : buffersToWrite)
-    {
-      // FIXME: use unbuffered stdio FILE ? or use ::writev ?
-      output.append(buffer->data(), buffer->length());
+      writer.append(buf, static_cast<int>(strlen(buf)));
     }
 
-    if (buffersToWrite.size() > 2)
-    {
-      // drop non-bzero-ed buffers, avoid trashing
-      buffersToWrite.resize(2); //仅保存两个buffer，用于newBuffer与newBuffer2
-    
-    }
+    writeMerged(records, runEnds, &writer);
+    writer.flush();
 
-    if (!newBuffer1)
+    size_t live = 0;
+    for (size_t i = 0; i < stagings.size(); ++i)
     {
-      assert(!buffersToWrite.empty());
-      newBuffer1 = std::move(buffersToWrite.back());
-      buffersToWrite.pop_back();
-      newBuffer1->reset();
+      for (detail::LogStaging::Chunk* chunk : consumed[i])
+      {
+        stagings[i]->recycle(chunk);
+      }
+      consumed[i].clear();
+      if (!retired[i])
+      {
+        stagings[live++].swap(stagings[i]);
+      }
     }
+    stagings.resize(live);
 
-    if (!newBuffer2)
+    // threads that staged nothing for a while give their spare chunks up,
+    // retired ones are gone with their last reference above
+    Timestamp now = Timestamp::now();
+    if (timeDifference(now, lastTrim) >= flushInterval_)
     {
-      assert(!buffersToWrite.empty());
-      newBuffer2 = std::move(buffersToWrite.back());
-      buffersToWrite.pop_back();
-      newBuffer2->reset();
+      lastTrim = now;
+      for (const StagingPtr& staging : stagings)
+      {
+        if (!staging->takeActive())
+        {
+          staging->releaseSpares();
+        }
+      }
     }
-
-    buffersToWrite.clear();
     output.flush();
   }
   output.flush();
 }
-
@@ -6,19 +6,35 @@
 #ifndef MUDUO_BASE_ASYNCLOGGING_H
 #define MUDUO_BASE_ASYNCLOGGING_H
 
-#include <muduo/base/BlockingQueue.h>
-#include <muduo/base/BoundedBlockingQueue.h>
 #include <muduo/base/CountDownLatch.h>
+#include <muduo/base/LogFile.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/LogStream.h>
 
 #include <atomic>
+#include <memory>
 #include <vector>
 
 namespace muduo
 {
 
+namespace detail
+{
+class LogStaging;
+}  // namespace detail
+
+///
+/// Log lines are staged per thread: each thread appending fills chunks of
+/// its own, a full chunk is handed to the backend thread over a
+/// single-producer single-consumer queue, so append() takes no lock
+/// shared with other threads.  The backend writes what every thread has
+/// staged, merged by the time of append(), each thread's lines in order.
+///
+/// Records of deferred LOG_* statements, see BinaryLogging.h, are
+/// formatted by the backend thread, or written as they are for
+/// binarylog_decode with setWriteBinary().
+///
 class AsyncLogging : noncopyable
 {
  public:
@@ -37,7 +53,21 @@ class AsyncLogging : noncopyable
 
 // 供前端生产者线程调用（日志数据写到缓存）
   void append(const char* logline, int len);
+  /// A BinaryLogger record, for BinaryLogger::setOutput().
+  void appendBinary(const char* record, int len);
+
+  /// Before start(), writes a file of frames for binarylog_decode,
+  /// deferred records unformatted.
+  void setWriteBinary(bool on) { writeBinary_ = on; }
+
+  /// Before start(), how blocks of lines get to the file, see LogFile.
+  /// kBlocks or kDirect write each with one system call, synced in the
+  /// background, kBuffered by default.
+  void setFileMode(FileUtil::AppendFile::Mode mode) { fileMode_ = mode; }
 
+  /// Before start(), for each file rolled over, called in the backend
+  /// thread.  LogCompressor::compress() only queues the file.
+  void setRollCallback(const LogFile::RollCallback& cb) { rollCallback_ = cb; }
 
   void start()
   {
@@ -46,35 +76,39 @@ class AsyncLogging : noncopyable
     latch_.wait();
   }
 
-  void stop() NO_THREAD_SAFETY_ANALYSIS
+  /// Lines appended before are written.
+  void stop()
   {
     running_ = false;
-    cond_.notify();
+    wakeup();
     thread_.join();
   }
 
  private:
+  typedef std::shared_ptr<detail::LogStaging> StagingPtr;
 
 // 供后端消费者线程调用(将数据写到日志文件)
   void threadFunc();
 
-  typedef muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer> Buffer;
-  typedef std::vector<std::unique_ptr<Buffer>> BufferVector;
-  typedef BufferVector::value_type BufferPtr; //可理解为Buffer的智能指针，能管理Buffer的生存周期，
-  // 类似于C++ 11中的unique_ptr，具备移动语义
-  // (两个unique_ptr不能指向一个对象，不能进行复制操纵，只能进行移动操作)
+  detail::LogStaging* stagingOfThisThread();
+  void append(int64_t micros, const char* data, int len, bool binary);
+  void registerStaging(const StagingPtr& staging);
+  void wakeup();
 
   const int flushInterval_; //超时时间，在flushInterval秒内，缓冲区没写满，仍将缓冲区中的数据写到文件
   std::atomic<bool> running_;
   const string basename_;
   const off_t rollSize_;
+  bool writeBinary_;
+  FileUtil::AppendFile::Mode fileMode_;
+  LogFile::RollCallback rollCallback_;
+  const int64_t id_;  // tells thread-local stagings of instances apart
   muduo::Thread thread_;
   muduo::CountDownLatch latch_; //用于等待线程启动
   muduo::MutexLock mutex_;
   muduo::Condition cond_ GUARDED_BY(mutex_);
-  BufferPtr currentBuffer_ GUARDED_BY(mutex_); //当前缓冲区
-  BufferPtr nextBuffer_ GUARDED_BY(mutex_); //预备缓冲区
-  BufferVector buffers_ GUARDED_BY(mutex_); //待写入文件的已填满的缓冲区
+  bool wakeupPending_ GUARDED_BY(mutex_); //有填满的chunk待写入
+  std::vector<StagingPtr> newStagings_ GUARDED_BY(mutex_); //新线程的staging，后端线程接管
 };
 
 }  // namespace muduo
@@ -0,0 +1,320 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/BinaryLogging.h>
+
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/LoggingInternal.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+
+namespace
+{
+
+MutexLock g_sitesMutex;
+uint32_t g_numSites = 0;
+// indexed by id, stored once, read by any thread
+std::atomic<const LogSite*> g_sites[LogSite::kMaxSites + 1];
+
+std::atomic<BinaryLogger::OutputFunc> g_binaryOutput(NULL);
+
+__thread int t_lastTid;
+__thread char t_tidString[32];
+__thread int t_tidStringLength;
+
+template<typename T>
+T load(const char* p)
+{
+  T v;
+  ::memcpy(&v, p, sizeof v);
+  return v;
+}
+
+template<typename T>
+char* store(char* p, T v)
+{
+  ::memcpy(p, &v, sizeof v);
+  return p + sizeof v;
+}
+
+}  // namespace
+
+LogSiteInfo LogSite::info() const
+{
+  LogSiteInfo info;
+  info.level = level_;
+  info.line = line_;
+  info.file = StringPiece(file_.data_, file_.size_);
+  info.func = func_ ? StringPiece(func_) : StringPiece();
+  return info;
+}
+
+uint32_t LogSite::registerSite(const char* func)
+{
+  MutexLockGuard lock(g_sitesMutex);
+  uint32_t id = id_.load(std::memory_order_relaxed);
+  if (id == 0 && g_numSites < kMaxSites)
+  {
+    id = ++g_numSites;
+    func_ = func;
+    g_sites[id].store(this, std::memory_order_release);
+    id_.store(id, std::memory_order_release);
+  }
+  return id;
+}
+
+const LogSite* LogSite::find(uint32_t id)
+{
+  return id <= kMaxSites ? g_sites[id].load(std::memory_order_acquire) : NULL;
+}
+
+BinaryLogStream& BinaryLogStream::putString(const char* data, size_t len)
+{
+  // dropped if it doesn't fit, as LogStream does
+  if (static_cast<size_t>(buffer_.avail()) > 1 + sizeof(uint32_t) + len)
+  {
+    char* p = buffer_.current();
+    *p++ = static_cast<char>(kString);
+    p = store(p, static_cast<uint32_t>(len));
+    ::memcpy(p, data, len);
+    buffer_.add(1 + sizeof(uint32_t) + len);
+  }
+  return *this;
+}
+
+BinaryLogger::BinaryLogger(LogSite& site, const char* func)
+  : site_(site),
+    func_(func)
+{
+  char header[kHeaderSize];
+  char* p = store(header, site.id(func));
+  p = store(p, Timestamp::now().microSecondsSinceEpoch());
+  store(p, static_cast<int32_t>(CurrentThread::tid()));
+  stream_.append(header, kHeaderSize);
+}
+
+BinaryLogger::~BinaryLogger()
+{
+  const BinaryLogStream::Buffer& buf = stream_.buffer();
+  OutputFunc out = g_binaryOutput.load(std::memory_order_acquire);
+  if (out && binaryRecordSite(buf.data(), buf.length()) != 0)
+  {
+    out(buf.data(), buf.length());
+  }
+  else
+  {
+    LogSiteInfo info = site_.info();
+    info.func = func_ ? StringPiece(func_) : StringPiece();
+    LogStream line;
+    formatBinaryRecord(info, buf.data(), buf.length(), Logger::timeZone(), &line);
+    g_output(line.buffer().data(), line.buffer().length());
+  }
+}
+
+void BinaryLogger::setOutput(OutputFunc out)
+{
+  g_binaryOutput.store(out, std::memory_order_release);
+}
+
+BinaryLogger::OutputFunc BinaryLogger::output()
+{
+  return g_binaryOutput.load(std::memory_order_acquire);
+}
+
+int64_t muduo::binaryRecordTime(const char* record, int len)
+{
+  assert(len >= BinaryLogger::kHeaderSize); (void)len;
+  return load<int64_t>(record + sizeof(uint32_t));
+}
+
+uint32_t muduo::binaryRecordSite(const char* record, int len)
+{
+  assert(len >= BinaryLogger::kHeaderSize); (void)len;
+  return load<uint32_t>(record);
+}
+
+bool muduo::formatBinaryRecord(const LogSiteInfo& site, const char* record, int len,
+                               const TimeZone& tz, LogStream* out)
+{
+  int level = site.level;
+  if (len < BinaryLogger::kHeaderSize || level < 0 || level >= Logger::NUM_LOG_LEVELS)
+  {
+    return false;
+  }
+  formatTime(binaryRecordTime(record, len), tz, *out);
+  int tid = load<int32_t>(record + 12);
+  if (tid != t_lastTid || t_tidStringLength == 0)
+  {
+    t_lastTid = tid;
+    t_tidStringLength = snprintf(t_tidString, sizeof t_tidString, "%5d ", tid);
+  }
+  out->append(t_tidString, t_tidStringLength);
+  out->append(LogLevelName[level], 6);
+  if (site.func.size() > 0)
+  {
+    *out << site.func << ' ';
+  }
+
+  const char* p = record + BinaryLogger::kHeaderSize;
+  const char* end = record + len;
+  bool ok = true;
+  while (ok && p < end)
+  {
+    char tag = *p++;
+    size_t left = static_cast<size_t>(end - p);
+    switch (tag)
+    {
+      case BinaryLogStream::kBool:
+        if ((ok = left >= 1)) { *out << (*p != 0); p += 1; }
+        break;
+      case BinaryLogStream::kChar:
+        if ((ok = left >= 1)) { *out << *p; p += 1; }
+        break;
+      case BinaryLogStream::kInt32:
+        if ((ok = left >= 4)) { *out << load<int32_t>(p); p += 4; }
+        break;
+      case BinaryLogStream::kUint32:
+        if ((ok = left >= 4)) { *out << load<uint32_t>(p); p += 4; }
+        break;
+      case BinaryLogStream::kInt64:
+        if ((ok = left >= 8)) { *out << static_cast<long long>(load<int64_t>(p)); p += 8; }
+        break;
+      case BinaryLogStream::kUint64:
+        if ((ok = left >= 8)) { *out << static_cast<unsigned long long>(load<uint64_t>(p)); p += 8; }
+        break;
+      case BinaryLogStream::kDouble:
+        if ((ok = left >= 8)) { *out << load<double>(p); p += 8; }
+        break;
+      case BinaryLogStream::kPointer:
+        if ((ok = left >= sizeof(uintptr_t)))
+        {
+          *out << reinterpret_cast<const void*>(load<uintptr_t>(p));
+          p += sizeof(uintptr_t);
+        }
+        break;
+      case BinaryLogStream::kString:
+        if ((ok = left >= 4 && load<uint32_t>(p) <= left - 4))
+        {
+          uint32_t n = load<uint32_t>(p);
+          out->append(p + 4, static_cast<int>(n));
+          p += 4 + n;
+        }
+        break;
+      default:
+        ok = false;
+        break;
+    }
+  }
+  *out << " - " << site.file << ':' << site.line << '\n';
+  return ok;
+}
+
+void binarylog::writeFrameHeader(char* buf, FrameType type, int payloadLength)
+{
+  buf = store(buf, static_cast<uint32_t>(payloadLength));
+  *buf = static_cast<char>(type);
+}
+
+int binarylog::siteFrameSize(const LogSiteInfo& site)
+{
+  return kFrameHeaderSize + 4 + 1 + 4 + 2 + site.file.size() + 2 + site.func.size();
+}
+
+void binarylog::writeSiteFrame(char* buf, uint32_t id, const LogSiteInfo& site)
+{
+  writeFrameHeader(buf, kSiteFrame, siteFrameSize(site) - kFrameHeaderSize);
+  char* p = buf + kFrameHeaderSize;
+  p = store(p, id);
+  p = store(p, static_cast<uint8_t>(site.level));
+  p = store(p, static_cast<int32_t>(site.line));
+  p = store(p, static_cast<uint16_t>(site.file.size()));
+  ::memcpy(p, site.file.data(), site.file.size());
+  p += site.file.size();
+  p = store(p, static_cast<uint16_t>(site.func.size()));
+  ::memcpy(p, site.func.data(), site.func.size());
+}
+
+BinaryLogDecoder::BinaryLogDecoder(const TimeZone& tz)
+  : tz_(tz),
+    numErrors_(0)
+{
+}
+
+BinaryLogDecoder::~BinaryLogDecoder() = default;
+
+size_t BinaryLogDecoder::decode(const char* data, size_t len, string* out)
+{
+  size_t pos = 0;
+  while (len - pos >= static_cast<size_t>(binarylog::kFrameHeaderSize))
+  {
+    uint32_t payload = load<uint32_t>(data + pos);
+    if (len - pos - binarylog::kFrameHeaderSize < payload)
+    {
+      break;
+    }
+    decodeFrame(data[pos + 4], data + pos + binarylog::kFrameHeaderSize,
+                static_cast<int>(payload), out);
+    pos += binarylog::kFrameHeaderSize + payload;
+  }
+  return pos;
+}
+
+void BinaryLogDecoder::decodeFrame(char type, const char* payload, int len, string* out)
+{
+  if (type == binarylog::kTextFrame)
+  {
+    out->append(payload, len);
+  }
+  else if (type == binarylog::kRecordFrame)
+  {
+    std::map<uint32_t, Site>::const_iterator it = sites_.end();
+    if (len >= BinaryLogger::kHeaderSize)
+    {
+      it = sites_.find(binaryRecordSite(payload, len));
+    }
+    LogStream line;
+    if (it == sites_.end() || !formatBinaryRecord(it->second.info, payload, len, tz_, &line))
+    {
+      ++numErrors_;
+    }
+    if (it != sites_.end())
+    {
+      out->append(line.buffer().data(), line.buffer().length());
+    }
+  }
+  else if (type == binarylog::kSiteFrame && len >= 4 + 1 + 4 + 2)
+  {
+    const char* p = payload;
+    const char* end = payload + len;
+    uint32_t id = load<uint32_t>(p);
+    Site& site = sites_[id];
+    site.info.level = static_cast<Logger::LogLevel>(load<uint8_t>(p + 4));
+    site.info.line = load<int32_t>(p + 5);
+    p += 9;
+    uint16_t fileLength = load<uint16_t>(p);
+    p += 2;
+    if (fileLength + 2 <= end - p)
+    {
+      site.file.assign(p, fileLength);
+      p += fileLength;
+      uint16_t funcLength = load<uint16_t>(p);
+      p += 2;
+      site.func.assign(p, std::min<size_t>(funcLength, static_cast<size_t>(end - p)));
+    }
+    else
+    {
+      ++numErrors_;
+    }
+    site.info.file = site.file;
+    site.info.func = site.func;
+  }
+  else
+  {
+    ++numErrors_;
+  }
+}
@@ -0,0 +1,280 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_BASE_BINARYLOGGING_H
+#define MUDUO_BASE_BINARYLOGGING_H
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/TimeZone.h>
+
+#include <atomic>
+#include <map>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Deferred logging: with MUDUO_LOG_DEFERRED defined before including
+/// Logging.h, LOG_TRACE to LOG_ERROR record which statement it is and
+/// the raw bytes of its arguments, and leave formatting to whoever
+/// consumes the record: AsyncLogging on its backend thread, or
+/// binarylog_decode from a log file of binary frames.  The formatted line
+/// is the one Logger writes.  LOG_FATAL and LOG_SYS* stay as they are.
+///
+/// Arguments take what LogStream takes, strings are copied, so a deferred
+/// statement costs some memcpy's instead of formatting.  Other types need
+/// an operator<< for BinaryLogStream.
+///
+
+/// What's known of a log statement at compile time.
+struct LogSiteInfo
+{
+  Logger::LogLevel level;
+  int line;
+  StringPiece file;  // basename
+  StringPiece func;  // empty unless TRACE or DEBUG
+};
+
+///
+/// A deferred log statement, a static per statement in the LOG_* macros.
+/// Numbered on first use, in this process.
+///
+class LogSite : noncopyable
+{
+ public:
+  static const uint32_t kMaxSites = 65535;
+
+  LogSite(Logger::SourceFile file, int line, Logger::LogLevel level)
+    : file_(file),
+      line_(line),
+      level_(level),
+      func_(NULL),
+      id_(0)
+  {
+  }
+
+  /// 0 if there are too many sites, the statement is formatted at once.
+  uint32_t id(const char* func)
+  {
+    uint32_t id = id_.load(std::memory_order_acquire);
+    return id != 0 ? id : registerSite(func);
+  }
+
+  LogSiteInfo info() const;
+
+  /// The site numbered @c id, NULL if none.
+  static const LogSite* find(uint32_t id);
+
+ private:
+  uint32_t registerSite(const char* func);
+
+  const Logger::SourceFile file_;
+  const int line_;
+  const Logger::LogLevel level_;
+  const char* func_;
+  std::atomic<uint32_t> id_;
+};
+
+///
+/// Arguments of a deferred statement, a type tag then the value.
+/// What doesn't fit in the buffer is dropped.
+///
+class BinaryLogStream : noncopyable
+{
+  typedef BinaryLogStream self;
+ public:
+  typedef LogStream::Buffer Buffer;
+
+  enum Tag
+  {
+    kBool = 1,
+    kChar,
+    kInt32,
+    kUint32,
+    kInt64,
+    kUint64,
+    kDouble,
+    kPointer,
+    kString,  // uint32_t length, then the bytes
+  };
+
+  self& operator<<(bool v) { return put(kBool, static_cast<uint8_t>(v)); }
+  self& operator<<(char v) { return put(kChar, v); }
+  self& operator<<(short v) { return put(kInt32, static_cast<int32_t>(v)); }
+  self& operator<<(unsigned short v) { return put(kUint32, static_cast<uint32_t>(v)); }
+  self& operator<<(int v) { return put(kInt32, static_cast<int32_t>(v)); }
+  self& operator<<(unsigned int v) { return put(kUint32, static_cast<uint32_t>(v)); }
+  self& operator<<(long v) { return put(kInt64, static_cast<int64_t>(v)); }
+  self& operator<<(unsigned long v) { return put(kUint64, static_cast<uint64_t>(v)); }
+  self& operator<<(long long v) { return put(kInt64, static_cast<int64_t>(v)); }
+  self& operator<<(unsigned long long v) { return put(kUint64, static_cast<uint64_t>(v)); }
+  self& operator<<(float v) { return put(kDouble, static_cast<double>(v)); }
+  self& operator<<(double v) { return put(kDouble, v); }
+  self& operator<<(const void* p) { return put(kPointer, reinterpret_cast<uintptr_t>(p)); }
+
+  self& operator<<(const char* str)
+  {
+    return str ? putString(str, strlen(str)) : putString("(null)", 6);
+  }
+
+  self& operator<<(const unsigned char* str)
+  {
+    return operator<<(reinterpret_cast<const char*>(str));
+  }
+
+  self& operator<<(const string& v) { return putString(v.data(), v.size()); }
+  self& operator<<(const StringPiece& v) { return putString(v.data(), v.size()); }
+  self& operator<<(const Buffer& v) { return putString(v.data(), v.length()); }
+
+  void append(const char* data, int len) { buffer_.append(data, len); }
+  const Buffer& buffer() const { return buffer_; }
+  void resetBuffer() { buffer_.reset(); }
+
+ private:
+  template<typename T>
+  self& put(Tag tag, T v)
+  {
+    if (static_cast<size_t>(buffer_.avail()) > 1 + sizeof v)
+    {
+      char* p = buffer_.current();
+      *p = static_cast<char>(tag);
+      ::memcpy(p + 1, &v, sizeof v);
+      buffer_.add(1 + sizeof v);
+    }
+    return *this;
+  }
+
+  self& putString(const char* data, size_t len);
+
+  Buffer buffer_;
+};
+
+inline BinaryLogStream& operator<<(BinaryLogStream& s, const Fmt& fmt)
+{
+  return s << StringPiece(fmt.data(), fmt.length());
+}
+
+///
+/// One deferred statement: site number, time and thread, then the
+/// arguments.  Handed to the output on destruction, or formatted and
+/// written through Logger's output if there is none.
+///
+class BinaryLogger : noncopyable
+{
+ public:
+  static const int kHeaderSize = 16;  // uint32_t site, int64_t micros, int32_t tid
+
+  BinaryLogger(LogSite& site, const char* func);
+  ~BinaryLogger();
+
+  BinaryLogStream& stream() { return stream_; }
+
+  typedef Logger::OutputFunc OutputFunc;
+  /// Receives whole records, AsyncLogging::appendBinary() for example.
+  static void setOutput(OutputFunc);
+  static OutputFunc output();
+
+ private:
+  LogSite& site_;
+  const char* func_;
+  BinaryLogStream stream_;
+};
+
+/// Time of a record, what AsyncLogging orders lines by.
+int64_t binaryRecordTime(const char* record, int len);
+
+/// Site number of a record.
+uint32_t binaryRecordSite(const char* record, int len);
+
+/// Formats a record of @c site the way Logger would have,
+/// with times in @c tz, or UTC if it isn't valid.
+/// Returns false if the record is malformed.
+bool formatBinaryRecord(const LogSiteInfo& site, const char* record, int len,
+                        const TimeZone& tz, LogStream* out);
+
+namespace binarylog
+{
+
+/// A log file of frames is what AsyncLogging writes with setWriteBinary():
+/// uint32_t payload length, a type byte, the payload.  A site frame
+/// comes before the first record of its site, in every LogFile::append().
+enum FrameType
+{
+  kSiteFrame = 'S',    // uint32_t id, uint8_t level, int32_t line,
+                       // uint16_t length and file, uint16_t length and func
+  kRecordFrame = 'B',  // a BinaryLogger record
+  kTextFrame = 'T',    // a formatted line
+};
+
+const int kFrameHeaderSize = 5;
+
+void writeFrameHeader(char* buf, FrameType type, int payloadLength);
+int siteFrameSize(const LogSiteInfo& site);
+/// Writes the whole site frame, header too, siteFrameSize() bytes.
+void writeSiteFrame(char* buf, uint32_t id, const LogSiteInfo& site);
+
+}  // namespace binarylog
+
+///
+/// Reads log files of frames back to text.
+///
+class BinaryLogDecoder : noncopyable
+{
+ public:
+  /// Times formatted in @c tz, or UTC if it isn't valid.
+  explicit BinaryLogDecoder(const TimeZone& tz);
+  ~BinaryLogDecoder();
+
+  /// Decodes the whole frames at the start of [data, data + len),
+  /// appending each line to @c out, returns the bytes decoded.
+  size_t decode(const char* data, size_t len, string* out);
+
+  /// Records of unknown sites or malformed, skipped.
+  int64_t numErrors() const { return numErrors_; }
+
+ private:
+  struct Site
+  {
+    LogSiteInfo info;
+    string file;
+    string func;
+  };
+
+  void decodeFrame(char type, const char* payload, int len, string* out);
+
+  const TimeZone tz_;
+  std::map<uint32_t, Site> sites_;
+  int64_t numErrors_;
+};
+
+}  // namespace muduo
+
+#define MUDUO_LOG_SITE(level) \
+  ([]() -> muduo::LogSite& { \
+     static muduo::LogSite site(__FILE__, __LINE__, level); \
+     return site; }())
+
+#define MUDUO_LOG_RECORD(level, func) \
+  muduo::BinaryLogger(MUDUO_LOG_SITE(level), func).stream()
+
+#ifdef MUDUO_LOG_DEFERRED
+#undef LOG_TRACE
+#undef LOG_DEBUG
+#undef LOG_INFO
+#undef LOG_WARN
+#undef LOG_ERROR
+#define LOG_TRACE if (muduo::Logger::logLevel() <= muduo::Logger::TRACE) \
+  MUDUO_LOG_RECORD(muduo::Logger::TRACE, __func__)
+#define LOG_DEBUG if (muduo::Logger::logLevel() <= muduo::Logger::DEBUG) \
+  MUDUO_LOG_RECORD(muduo::Logger::DEBUG, __func__)
+#define LOG_INFO if (muduo::Logger::logLevel() <= muduo::Logger::INFO) \
+  MUDUO_LOG_RECORD(muduo::Logger::INFO, NULL)
+#define LOG_WARN MUDUO_LOG_RECORD(muduo::Logger::WARN, NULL)
+#define LOG_ERROR MUDUO_LOG_RECORD(muduo::Logger::ERROR, NULL)
+#endif
+
+#endif  // MUDUO_BASE_BINARYLOGGING_H
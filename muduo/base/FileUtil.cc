@@ -6,31 +6,121 @@
 #include <muduo/base/FileUtil.h>
 #include <muduo/base/Logging.h> // strerror_tl
 
+#include <algorithm>
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 using namespace muduo;
 
-FileUtil::AppendFile::AppendFile(StringArg filename)
-  : fp_(::fopen(filename.c_str(), "ae")),  // 'e' for O_CLOEXEC
-    writtenBytes_(0)
+namespace
+{
+
+// O_DIRECT offsets, lengths and buffers are in multiples of this
+const size_t kDirectAlignment = 4096;
+// a 4MB block of AsyncLogging and the partial block before it
+const size_t kDirectBufferSize = 4 * 1024 * 1024;
+
+bool pwriteAll(int fd, const char* data, size_t len, off_t offset)
+{
+  while (len > 0)
+  {
+    ssize_t n = ::pwrite(fd, data, len, offset);
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      return false;
+    }
+    data += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+FileUtil::AppendFile::AppendFile(StringArg filename, Mode mode)
+  : fp_(NULL),
+    fd_(-1),
+    mode_(mode),
+    writtenBytes_(0),
+    direct_(NULL),
+    tail_(0),
+    tailOffset_(0)
 {
-  assert(fp_);
-  ::setbuffer(fp_, buffer_, sizeof buffer_);
-  // posix_fadvise POSIX_FADV_DONTNEED ?
+  if (mode_ == kBuffered)
+  {
+    fp_ = ::fopen(filename.c_str(), "ae");  // 'e' for O_CLOEXEC
+    assert(fp_);
+    ::setbuffer(fp_, buffer_, sizeof buffer_);
+    // posix_fadvise POSIX_FADV_DONTNEED ?
+    return;
+  }
+
+  if (mode_ == kDirect)
+  {
+    // no O_APPEND, the last block is rewritten in place
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | O_DIRECT, 0666);
+    struct stat statbuf;
+    void* buf = NULL;
+    if (fd_ >= 0
+        && ::fstat(fd_, &statbuf) == 0
+        && statbuf.st_size % kDirectAlignment == 0
+        && ::posix_memalign(&buf, kDirectAlignment, kDirectBufferSize) == 0)
+    {
+      direct_ = static_cast<char*>(buf);
+      tailOffset_ = statbuf.st_size;
+    }
+    else
+    {
+      // tmpfs for one, or a file with a partial block to begin with
+      if (fd_ >= 0)
+      {
+        ::close(fd_);
+        fd_ = -1;
+      }
+      mode_ = kBlocks;
+    }
+  }
+  if (fd_ < 0)
+  {
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+  }
+  assert(fd_ >= 0);
 }
 
 FileUtil::AppendFile::~AppendFile()
 {
-  ::fclose(fp_);
+  if (fp_)
+  {
+    ::fclose(fp_);
+  }
+  else
+  {
+    ::free(direct_);
+    ::close(fd_);
+  }
 }
 
 void FileUtil::AppendFile::append(const char* logline, const size_t len)
 {
+  if (direct_)
+  {
+    writeDirect(logline, len);
+    writtenBytes_ += len;
+    return;
+  }
+
   size_t n = write(logline, len);
   size_t remain = len - n;
   while (remain > 0)
@@ -38,7 +128,7 @@ void FileUtil::AppendFile::append(const char* logline, const size_t len)
     size_t x = write(logline + n, remain);
     if (x == 0)
     {
-      int err = ferror(fp_);
+      int err = fp_ ? ferror(fp_) : errno;
       if (err)
       {
         fprintf(stderr, "AppendFile::append() failed %s\n", strerror_tl(err));
@@ -54,13 +144,59 @@ void FileUtil::AppendFile::append(const char* logline, const size_t len)
 
 void FileUtil::AppendFile::flush()
 {
-  ::fflush(fp_);
+  // nothing is buffered otherwise
+  if (fp_)
+  {
+    ::fflush(fp_);
+  }
+}
+
+int FileUtil::AppendFile::fd() const
+{
+  return fp_ ? ::fileno(fp_) : fd_;
 }
 
 size_t FileUtil::AppendFile::write(const char* logline, size_t len)
 {
-  // #undef fwrite_unlocked
-  return ::fwrite_unlocked(logline, 1, len, fp_);
+  if (fp_)
+  {
+    // #undef fwrite_unlocked
+    return ::fwrite_unlocked(logline, 1, len, fp_);
+  }
+  ssize_t n = 0;
+  do
+  {
+    n = ::write(fd_, logline, len);
+  } while (n < 0 && errno == EINTR);
+  return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+void FileUtil::AppendFile::writeDirect(const char* data, size_t len)
+{
+  while (len > 0)
+  {
+    size_t n = std::min(len, kDirectBufferSize - tail_);
+    ::memcpy(direct_ + tail_, data, n);
+    tail_ += n;
+    data += n;
+    len -= n;
+
+    // whole blocks only while there's more to come, the last one padded
+    size_t whole = tail_ / kDirectAlignment * kDirectAlignment;
+    size_t toWrite = len > 0 ? whole
+        : (tail_ + kDirectAlignment - 1) / kDirectAlignment * kDirectAlignment;
+    ::memset(direct_ + tail_, 0, toWrite - std::min(toWrite, tail_));
+    if (!pwriteAll(fd_, direct_, toWrite, tailOffset_)
+        || (toWrite > tail_ && ::ftruncate(fd_, tailOffset_ + static_cast<off_t>(tail_)) != 0))
+    {
+      fprintf(stderr, "AppendFile::append() failed %s\n", strerror_tl(errno));
+      tail_ = 0;
+      return;
+    }
+    ::memmove(direct_, direct_ + whole, tail_ - whole);
+    tailOffset_ += static_cast<off_t>(whole);
+    tail_ -= whole;
+  }
 }
 
 FileUtil::ReadSmallFile::ReadSmallFile(StringArg filename)
@@ -63,7 +63,14 @@ int readFile(StringArg filename,
 class AppendFile : noncopyable
 {
  public:
-  explicit AppendFile(StringArg filename);
+  enum Mode
+  {
+    kBuffered,  // through stdio, for many short appends
+    kBlocks,    // a write(2) per append(), for callers that buffer already
+    kDirect,    // kBlocks with O_DIRECT, bypassing the page cache
+  };
+
+  explicit AppendFile(StringArg filename, Mode mode = kBuffered);
 
   ~AppendFile();
 
@@ -73,13 +80,26 @@ class AppendFile : noncopyable
 
   off_t writtenBytes() const { return writtenBytes_; }
 
+  /// kBlocks if O_DIRECT isn't supported for the file.
+  Mode mode() const { return mode_; }
+  int fd() const;
+
  private:
 
   size_t write(const char* logline, size_t len);
+  void writeDirect(const char* data, size_t len);
 
   FILE* fp_;
+  int fd_;
+  Mode mode_;
   char buffer_[64*1024];
   off_t writtenBytes_;
+
+  // kDirect: aligned, starts with the last partial block of the file,
+  // tail_ bytes long, which is rewritten as the file grows.
+  char* direct_;
+  size_t tail_;
+  off_t tailOffset_;
 };
 
 }  // namespace FileUtil
@@ -0,0 +1,220 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_INPLACEFUNCTION_H
+#define MUDUO_BASE_INPLACEFUNCTION_H
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace muduo
+{
+
+template<typename Signature, size_t Capacity = 64>
+class InplaceFunction;
+
+///
+/// A move-only std::function, callables up to @c Capacity bytes are stored
+/// inline, bigger ones or those which may throw on move go to the heap.
+///
+/// Like std::function, the result of the callable is discarded if R is void,
+/// a null function pointer or an empty std::function makes an empty one,
+/// and calling an empty one throws std::bad_function_call.
+///
+/// std::function allocates for anything bigger than two pointers, e.g.
+/// std::bind(&TcpConnection::sendInLoop, this, string), and must be copyable,
+/// so it can't hold a moved-in std::unique_ptr.
+///
+template<typename R, typename... ARGS, size_t Capacity>
+class InplaceFunction<R (ARGS...), Capacity>
+{
+ public:
+  InplaceFunction() noexcept
+    : ops_(NULL)
+  {
+  }
+
+  InplaceFunction(std::nullptr_t) noexcept
+    : ops_(NULL)
+  {
+  }
+
+  template<typename F,
+           typename = typename std::enable_if<
+               !std::is_same<typename std::decay<F>::type, InplaceFunction>::value>::type>
+  InplaceFunction(F&& f)
+    : ops_(NULL)
+  {
+    typedef typename std::decay<F>::type Functor;
+    if (!isNull(f))
+    {
+      Ops<Functor>::construct(&storage_, std::forward<F>(f));
+      ops_ = &Ops<Functor>::kOps;
+    }
+  }
+
+  InplaceFunction(InplaceFunction&& rhs) noexcept
+    : ops_(rhs.ops_)
+  {
+    if (ops_)
+    {
+      ops_->move(&storage_, &rhs.storage_);
+      rhs.ops_ = NULL;
+    }
+  }
+
+  InplaceFunction& operator=(InplaceFunction&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      reset();
+      if (rhs.ops_)
+      {
+        rhs.ops_->move(&storage_, &rhs.storage_);
+        ops_ = rhs.ops_;
+        rhs.ops_ = NULL;
+      }
+    }
+    return *this;
+  }
+
+  InplaceFunction& operator=(std::nullptr_t) noexcept
+  {
+    reset();
+    return *this;
+  }
+
+  InplaceFunction(const InplaceFunction&) = delete;
+  InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+  ~InplaceFunction()
+  {
+    reset();
+  }
+
+  explicit operator bool() const noexcept
+  {
+    return ops_ != NULL;
+  }
+
+  R operator()(ARGS... args) const
+  {
+    if (ops_ == NULL)
+    {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke(const_cast<Storage*>(&storage_), std::forward<ARGS>(args)...);
+  }
+
+ private:
+  typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type Storage;
+
+  struct OpsTable
+  {
+    R (*invoke)(Storage*, ARGS&&...);
+    void (*move)(Storage* to, Storage* from);  // leaves from destroyed
+    void (*destroy)(Storage*);
+  };
+
+  template<typename F>
+  struct Inline
+  {
+    static const bool value = sizeof(F) <= sizeof(Storage)
+        && alignof(F) <= alignof(Storage)
+        && std::is_nothrow_move_constructible<F>::value;
+  };
+
+  template<typename F, bool = Inline<F>::value>
+  struct Ops
+  {
+    static F* get(Storage* s)
+    { return static_cast<F*>(static_cast<void*>(s)); }
+
+    template<typename G>
+    static void construct(Storage* s, G&& f)
+    { new (s) F(std::forward<G>(f)); }
+
+    static R invoke(Storage* s, ARGS&&... args)
+    { return static_cast<R>((*get(s))(std::forward<ARGS>(args)...)); }
+
+    static void move(Storage* to, Storage* from)
+    {
+      new (to) F(std::move(*get(from)));
+      get(from)->~F();
+    }
+
+    static void destroy(Storage* s)
+    { get(s)->~F(); }
+
+    static const OpsTable kOps;
+  };
+
+  template<typename F>
+  struct Ops<F, false>
+  {
+    static F*& get(Storage* s)
+    { return *static_cast<F**>(static_cast<void*>(s)); }
+
+    template<typename G>
+    static void construct(Storage* s, G&& f)
+    { new (s) F*(new F(std::forward<G>(f))); }
+
+    static R invoke(Storage* s, ARGS&&... args)
+    { return static_cast<R>((*get(s))(std::forward<ARGS>(args)...)); }
+
+    static void move(Storage* to, Storage* from)
+    { new (to) F*(get(from)); }
+
+    static void destroy(Storage* s)
+    { delete get(s); }
+
+    static const OpsTable kOps;
+  };
+
+  template<typename F>
+  static bool isNull(const F&) noexcept
+  { return false; }
+
+  template<typename F>
+  static bool isNull(F* f) noexcept
+  { return f == NULL; }
+
+  template<typename S>
+  static bool isNull(const std::function<S>& f) noexcept
+  { return !f; }
+
+  void reset() noexcept
+  {
+    if (ops_)
+    {
+      ops_->destroy(&storage_);
+      ops_ = NULL;
+    }
+  }
+
+  const OpsTable* ops_;
+  Storage storage_;
+};
+
+template<typename R, typename... ARGS, size_t Capacity>
+template<typename F, bool B>
+const typename InplaceFunction<R (ARGS...), Capacity>::OpsTable
+InplaceFunction<R (ARGS...), Capacity>::Ops<F, B>::kOps =
+{
+  &Ops<F, B>::invoke, &Ops<F, B>::move, &Ops<F, B>::destroy
+};
+
+template<typename R, typename... ARGS, size_t Capacity>
+template<typename F>
+const typename InplaceFunction<R (ARGS...), Capacity>::OpsTable
+InplaceFunction<R (ARGS...), Capacity>::Ops<F, false>::kOps =
+{
+  &Ops<F, false>::invoke, &Ops<F, false>::move, &Ops<F, false>::destroy
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_INPLACEFUNCTION_H
@@ -0,0 +1,438 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_LOCKFREEBOUNDEDQUEUE_H
+#define MUDUO_BASE_LOCKFREEBOUNDEDQUEUE_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+
+namespace muduo
+{
+namespace detail
+{
+
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+inline size_t roundUpPowerOf2(size_t n)
+{
+  size_t capacity = 2;
+  while (capacity < n)
+  {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+template<typename T, bool SPSC>
+class Ring;
+
+/// Multi-producer multi-consumer, D. Vyukov's bounded queue:
+/// every cell has a sequence number telling whose turn it is, so a put
+/// or a take is one CAS on its position plus a store to the cell.
+template<typename T>
+class Ring<T, false> : noncopyable
+{
+ public:
+  explicit Ring(size_t maxSize)
+    : mask_(roundUpPowerOf2(maxSize) - 1),
+      cells_(new Cell[mask_ + 1]),
+      enqueuePos_(0),
+      dequeuePos_(0)
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~Ring()
+  {
+    size_t end = enqueuePos_.load(std::memory_order_relaxed);
+    for (size_t pos = dequeuePos_.load(std::memory_order_relaxed); pos != end; ++pos)
+    {
+      Cell& cell = cells_[pos & mask_];
+      if (cell.sequence.load(std::memory_order_relaxed) == pos + 1)
+      {
+        cell.get()->~T();
+      }
+    }
+  }
+
+  template<typename U>
+  bool tryPut(U&& x)
+  {
+    Cell* cell = NULL;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (dif == 0)
+      {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (dif < 0)
+      {
+        return false;  // full
+      }
+      else
+      {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::forward<U>(x));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryTake(T* x)
+  {
+    Cell* cell = NULL;
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (dif == 0)
+      {
+        if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          break;
+        }
+      }
+      else if (dif < 0)
+      {
+        return false;  // empty
+      }
+      else
+      {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* p = cell->get();
+    *x = std::move(*p);
+    p->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const
+  {
+    size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+    size_t head = dequeuePos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T* get() { return static_cast<T*>(static_cast<void*>(&storage)); }
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+  char pad0_[64];
+  std::atomic<size_t> enqueuePos_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeuePos_;
+  char pad2_[64 - sizeof(std::atomic<size_t>)];
+};
+
+/// Single-producer single-consumer, Lamport's ring: each side owns its
+/// index and caches the other's, so most calls touch no shared line.
+template<typename T>
+class Ring<T, true> : noncopyable
+{
+ public:
+  explicit Ring(size_t maxSize)
+    : mask_(roundUpPowerOf2(maxSize) - 1),
+      slots_(new Slot[mask_ + 1]),
+      tail_(0),
+      headCache_(0),
+      head_(0),
+      tailCache_(0)
+  {
+  }
+
+  ~Ring()
+  {
+    size_t end = tail_.load(std::memory_order_relaxed);
+    for (size_t pos = head_.load(std::memory_order_relaxed); pos != end; ++pos)
+    {
+      get(pos)->~T();
+    }
+  }
+
+  template<typename U>
+  bool tryPut(U&& x)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - headCache_ > mask_)
+    {
+      headCache_ = head_.load(std::memory_order_acquire);
+      if (tail - headCache_ > mask_)
+      {
+        return false;  // full
+      }
+    }
+    new (&slots_[tail & mask_]) T(std::forward<U>(x));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryTake(T* x)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tailCache_)
+    {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (head == tailCache_)
+      {
+        return false;  // empty
+      }
+    }
+    T* p = get(head);
+    *x = std::move(*p);
+    p->~T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const
+  {
+    return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_relaxed);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+  T* get(size_t pos) { return static_cast<T*>(static_cast<void*>(&slots_[pos & mask_])); }
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  char pad0_[64];
+  // producer side
+  std::atomic<size_t> tail_;
+  size_t headCache_;
+  char pad1_[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+  // consumer side
+  std::atomic<size_t> head_;
+  size_t tailCache_;
+  char pad2_[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+}  // namespace detail
+
+///
+/// Bounded lock-free queue, for pipelines between I/O loops and compute
+/// threads where BoundedBlockingQueue's mutex is the bottleneck.
+///
+/// Multi-producer multi-consumer, or with @c SPSC one producer thread and
+/// one consumer thread only, which is cheaper.  The capacity is rounded up
+/// to a power of 2.
+///
+/// Three flavours of every operation:
+/// - tryPut() and tryTake() never wait.
+/// - spinPut() and spinTake() busy-wait, for threads owning a core.
+/// - put() and take() spin a little (not on a single CPU) then block.  The mutex is only taken
+///   on the slow path, and by the other side when it sees a blocked waiter.
+///
+template<typename T, bool SPSC = false>
+class LockFreeBoundedQueue : noncopyable
+{
+ public:
+  explicit LockFreeBoundedQueue(size_t maxSize)
+    : ring_(maxSize),
+      spinCount_(::sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 128 : 0),
+      putWaiting_(false),
+      takeWaiting_(false),
+      mutex_(),
+      notEmpty_(mutex_),
+      notFull_(mutex_)
+  {
+  }
+
+  bool tryPut(const T& x) { return putAndSignal(x); }
+  bool tryPut(T&& x) { return putAndSignal(std::move(x)); }
+
+  bool tryTake(T* x) { return takeAndSignal(x); }
+
+  void spinPut(const T& x)
+  {
+    while (!putAndSignal(x))
+    {
+      detail::cpuRelax();
+    }
+  }
+
+  void spinPut(T&& x)
+  {
+    while (!putAndSignal(std::move(x)))  // not moved from unless put
+    {
+      detail::cpuRelax();
+    }
+  }
+
+  T spinTake()
+  {
+    T x;
+    while (!takeAndSignal(&x))
+    {
+      detail::cpuRelax();
+    }
+    return x;
+  }
+
+  void put(const T& x) { blockingPut(x); }
+  void put(T&& x) { blockingPut(std::move(x)); }
+
+  T take()
+  {
+    T x;
+    for (int i = 0; i < spinCount_; ++i)
+    {
+      if (takeAndSignal(&x))
+      {
+        return x;
+      }
+      detail::cpuRelax();
+    }
+    {
+      MutexLockGuard lock(mutex_);
+      for (;;)
+      {
+        takeWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_.tryTake(&x))
+        {
+          break;
+        }
+        notEmpty_.wait();
+      }
+    }
+    signalNotFull();
+    return x;
+  }
+
+  /// Approximate while other threads put or take.
+  size_t size() const { return ring_.size(); }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() >= capacity(); }
+  size_t capacity() const { return ring_.capacity(); }
+
+ private:
+  template<typename U>
+  bool putAndSignal(U&& x)
+  {
+    if (ring_.tryPut(std::forward<U>(x)))
+    {
+      signalNotEmpty();
+      return true;
+    }
+    return false;
+  }
+
+  bool takeAndSignal(T* x)
+  {
+    if (ring_.tryTake(x))
+    {
+      signalNotFull();
+      return true;
+    }
+    return false;
+  }
+
+  template<typename U>
+  void blockingPut(U&& x)
+  {
+    for (int i = 0; i < spinCount_; ++i)
+    {
+      if (putAndSignal(std::forward<U>(x)))
+      {
+        return;
+      }
+      detail::cpuRelax();
+    }
+    {
+      MutexLockGuard lock(mutex_);
+      for (;;)
+      {
+        putWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_.tryPut(std::forward<U>(x)))
+        {
+          break;
+        }
+        notFull_.wait();
+      }
+    }
+    signalNotEmpty();
+  }
+
+  // A waiter raises the flag, then tries once more under mutex_ before
+  // waiting, the other side publishes, then checks the flag: with the
+  // fences in between, either the waiter sees the element or the other
+  // side sees the flag.  Clearing the flag makes it one wakeup per wait,
+  // not one per element while the waiters are not scheduled yet.
+  void signalNotEmpty()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (takeWaiting_.load(std::memory_order_relaxed)
+        && takeWaiting_.exchange(false))
+    {
+      MutexLockGuard lock(mutex_);
+      notEmpty_.notifyAll();
+    }
+  }
+
+  void signalNotFull()
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (putWaiting_.load(std::memory_order_relaxed)
+        && putWaiting_.exchange(false))
+    {
+      MutexLockGuard lock(mutex_);
+      notFull_.notifyAll();
+    }
+  }
+
+  detail::Ring<T, SPSC> ring_;
+  const int spinCount_;  // no point spinning for a thread that can't run
+  std::atomic<bool> putWaiting_;
+  std::atomic<bool> takeWaiting_;
+  mutable MutexLock mutex_;
+  Condition notEmpty_ GUARDED_BY(mutex_);
+  Condition notFull_ GUARDED_BY(mutex_);
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_LOCKFREEBOUNDEDQUEUE_H
@@ -0,0 +1,192 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/LogCompressor.h>
+
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/GzipFile.h>
+#include <muduo/base/Logging.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+namespace
+{
+
+const int kBufferSize = 256 * 1024;
+
+// from <linux/ioprio.h>
+const int kIoprioWhoProcess = 1;
+const int kIoprioClassIdle = 3;
+const int kIoprioClassShift = 13;
+
+struct OldFile
+{
+  string name;
+  off_t size;
+
+  bool operator<(const OldFile& rhs) const { return name < rhs.name; }
+};
+
+}  // namespace
+
+LogCompressor::LogCompressor(const string& basename, int maxFiles, int64_t maxBytes)
+  : basename_(basename),
+    maxFiles_(maxFiles),
+    maxBytes_(maxBytes),
+    queue_(),
+    thread_(std::bind(&LogCompressor::threadFunc, this), "LogCompressor")
+{
+  assert(basename.find('/') == string::npos);
+  thread_.start();
+}
+
+LogCompressor::~LogCompressor()
+{
+  queue_.put(string());
+  thread_.join();
+}
+
+void LogCompressor::compress(const string& filename)
+{
+  if (!filename.empty())
+  {
+    queue_.put(filename);
+  }
+}
+
+void LogCompressor::threadFunc()
+{
+  // for this thread only, the nicest CPU and I/O priorities
+  if (::setpriority(PRIO_PROCESS, CurrentThread::tid(), 19) != 0)
+  {
+    LOG_SYSERR << "LogCompressor setpriority";
+  }
+  if (::syscall(SYS_ioprio_set, kIoprioWhoProcess, CurrentThread::tid(),
+                kIoprioClassIdle << kIoprioClassShift) != 0)
+  {
+    LOG_SYSERR << "LogCompressor ioprio_set";
+  }
+
+  while (true)
+  {
+    string filename(queue_.take());
+    if (filename.empty())
+    {
+      break;
+    }
+    if (compressFile(filename))
+    {
+      removeOldFiles();
+    }
+  }
+}
+
+bool LogCompressor::compressFile(const string& filename)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    LOG_SYSERR << "LogCompressor open " << filename;
+    return false;
+  }
+
+  // renamed once whole, a .gz is never cut short
+  string tmpname = filename + ".gz.tmp";
+  bool ok = false;
+  {
+    GzipFile out = GzipFile::openForWriteTruncate(tmpname);
+    if (out.valid())
+    {
+#if ZLIB_VERNUM >= 0x1240
+      out.setBuffer(kBufferSize);
+#endif
+      std::vector<char> buf(kBufferSize);
+      off_t offset = 0;
+      ssize_t n = 0;
+      ok = true;
+      while (ok && (n = ::read(fd, &buf[0], buf.size())) > 0)
+      {
+        ok = out.write(StringPiece(&buf[0], static_cast<int>(n))) == n;
+        // read once, not worth the page cache
+        ::posix_fadvise(fd, offset, n, POSIX_FADV_DONTNEED);
+        offset += n;
+      }
+      ok = ok && n == 0;
+    }
+  }
+  ::close(fd);
+
+  if (ok
+      && ::rename(tmpname.c_str(), (filename + ".gz").c_str()) == 0
+      && ::unlink(filename.c_str()) == 0)
+  {
+    return true;
+  }
+  LOG_SYSERR << "LogCompressor failed to compress " << filename;
+  ::unlink(tmpname.c_str());
+  return false;
+}
+
+void LogCompressor::removeOldFiles()
+{
+  if (maxFiles_ <= 0 && maxBytes_ <= 0)
+  {
+    return;
+  }
+
+  // basename.20181121-060448.host.pid.log.gz, as LogFile names them
+  const string prefix = basename_ + ".";
+  const string suffix = ".gz";
+  std::vector<OldFile> files;
+  DIR* dir = ::opendir(".");
+  if (dir == NULL)
+  {
+    LOG_SYSERR << "LogCompressor opendir";
+    return;
+  }
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    string name(entry->d_name);
+    struct stat statbuf;
+    if (name.size() > prefix.size() + suffix.size()
+        && name.compare(0, prefix.size(), prefix) == 0
+        && isdigit(name[prefix.size()])
+        && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0
+        && ::stat(name.c_str(), &statbuf) == 0
+        && S_ISREG(statbuf.st_mode))
+    {
+      OldFile file = { name, statbuf.st_size };
+      files.push_back(file);
+    }
+  }
+  ::closedir(dir);
+
+  // newest first
+  std::sort(files.rbegin(), files.rend());
+  int64_t bytes = 0;
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    bytes += files[i].size;
+    if ((maxFiles_ > 0 && i >= static_cast<size_t>(maxFiles_))
+        || (maxBytes_ > 0 && bytes > maxBytes_))
+    {
+      if (::unlink(files[i].name.c_str()) != 0)
+      {
+        LOG_SYSERR << "LogCompressor unlink " << files[i].name;
+      }
+    }
+  }
+}
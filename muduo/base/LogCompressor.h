@@ -0,0 +1,57 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_BASE_LOGCOMPRESSOR_H
+#define MUDUO_BASE_LOGCOMPRESSOR_H
+
+#include <muduo/base/BlockingQueue.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Types.h>
+
+#include <sys/types.h>
+
+namespace muduo
+{
+
+///
+/// Gzips log files rolled over by LogFile, on a thread of its own at idle
+/// CPU and I/O priority, so neither the thread appending nor the disk
+/// of it waits for compression.  basename.X.log becomes basename.X.log.gz,
+/// then the oldest .gz files of basename in the current directory are
+/// deleted beyond maxFiles or maxBytes in all, whichever comes first.
+///
+/// Built with zlib only.
+///
+/// @code
+/// LogCompressor compressor("server", 30, 10*1000*1000*1000LL);
+/// asyncLog.setRollCallback(std::bind(&LogCompressor::compress, &compressor, _1));
+/// @endcode
+///
+class LogCompressor : noncopyable
+{
+ public:
+  /// Zero for no limit.
+  LogCompressor(const string& basename, int maxFiles, int64_t maxBytes);
+  /// Finishes the files queued.
+  ~LogCompressor();
+
+  /// Queues a finished file, a LogFile::RollCallback.  Thread safe.
+  void compress(const string& filename);
+
+ private:
+  void threadFunc();
+  bool compressFile(const string& filename);
+  void removeOldFiles();
+
+  const string basename_;
+  const int maxFiles_;
+  const int64_t maxBytes_;
+  BlockingQueue<string> queue_;  // an empty name to stop
+  Thread thread_;
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_LOGCOMPRESSOR_H
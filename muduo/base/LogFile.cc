@@ -5,29 +5,143 @@
 
 #include <muduo/base/LogFile.h>
 
-#include <muduo/base/FileUtil.h>
+#include <muduo/base/Condition.h>
+#include <muduo/base/Logging.h>  // strerror_tl
 #include <muduo/base/ProcessInfo.h>
+#include <muduo/base/Thread.h>
+
+#include <vector>
 
 #include <assert.h>
+#include <errno.h>
 #include <stdio.h>
 #include <time.h>
+#include <unistd.h>
 
 using namespace muduo;
 
+class LogFile::Syncer : noncopyable
+{
+ public:
+  Syncer()
+    : thread_(std::bind(&Syncer::threadFunc, this), "LogFileSync"),
+      mutex_(),
+      cond_(mutex_),
+      running_(true),
+      fd_(-1),
+      syncPending_(false)
+  {
+    thread_.start();
+  }
+
+  ~Syncer()
+  {
+    {
+      MutexLockGuard lock(mutex_);
+      running_ = false;
+      cond_.notify();
+    }
+    thread_.join();
+  }
+
+  /// Syncs and closes the file before in the background, syncs fd from now on.
+  void setFile(int fd)
+  {
+    int dupFd = ::dup(fd);  // the caller closes fd whenever it rolls
+    if (dupFd < 0)
+    {
+      fprintf(stderr, "LogFile::Syncer::setFile() failed %s\n", strerror_tl(errno));
+    }
+    MutexLockGuard lock(mutex_);
+    if (fd_ >= 0)
+    {
+      closing_.push_back(fd_);
+    }
+    fd_ = dupFd;
+    cond_.notify();
+  }
+
+  void sync()
+  {
+    MutexLockGuard lock(mutex_);
+    syncPending_ = true;
+    cond_.notify();
+  }
+
+ private:
+  void threadFunc()
+  {
+    bool running = true;
+    while (running)
+    {
+      std::vector<int> closing;
+      int fd = -1;
+      bool sync = false;
+      {
+        MutexLockGuard lock(mutex_);
+        while (running_ && !syncPending_ && closing_.empty())
+        {
+          cond_.wait();
+        }
+        running = running_;
+        sync = syncPending_ || !running;
+        syncPending_ = false;
+        closing.swap(closing_);
+        fd = fd_;  // only closed by this thread, after it's in closing_
+      }
+
+      for (int old : closing)
+      {
+        datasync(old);
+        ::close(old);
+      }
+      if (sync && fd >= 0)
+      {
+        datasync(fd);
+      }
+    }
+
+    MutexLockGuard lock(mutex_);
+    if (fd_ >= 0)
+    {
+      ::close(fd_);
+    }
+  }
+
+  static void datasync(int fd)
+  {
+    if (::fdatasync(fd) != 0)
+    {
+      fprintf(stderr, "LogFile::Syncer fdatasync() failed %s\n", strerror_tl(errno));
+    }
+  }
+
+  Thread thread_;
+  MutexLock mutex_;
+  Condition cond_ GUARDED_BY(mutex_);
+  bool running_ GUARDED_BY(mutex_);
+  int fd_ GUARDED_BY(mutex_);
+  bool syncPending_ GUARDED_BY(mutex_);
+  std::vector<int> closing_ GUARDED_BY(mutex_);
+};
+
 LogFile::LogFile(const string& basename,
                  off_t rollSize,
                  bool threadSafe,
                  int flushInterval,
-                 int checkEveryN)
+                 int checkEveryN,
+                 FileUtil::AppendFile::Mode mode)
   : basename_(basename),
     rollSize_(rollSize),
     flushInterval_(flushInterval),
     checkEveryN_(checkEveryN),
+    mode_(mode),
     count_(0),
     mutex_(threadSafe ? new MutexLock : NULL),
     startOfPeriod_(0),
     lastRoll_(0),
-    lastFlush_(0)
+    lastFlush_(0),
+    syncer_(mode != FileUtil::AppendFile::kBuffered ? new Syncer : NULL)
 {
   // 断言basename不包含/
   assert(basename.find('/') == string::npos);
@@ -55,11 +169,20 @@ void LogFile::flush()
   if (mutex_)
   {
     MutexLockGuard lock(*mutex_);
-    file_->flush();
+    flush_unlocked();
   }
   else
   {
-    file_->flush();
+    flush_unlocked();
+  }
+}
+
+void LogFile::flush_unlocked()
+{
+  file_->flush();
+  if (syncer_)
+  {
+    syncer_->sync();
   }
 }
 
@@ -88,7 +211,7 @@ void LogFile::append_unlocked(const char* logline, int len)
       else if (now - lastFlush_ > flushInterval_)//不滚动，是否超过了flush的间隔，超过了就flush
       {
         lastFlush_ = now;
-        file_->flush();
+        flush_unlocked();
       }
     }
   }
@@ -108,7 +231,16 @@ bool LogFile::rollFile()
     lastRoll_ = now;
     lastFlush_ = now;
     startOfPeriod_ = start;
-    file_.reset(new FileUtil::AppendFile(filename));
+    file_.reset(new FileUtil::AppendFile(filename, mode_));
+    if (syncer_)
+    {
+      syncer_->setFile(file_->fd());
+    }
+    filename.swap(filename_);
+    if (rollCallback_ && !filename.empty())
+    {
+      rollCallback_(filename);
+    }
     return true;
   }
   return false;
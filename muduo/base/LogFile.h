@@ -6,19 +6,27 @@
 #ifndef MUDUO_BASE_LOGFILE_H
 #define MUDUO_BASE_LOGFILE_H
 
+#include <muduo/base/FileUtil.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Types.h>
 
+#include <functional>
 #include <memory>
 
 namespace muduo
 {
 
-namespace FileUtil
-{
-class AppendFile;
-}
-
+///
+/// Appends to basename.time.host.pid.log in the current directory, rolled
+/// over every rollSize bytes and every day.  The roll callback gets the
+/// name of each file rolled over, finished, LogCompressor::compress()
+/// for one.
+///
+/// With a mode other than kBuffered, for callers appending whole blocks,
+/// flush() has the file fdatasync()'ed on a thread of its own, which is
+/// also where a rolled file is synced and closed, so the caller doesn't
+/// wait for the disk.
+///
 class LogFile : noncopyable
 {
  public:
@@ -26,9 +34,14 @@ class LogFile : noncopyable
           off_t rollSize,
           bool threadSafe = true,
           int flushInterval = 3,
-          int checkEveryN = 1024);
+          int checkEveryN = 1024,
+          FileUtil::AppendFile::Mode mode = FileUtil::AppendFile::kBuffered);
   ~LogFile();
 
+  typedef std::function<void(const string& filename)> RollCallback;
+  /// Called in the thread that appends.
+  void setRollCallback(const RollCallback& cb) { rollCallback_ = cb; }
+
 // 将logline行，长度len添加到日志文件中
   void append(const char* logline, int len);
 //   清空缓冲区
@@ -39,6 +52,9 @@ class LogFile : noncopyable
  private:
 //  不加锁的方式添加
   void append_unlocked(const char* logline, int len);
+  void flush_unlocked();
+
+  class Syncer;
 
 // 获取日志文件的名称
   static string getLogFileName(const string& basename, time_t* now);
@@ -52,6 +68,7 @@ logfile_test.20181121-060448.pp-vb.83707.log
   const off_t rollSize_; //日志文件达到rollSize_换一个文件
   const int flushInterval_; //日志写入间隔时间
   const int checkEveryN_;
+  const FileUtil::AppendFile::Mode mode_;
 
   int count_; //计数器，初始值为0，当达到
 
@@ -60,7 +77,10 @@ logfile_test.20181121-060448.pp-vb.83707.log
 //   只要在一天之内，调整为0点的时间距离1970年1月1日0点时间相同，不会滚动
   time_t lastRoll_; //上一次滚动日志文件时间
   time_t lastFlush_;//上一次日志写入文件时间
+  std::unique_ptr<Syncer> syncer_;  // declared before file_, outlives it
   std::unique_ptr<FileUtil::AppendFile> file_; 
+  string filename_;
+  RollCallback rollCallback_;
 
   const static int kRollPerSeconds_ = 60*60*24;//一天
 };
@@ -16,7 +16,6 @@
 using namespace muduo;
 using namespace muduo::detail;
 
-// TODO: better itoa.
 #if defined(__clang__)
 #pragma clang diagnostic ignored "-Wtautological-compare"
 #else
@@ -28,36 +27,57 @@ namespace muduo
 namespace detail
 {
 
-const char digits[] = "9876543210123456789";
-const char* zero = digits + 9;
-static_assert(sizeof(digits) == 20, "wrong number of digits");
+const char kDigitPairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
 
 const char digitsHex[] = "0123456789ABCDEF";
 static_assert(sizeof digitsHex == 17, "wrong number of digitsHex");
 
-// Efficient Integer to String Conversions, by Matthew Wilson.
+// Two digits per division, from the back of a scratch buffer,
+// as in Efficient Integer to String Conversions, by Matthew Wilson.
 template<typename T>
 size_t convert(char buf[], T value)
 {
-  T i = value;
-  char* p = buf;
+  typedef typename std::make_unsigned<T>::type U;
+  U i = value < 0 ? static_cast<U>(0 - static_cast<U>(value)) : static_cast<U>(value);
+  char scratch[24];
+  char* const end = scratch + sizeof scratch;
+  char* p = end;
 
-  do
+  while (i >= 100)
   {
-    // last digit
-    int lsd = static_cast<int>(i % 10);
-    i /= 10;
-    *p++ = zero[lsd];
-  } while (i != 0);
+    p -= 2;
+    memcpy(p, kDigitPairs + static_cast<size_t>(i % 100) * 2, 2);
+    i /= 100;
+  }
+  if (i >= 10)
+  {
+    p -= 2;
+    memcpy(p, kDigitPairs + static_cast<size_t>(i) * 2, 2);
+  }
+  else
+  {
+    *--p = static_cast<char>('0' + i);
+  }
 
   if (value < 0)
   {
-    *p++ = '-';
+    *--p = '-';
   }
-  *p = '\0';
-  std::reverse(buf, p);
+  size_t len = end - p;
+  memcpy(buf, p, len);
+  buf[len] = '\0';
 
-  return p - buf;
+  return len;
 }
 
 // uintptr_t对于32平台来说就是unsigned int，
@@ -81,6 +101,7 @@ size_t convertHex(char buf[], uintptr_t value)
 }
 
 template class FixedBuffer<kSmallBuffer>;
+template class FixedBuffer<kMediumBuffer>;
 template class FixedBuffer<kLargeBuffer>;
 
 }  // namespace detail
@@ -10,6 +10,7 @@
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 #include <assert.h>
+#include <stdint.h>
 #include <string.h> // memcpy
 
 namespace muduo
@@ -19,8 +20,23 @@ namespace detail
 {
 
 const int kSmallBuffer = 4000;
+const int kMediumBuffer = 4000*64;
 const int kLargeBuffer = 4000*1000;
 
+// "00" to "99"
+extern const char kDigitPairs[201];
+
+/// Writes @c value, less than 10^width, as @c width digits zero padded.
+/// @c width is even.
+inline void formatDigits(char* buf, uint32_t value, int width)
+{
+  for (int i = width - 2; i >= 0; i -= 2)
+  {
+    memcpy(buf + i, kDigitPairs + (value % 100) * 2, 2);
+    value /= 100;
+  }
+}
+
 // SIZE为非类型参数；传递一个值过来，不是一个类型
 template<int SIZE>
 class FixedBuffer : noncopyable
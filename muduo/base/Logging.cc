@@ -6,6 +6,7 @@
 #include <muduo/base/Logging.h>
 
 #include <muduo/base/CurrentThread.h>
+#include <muduo/base/LoggingInternal.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/base/TimeZone.h>
 
@@ -13,6 +14,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <limits>
 #include <sstream>
 
 namespace muduo
@@ -38,6 +40,13 @@ class LoggerImpl
 __thread char t_errnobuf[512];
 __thread char t_time[64];
 __thread time_t t_lastSecond;
+// in t_zone, t_offset holds for [t_offsetFrom, t_offsetUntil),
+// t_time up to the minute for [t_minuteStart, t_minuteStart + 60).
+__thread time_t t_minuteStart;
+__thread time_t t_offset;
+__thread time_t t_offsetFrom;
+__thread time_t t_offsetUntil;
+thread_local TimeZone t_zone;
 
 const char* strerror_tl(int savedErrno)
 {
@@ -110,6 +119,76 @@ Logger::OutputFunc g_output = defaultOutput;
 Logger::FlushFunc g_flush = defaultFlush;
 TimeZone g_logTimeZone;
 
+// "20140403 08:00:00.123456 " in tz, or "20140403 00:00:00.123456Z "
+// in UTC if tz isn't valid.  Digits of the same minute are rewritten
+// in place, the date only changes after a minute or a transition.
+void formatTime(int64_t microSecondsSinceEpoch, const TimeZone& tz, LogStream& s)
+{
+  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+  int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+  if (!t_zone.sameAs(tz))
+  {
+    t_zone = tz;
+    t_offsetFrom = t_offsetUntil = 0;
+    t_minuteStart = t_lastSecond = std::numeric_limits<time_t>::min();
+  }
+
+  if (seconds != t_lastSecond)
+  {
+    t_lastSecond = seconds;
+    if (seconds < t_offsetFrom || seconds >= t_offsetUntil)
+    {
+      if (tz.valid())
+      {
+        t_offset = tz.gmtOffset(seconds, &t_offsetFrom, &t_offsetUntil);
+      }
+      else
+      {
+        t_offset = 0;
+        t_offsetFrom = std::numeric_limits<time_t>::min();
+        t_offsetUntil = std::numeric_limits<time_t>::max();
+      }
+      t_minuteStart = std::numeric_limits<time_t>::min();
+    }
+
+    if (t_minuteStart <= seconds && seconds < t_minuteStart + 60)
+    {
+      detail::formatDigits(t_time + 15, static_cast<uint32_t>(seconds - t_minuteStart), 2);
+    }
+    else
+    {
+      struct tm tm_time = TimeZone::toUtcTime(seconds + t_offset);
+      int year = tm_time.tm_year + 1900;
+      assert(0 <= year && year <= 9999);
+      detail::formatDigits(t_time, static_cast<uint32_t>(year), 4);
+      detail::formatDigits(t_time + 4, static_cast<uint32_t>(tm_time.tm_mon + 1), 2);
+      detail::formatDigits(t_time + 6, static_cast<uint32_t>(tm_time.tm_mday), 2);
+      t_time[8] = ' ';
+      detail::formatDigits(t_time + 9, static_cast<uint32_t>(tm_time.tm_hour), 2);
+      t_time[11] = ':';
+      detail::formatDigits(t_time + 12, static_cast<uint32_t>(tm_time.tm_min), 2);
+      t_time[14] = ':';
+      detail::formatDigits(t_time + 15, static_cast<uint32_t>(tm_time.tm_sec), 2);
+      t_minuteStart = seconds - tm_time.tm_sec;
+    }
+  }
+
+  char* buf = t_time + 17;
+  buf[0] = '.';
+  detail::formatDigits(buf + 1, static_cast<uint32_t>(microseconds), 6);
+  if (tz.valid())
+  {
+    buf[7] = ' ';
+    s.append(t_time, 25);
+  }
+  else
+  {
+    buf[7] = 'Z';
+    buf[8] = ' ';
+    s.append(t_time, 26);
+  }
+}
+
 }  // namespace muduo
 
 using namespace muduo;
@@ -133,40 +212,7 @@ Logger::Impl::Impl(LogLevel level, int savedErrno, const SourceFile& file, int l
 
 void Logger::Impl::formatTime()
 {
-  int64_t microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
-  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
-  int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
-  if (seconds != t_lastSecond)
-  {
-    t_lastSecond = seconds;
-    struct tm tm_time;
-    if (g_logTimeZone.valid())
-    {
-      tm_time = g_logTimeZone.toLocalTime(seconds);
-    }
-    else
-    {
-      ::gmtime_r(&seconds, &tm_time); // FIXME TimeZone::fromUtcTime
-    }
-
-    int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-    assert(len == 17); (void)len;
-  }
-
-  if (g_logTimeZone.valid())
-  {
-    Fmt us(".%06d ", microseconds);
-    assert(us.length() == 8);
-    stream_ << T(t_time, 17) << T(us.data(), 8);
-  }
-  else
-  {
-    Fmt us(".%06dZ ", microseconds);
-    assert(us.length() == 9);
-    stream_ << T(t_time, 17) << T(us.data(), 9);
-  }
+  muduo::formatTime(time_.microSecondsSinceEpoch(), g_logTimeZone, stream_);
 }
 
 void Logger::Impl::finish()
@@ -226,3 +272,8 @@ void Logger::setTimeZone(const TimeZone& tz)
 {
   g_logTimeZone = tz;
 }
+
+const TimeZone& Logger::timeZone()
+{
+  return g_logTimeZone;
+}
@@ -76,6 +76,7 @@ class Logger
   static void setOutput(OutputFunc);
   static void setFlush(FlushFunc);
   static void setTimeZone(const TimeZone& tz);
+  static const TimeZone& timeZone();
 
  private:
 
@@ -156,4 +157,9 @@ T* CheckNotNull(Logger::SourceFile file, int line, const char *names, T* ptr)
 
 }  // namespace muduo
 
+// LOG_TRACE to LOG_ERROR deferred, see BinaryLogging.h
+#ifdef MUDUO_LOG_DEFERRED
+#include <muduo/base/BinaryLogging.h>
+#endif
+
 #endif  // MUDUO_BASE_LOGGING_H
@@ -0,0 +1,25 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_BASE_LOGGINGINTERNAL_H
+#define MUDUO_BASE_LOGGINGINTERNAL_H
+
+#include <muduo/base/Logging.h>
+
+namespace muduo
+{
+
+// Defined in Logging.cc, shared with BinaryLogging.cc.
+
+extern Logger::OutputFunc g_output;
+extern const char* LogLevelName[Logger::NUM_LOG_LEVELS];
+
+/// Appends "20140403 08:00:00.123456 " in @c tz, or in UTC with a 'Z'
+/// if @c tz isn't valid.
+void formatTime(int64_t microSecondsSinceEpoch, const TimeZone& tz, LogStream& s);
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_LOGGINGINTERNAL_H
@@ -12,8 +12,10 @@
 #include <assert.h>
 #include <dirent.h>
 #include <pwd.h>
+#include <sched.h>
 #include <stdio.h> // snprintf
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/resource.h>
 #include <sys/times.h>
@@ -42,6 +44,16 @@ int taskDirFilter(const struct dirent* d)
   return 0;
 }
 
+__thread int t_numaNode = 0;
+int nodeDirFilter(const struct dirent* d)
+{
+  if (::strncmp(d->d_name, "node", 4) == 0 && ::isdigit(d->d_name[4]))
+  {
+    t_numaNode = atoi(d->d_name + 4);
+  }
+  return 0;
+}
+
 int scanDir(const char *dirpath, int (*filter)(const struct dirent *))
 {
   struct dirent** namelist = NULL;
@@ -244,3 +256,30 @@ std::vector<pid_t> ProcessInfo::threads()
   return result;
 }
 
+
+std::vector<int> ProcessInfo::allowedCpus()
+{
+  std::vector<int> result;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(0, sizeof set, &set) == 0)
+  {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (CPU_ISSET(cpu, &set))
+      {
+        result.push_back(cpu);
+      }
+    }
+  }
+  return result;
+}
+
+int ProcessInfo::numaNodeOfCpu(int cpu)
+{
+  char dirpath[64];
+  snprintf(dirpath, sizeof dirpath, "/sys/devices/system/cpu/cpu%d", cpu);
+  t_numaNode = 0;
+  scanDir(dirpath, nodeDirFilter);
+  return t_numaNode;
+}
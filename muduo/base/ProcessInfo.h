@@ -59,6 +59,11 @@ namespace ProcessInfo
 
   int numThreads();
   std::vector<pid_t> threads();
+
+  /// sched_getaffinity(2) of the calling thread
+  std::vector<int> allowedCpus();
+  /// read /sys/devices/system/cpu/cpuN, 0 without NUMA
+  int numaNodeOfCpu(int cpu);
 }  // namespace ProcessInfo
 
 }  // namespace muduo
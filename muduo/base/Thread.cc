@@ -7,10 +7,13 @@
 #include <muduo/base/CurrentThread.h>
 #include <muduo/base/Exception.h>
 #include <muduo/base/Logging.h>
+#include <muduo/base/ProcessInfo.h>
 
+#include <map>
 #include <type_traits>
 
 #include <errno.h>
+#include <sched.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/prctl.h>
@@ -61,20 +64,27 @@ struct ThreadData
   string name_;
   pid_t* tid_;
   CountDownLatch* latch_;
+  ThreadPlacement placement_;
 
   ThreadData(ThreadFunc func,
              const string& name,
              pid_t* tid,
-             CountDownLatch* latch)
+             CountDownLatch* latch,
+             const ThreadPlacement& placement)
     : func_(std::move(func)),
       name_(name),
       tid_(tid),
-      latch_(latch)
+      latch_(latch),
+      placement_(placement)
   { }
 
 /*  */
   void runInThread()
   {
+    if (!placement_.cpus.empty() || placement_.numaNode >= 0)
+    {
+      placement_.applyToCurrentThread();
+    }
     *tid_ = muduo::CurrentThread::tid();
     tid_ = NULL;
     latch_->countDown();
@@ -145,6 +155,71 @@ void CurrentThread::sleepUsec(int64_t usec)
   ::nanosleep(&ts, NULL);
 }
 
+std::vector<ThreadPlacement> ThreadPlacement::perCpu()
+{
+  std::vector<ThreadPlacement> plan;
+  for (int cpu : ProcessInfo::allowedCpus())
+  {
+    plan.push_back(ThreadPlacement(std::vector<int>(1, cpu), ProcessInfo::numaNodeOfCpu(cpu)));
+  }
+  return plan;
+}
+
+std::vector<ThreadPlacement> ThreadPlacement::perNode()
+{
+  std::map<int, std::vector<int>> nodes;
+  for (int cpu : ProcessInfo::allowedCpus())
+  {
+    nodes[ProcessInfo::numaNodeOfCpu(cpu)].push_back(cpu);
+  }
+  std::vector<ThreadPlacement> plan;
+  for (const auto& node : nodes)
+  {
+    plan.push_back(ThreadPlacement(node.second, node.first));
+  }
+  return plan;
+}
+
+bool ThreadPlacement::applyToCurrentThread() const
+{
+  bool ok = true;
+  if (!cpus.empty())
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+      assert(0 <= cpu && cpu < CPU_SETSIZE);
+      CPU_SET(cpu, &set);
+    }
+    if (::sched_setaffinity(0, sizeof set, &set) < 0)
+    {
+      LOG_SYSERR << "sched_setaffinity";
+      ok = false;
+    }
+  }
+  if (numaNode >= 0)
+  {
+#ifdef SYS_set_mempolicy
+    const int kMpolPreferred = 1;  // MPOL_PREFERRED of <numaif.h>, without libnuma
+    const int kBits = 8 * static_cast<int>(sizeof(unsigned long));
+    std::vector<unsigned long> nodemask(numaNode / kBits + 1);
+    nodemask[numaNode / kBits] = 1UL << (numaNode % kBits);
+    // the kernel reads one bit less than maxnode
+    unsigned long maxnode = nodemask.size() * kBits + 1;
+    if (::syscall(SYS_set_mempolicy, kMpolPreferred, nodemask.data(), maxnode) < 0)
+    {
+      LOG_SYSERR << "set_mempolicy";
+      ok = false;
+    }
+#else
+    LOG_ERROR << "set_mempolicy is not supported.";
+    ok = false;
+#endif
+  }
+  return ok;
+}
+
 AtomicInt32 Thread::numCreated_;
 
 Thread::Thread(ThreadFunc func, const string& n)
@@ -183,7 +258,7 @@ void Thread::start()
   assert(!started_);
   started_ = true;
   // FIXME: move(func_)
-  detail::ThreadData* data = new detail::ThreadData(func_, name_, &tid_, &latch_);
+  detail::ThreadData* data = new detail::ThreadData(func_, name_, &tid_, &latch_, placement_);
   if (pthread_create(&pthreadId_, NULL, &detail::startThread, data))
   {
     started_ = false;
@@ -12,11 +12,44 @@
 
 #include <functional>
 #include <memory>
+#include <vector>
 #include <pthread.h>
 
 namespace muduo
 {
 
+///
+/// Where a thread runs and where its memory comes from.
+///
+/// Memory is allocated on the node of the thread which touches it first,
+/// so a thread placed before it starts keeps what it allocates, e.g. the
+/// EventLoop and TcpConnection buffers of an I/O thread, on its node.
+///
+struct ThreadPlacement
+{
+  std::vector<int> cpus;  // empty for any CPU
+  int numaNode;  // preferred for allocations, -1 for the default policy
+
+  ThreadPlacement()
+    : numaNode(-1)
+  { }
+
+  ThreadPlacement(const std::vector<int>& cpusArg, int node)
+    : cpus(cpusArg),
+      numaNode(node)
+  { }
+
+  /// One per CPU the process may run on, with its node,
+  /// in CPU order, so consecutive threads fill a node first.
+  static std::vector<ThreadPlacement> perCpu();
+  /// One per NUMA node, all the CPUs of the node.
+  static std::vector<ThreadPlacement> perNode();
+
+  /// sched_setaffinity(2) and set_mempolicy(2),
+  /// logs and returns false if either failed.
+  bool applyToCurrentThread() const;
+};
+
 class Thread : noncopyable
 {
  public:
@@ -26,6 +59,10 @@ class Thread : noncopyable
   // FIXME: make it movable in C++11
   ~Thread();
 
+  /// Must be called before start().
+  void setPlacement(const ThreadPlacement& placement)
+  { placement_ = placement; }
+
   void start(); //启动线程
   int join(); // return pthread_join()
 
@@ -46,6 +83,7 @@ class Thread : noncopyable
   ThreadFunc func_; //该线程要回调的函数
   string     name_; //线程名称
   CountDownLatch latch_;
+  ThreadPlacement placement_;
 
   static AtomicInt32 numCreated_; //已经创建的线程的个数（原子整数类），每创建一个，自动加一
 };
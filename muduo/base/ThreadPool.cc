@@ -43,6 +43,10 @@ void ThreadPool::start(int numThreads)
     //创建线程，放到数组里
     threads_.emplace_back(new muduo::Thread(
           std::bind(&ThreadPool::runInThread, this), name_+id));
+    if (!placement_.empty())
+    {
+      threads_[i]->setPlacement(placement_[i % placement_.size()]);
+    }
     threads_[i]->start();
   }
   if (numThreads == 0 && threadInitCallback_)
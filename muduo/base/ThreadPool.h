@@ -30,6 +30,9 @@ class ThreadPool : noncopyable
   void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
   void setThreadInitCallback(const Task& cb)
   { threadInitCallback_ = cb; }
+  /// Thread i is placed by plan[i % plan.size()], see ThreadPlacement.
+  void setThreadPlacement(const std::vector<ThreadPlacement>& plan)
+  { placement_ = plan; }
 
 // 启动线程池，numThreads个线程
   void start(int numThreads); 
@@ -57,6 +60,7 @@ class ThreadPool : noncopyable
   Condition notFull_ GUARDED_BY(mutex_);
   string name_; //线程池名称
   Task threadInitCallback_;
+  std::vector<ThreadPlacement> placement_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_; //线程指针的数组
   std::deque<Task> queue_ GUARDED_BY(mutex_); //任务队列
   size_t maxQueueSize_;
@@ -8,6 +8,7 @@
 #include <muduo/base/Date.h>
 
 #include <algorithm>
+#include <limits>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -296,6 +297,24 @@ struct tm TimeZone::toLocalTime(time_t seconds) const
   return localTime;
 }
 
+time_t TimeZone::gmtOffset(time_t seconds, time_t* from, time_t* until) const
+{
+  assert(data_ != NULL);
+  const Data& data(*data_);
+
+  // as findLocaltime(), before the first transition is the first localtime
+  detail::Transition sentry(seconds, 0, 0);
+  vector<detail::Transition>::const_iterator next =
+      upper_bound(data.transitions.begin(), data.transitions.end(), sentry, detail::Comp(true));
+  *from = next == data.transitions.begin()
+      ? std::numeric_limits<time_t>::min() : (next - 1)->gmttime;
+  *until = next == data.transitions.end()
+      ? std::numeric_limits<time_t>::max() : next->gmttime;
+  const detail::Localtime& local = next == data.transitions.begin()
+      ? data.localtimes.front() : data.localtimes[(next - 1)->localtimeIdx];
+  return local.gmtOffset;
+}
+
 time_t TimeZone::fromLocalTime(const struct tm& localTm) const
 {
   assert(data_ != NULL);
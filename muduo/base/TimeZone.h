@@ -32,6 +32,13 @@ class TimeZone : public muduo::copyable
   struct tm toLocalTime(time_t secondsSinceEpoch) const;
   time_t fromLocalTime(const struct tm&) const;
 
+  // Offset east of UTC at secondsSinceEpoch, the same for all of
+  // [*from, *until), between two transitions, for callers that cache it.
+  time_t gmtOffset(time_t secondsSinceEpoch, time_t* from, time_t* until) const;
+
+  // shares the data of rhs, a copy of it
+  bool sameAs(const TimeZone& rhs) const { return data_ == rhs.data_; }
+
   // gmtime(3)
   static struct tm toUtcTime(time_t secondsSinceEpoch, bool yday = false);
   // timegm(3)
@@ -0,0 +1,542 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/base/WorkStealingThreadPool.h>
+
+#include <muduo/base/Exception.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+namespace
+{
+
+__thread WorkStealingThreadPool* t_pool = NULL;
+__thread int t_workerIndex = 0;
+
+const int kStealRounds = 4;  // before going to sleep
+
+}  // namespace
+
+struct WorkStealingThreadPool::TaskNode
+{
+  explicit TaskNode(Task&& t)
+    : task(std::move(t)),
+      next(NULL)
+  { }
+
+  Task task;
+  TaskNode* next;  // in an inbox
+};
+
+///
+/// Chase-Lev deque, with the memory orders of
+/// "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP'13.
+///
+/// push() and pop() at the bottom by the owner only, steal() at the top
+/// by any thread.  Grows, old arrays are kept until destruction since
+/// thieves may still read them.
+///
+class WorkStealingThreadPool::WorkDeque : noncopyable
+{
+ public:
+  WorkDeque()
+    : top_(0),
+      bottom_(0),
+      array_(NULL)
+  {
+    arrays_.emplace_back(new Array(kInitialCapacity));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  void push(TaskNode* node)
+  {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    Array* a = array_.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1)
+    {
+      a = grow(a, t, b);
+    }
+    a->put(b, node);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+  }
+
+  TaskNode* pop()
+  {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* a = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    TaskNode* node = NULL;
+    if (t <= b)
+    {
+      node = a->get(b);
+      if (t == b)
+      {
+        // the last one, races with thieves
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+        {
+          node = NULL;
+        }
+        bottom_.store(b + 1, std::memory_order_relaxed);
+      }
+    }
+    else
+    {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return node;
+  }
+
+  /// NULL if empty or lost a race.
+  TaskNode* steal()
+  {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t < b)
+    {
+      Array* a = array_.load(std::memory_order_acquire);
+      TaskNode* node = a->get(t);
+      if (top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+      {
+        return node;
+      }
+    }
+    return NULL;
+  }
+
+  /// Approximate, for other threads.
+  bool empty() const
+  {
+    return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static const int64_t kInitialCapacity = 256;  // power of 2
+
+  struct Array
+  {
+    explicit Array(int64_t cap)
+      : capacity(cap),
+        slots(new std::atomic<TaskNode*>[cap])
+    { }
+
+    TaskNode* get(int64_t i) const
+    { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+
+    void put(int64_t i, TaskNode* node)
+    { slots[i & (capacity - 1)].store(node, std::memory_order_relaxed); }
+
+    const int64_t capacity;
+    std::unique_ptr<std::atomic<TaskNode*>[]> slots;
+  };
+
+  Array* grow(Array* a, int64_t t, int64_t b)
+  {
+    Array* bigger = new Array(a->capacity * 2);
+    for (int64_t i = t; i < b; ++i)
+    {
+      bigger->put(i, a->get(i));
+    }
+    arrays_.emplace_back(bigger);
+    array_.store(bigger, std::memory_order_release);
+    return bigger;
+  }
+
+  std::atomic<int64_t> top_;
+  char pad_[64 - sizeof(std::atomic<int64_t>)];  // thieves and owner apart
+  std::atomic<int64_t> bottom_;
+  std::atomic<Array*> array_;
+  std::vector<std::unique_ptr<Array>> arrays_;  // owner only
+};
+
+struct WorkStealingThreadPool::Worker : noncopyable
+{
+  explicit Worker(int index)
+    : inbox(NULL),
+      sleeping(false),
+      cond(mutex),
+      seed(static_cast<uint32_t>(index) * 2654435761u + 1)
+  { }
+
+  WorkDeque deque;
+  std::atomic<TaskNode*> inbox;  // lock-free LIFO list, pushed by run() from outside
+  std::atomic<bool> sleeping;
+  MutexLock mutex;
+  Condition cond GUARDED_BY(mutex);
+  uint32_t seed;  // for picking victims
+};
+
+WorkStealingThreadPool::WorkStealingThreadPool(const string& nameArg)
+  : name_(nameArg),
+    running_(false),
+    next_(0),
+    pending_(0),
+    sleepers_(0),
+    maxQueueSize_(0),
+    blocked_(0),
+    mutex_(),
+    notFull_(mutex_)
+{
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+  if (running_)
+  {
+    stop();
+  }
+  else
+  {
+    // a run() racing stop() may have queued after its drain
+    dropQueued();
+  }
+}
+
+void WorkStealingThreadPool::start(int numThreads)
+{
+  assert(threads_.empty());
+  running_ = true;
+  workers_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    workers_.emplace_back(new Worker(i));
+  }
+  threads_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    char id[32];
+    snprintf(id, sizeof id, "%d", i+1);
+    threads_.emplace_back(new muduo::Thread(
+          std::bind(&WorkStealingThreadPool::runInThread, this, i), name_+id));
+    threads_[i]->start();
+  }
+  if (numThreads == 0 && threadInitCallback_)
+  {
+    threadInitCallback_();
+  }
+}
+
+void WorkStealingThreadPool::stop()
+{
+  running_ = false;
+  for (auto& worker : workers_)
+  {
+    MutexLockGuard lock(worker->mutex);
+    worker->sleeping = false;
+    worker->cond.notify();
+  }
+  for (auto& thr : threads_)
+  {
+    thr->join();
+  }
+  dropQueued();
+  if (maxQueueSize_ > 0)
+  {
+    MutexLockGuard lock(mutex_);
+    notFull_.notifyAll();
+  }
+}
+
+// drops what did not run
+void WorkStealingThreadPool::dropQueued()
+{
+  for (auto& worker : workers_)
+  {
+    while (TaskNode* node = worker->deque.pop())
+    {
+      delete node;
+    }
+    TaskNode* node = worker->inbox.exchange(NULL);
+    while (node)
+    {
+      TaskNode* next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+  pending_ = 0;
+}
+
+size_t WorkStealingThreadPool::queueSize() const
+{
+  return pending_.load(std::memory_order_relaxed);
+}
+
+void WorkStealingThreadPool::run(Task task)
+{
+  if (workers_.empty())
+  {
+    task();
+    return;
+  }
+
+  if (maxQueueSize_ > 0)
+  {
+    reserve();
+  }
+  else
+  {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (!running_)
+  {
+    // stopped, nobody would run it
+    pending_.fetch_sub(1);
+    return;
+  }
+
+  TaskNode* node = new TaskNode(std::move(task));
+  if (t_pool == this)
+  {
+    workers_[t_workerIndex]->deque.push(node);
+    // pairs with the fence in sleep()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0)
+    {
+      wakeOne();
+    }
+  }
+  else
+  {
+    // an awake worker if any, waking one costs a syscall
+    const size_t n = workers_.size();
+    const size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+    Worker* worker = workers_[start % n].get();
+    for (size_t i = 0; i < n && worker->sleeping.load(std::memory_order_relaxed); ++i)
+    {
+      worker = workers_[(start + i) % n].get();
+    }
+    TaskNode* head = worker->inbox.load(std::memory_order_relaxed);
+    do
+    {
+      node->next = head;
+    } while (!worker->inbox.compare_exchange_weak(head, node));
+    wake(worker);
+  }
+}
+
+void WorkStealingThreadPool::runInThread(int index)
+{
+  try
+  {
+    t_pool = this;
+    t_workerIndex = index;
+    Worker* worker = workers_[index].get();
+    if (threadInitCallback_)
+    {
+      threadInitCallback_();
+    }
+    while (running_)
+    {
+      TaskNode* node = take(worker);
+      if (node)
+      {
+        finished(node);
+        node->task();
+        delete node;
+      }
+      else
+      {
+        sleep(worker);
+      }
+    }
+  }
+  catch (const Exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    fprintf(stderr, "stack trace: %s\n", ex.stackTrace());
+    abort();
+  }
+  catch (const std::exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    abort();
+  }
+  catch (...)
+  {
+    fprintf(stderr, "unknown exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    throw; // rethrow
+  }
+}
+
+// Counts a task in pending_ if there is room, blocks otherwise.
+void WorkStealingThreadPool::reserve()
+{
+  size_t n = pending_.load(std::memory_order_relaxed);
+  while (running_)
+  {
+    if (n < maxQueueSize_)
+    {
+      if (pending_.compare_exchange_weak(n, n + 1))
+      {
+        return;
+      }
+    }
+    else
+    {
+      MutexLockGuard lock(mutex_);
+      // pairs with finished(), which sees blocked_ or is seen by the load
+      blocked_.fetch_add(1);
+      while ((n = pending_.load()) >= maxQueueSize_ && running_)
+      {
+        notFull_.wait();
+      }
+      blocked_.fetch_sub(1);
+    }
+  }
+  pending_.fetch_add(1);  // stopped, run() drops the task
+}
+
+// taken off the queue, about to run
+void WorkStealingThreadPool::finished(TaskNode*)
+{
+  pending_.fetch_sub(1);
+  if (maxQueueSize_ > 0 && blocked_.load() > 0)
+  {
+    MutexLockGuard lock(mutex_);
+    notFull_.notify();
+  }
+}
+
+WorkStealingThreadPool::TaskNode* WorkStealingThreadPool::take(Worker* worker)
+{
+  TaskNode* node = worker->deque.pop();
+  if (node == NULL && takeInbox(worker))
+  {
+    node = worker->deque.pop();
+  }
+  for (int i = 0; node == NULL && i < kStealRounds; ++i)
+  {
+    node = steal(worker);
+  }
+  return node;
+}
+
+bool WorkStealingThreadPool::takeInbox(Worker* worker)
+{
+  TaskNode* node = worker->inbox.exchange(NULL, std::memory_order_acquire);
+  if (node == NULL)
+  {
+    return false;
+  }
+  pushList(worker, node);
+  return true;
+}
+
+// Moves an inbox to the deque, the oldest task is pushed last
+// so the owner runs it first and thieves take the newer ones.
+void WorkStealingThreadPool::pushList(Worker* worker, TaskNode* node)
+{
+  bool many = node->next != NULL;
+  while (node)
+  {
+    TaskNode* next = node->next;
+    node->next = NULL;
+    worker->deque.push(node);
+    node = next;
+  }
+  if (many)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0)
+    {
+      wakeOne();
+    }
+  }
+}
+
+// From the deques of the others, then from their inboxes,
+// which are not run by a busy owner otherwise.
+WorkStealingThreadPool::TaskNode* WorkStealingThreadPool::steal(Worker* thief)
+{
+  const size_t n = workers_.size();
+  thief->seed ^= thief->seed << 13;
+  thief->seed ^= thief->seed >> 17;
+  thief->seed ^= thief->seed << 5;
+  const size_t start = thief->seed % n;
+  for (size_t i = 0; i < n; ++i)
+  {
+    Worker* victim = workers_[(start + i) % n].get();
+    if (victim != thief)
+    {
+      if (TaskNode* node = victim->deque.steal())
+      {
+        return node;
+      }
+    }
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    Worker* victim = workers_[(start + i) % n].get();
+    if (victim != thief && victim->inbox.load(std::memory_order_relaxed))
+    {
+      TaskNode* node = victim->inbox.exchange(NULL, std::memory_order_acquire);
+      if (node)
+      {
+        pushList(thief, node);
+        return thief->deque.pop();
+      }
+    }
+  }
+  return NULL;
+}
+
+void WorkStealingThreadPool::sleep(Worker* worker)
+{
+  worker->sleeping.store(true);
+  sleepers_.fetch_add(1);
+  // pairs with the fences in run() and takeInbox()
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  bool hasWork = false;
+  for (auto& other : workers_)
+  {
+    if (other->inbox.load(std::memory_order_relaxed) || !other->deque.empty())
+    {
+      hasWork = true;
+      break;
+    }
+  }
+  if (!hasWork)
+  {
+    MutexLockGuard lock(worker->mutex);
+    while (worker->sleeping && running_)
+    {
+      worker->cond.wait();
+    }
+  }
+  worker->sleeping.store(false);
+  sleepers_.fetch_sub(1);
+}
+
+void WorkStealingThreadPool::wake(Worker* worker)
+{
+  if (worker->sleeping.load())
+  {
+    MutexLockGuard lock(worker->mutex);
+    worker->sleeping = false;
+    worker->cond.notify();
+  }
+}
+
+void WorkStealingThreadPool::wakeOne()
+{
+  for (auto& worker : workers_)
+  {
+    if (worker->sleeping.load())
+    {
+      wake(worker.get());
+      return;
+    }
+  }
+}
@@ -0,0 +1,97 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+#define MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Types.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace muduo
+{
+
+///
+/// The interface of ThreadPool, without its single locked queue.
+///
+/// Every worker owns a deque, it takes its own tasks from the back and
+/// idle workers steal from the front of the others (Chase-Lev).
+/// run() from another thread pushes onto the inbox of a worker picked
+/// round-robin, a lock-free list the worker moves to its deque, so an I/O
+/// thread only takes a lock to wake a sleeping worker.  run() from a
+/// worker pushes onto its own deque.
+///
+/// Tasks run in no particular order, not first in first out as with
+/// ThreadPool, so it does not replace one whose tasks depend on that.
+///
+/// With setMaxQueueSize(), run() reserves its place with a CAS on the
+/// count of pending tasks, and the lock is only taken when the queue is
+/// full and for waking the producers blocked on it.
+///
+class WorkStealingThreadPool : noncopyable
+{
+ public:
+  typedef std::function<void ()> Task;
+
+  explicit WorkStealingThreadPool(const string& nameArg = string("WorkStealingThreadPool"));
+  ~WorkStealingThreadPool();
+
+  // Must be called before start().
+  void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
+  void setThreadInitCallback(const Task& cb)
+  { threadInitCallback_ = cb; }
+
+  void start(int numThreads);
+  /// Tasks not started yet are dropped, and those run() after.
+  void stop();
+
+  const string& name() const
+  { return name_; }
+
+  /// Approximate.
+  size_t queueSize() const;
+
+  // Could block if maxQueueSize > 0
+  void run(Task f);
+
+ private:
+  struct TaskNode;
+  class WorkDeque;
+  struct Worker;
+
+  void runInThread(int index);
+  TaskNode* take(Worker* worker);
+  TaskNode* steal(Worker* thief);
+  bool takeInbox(Worker* worker);
+  void pushList(Worker* worker, TaskNode* node);
+  void sleep(Worker* worker);
+  void wake(Worker* worker);
+  void wakeOne();
+  void reserve();
+  void finished(TaskNode* node);
+  void dropQueued();
+
+  string name_;
+  Task threadInitCallback_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::unique_ptr<muduo::Thread>> threads_;
+  std::atomic<bool> running_;
+  std::atomic<size_t> next_;  // inbox for the next run() from outside
+  std::atomic<size_t> pending_;  // queued, not yet started
+  std::atomic<int> sleepers_;
+  size_t maxQueueSize_;
+
+  // only used with maxQueueSize_ > 0
+  std::atomic<int> blocked_;  // producers waiting for notFull_
+  MutexLock mutex_;
+  Condition notFull_ GUARDED_BY(mutex_);
+};
+
+}  // namespace muduo
+
+#endif  // MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
@@ -8,6 +8,7 @@ project "base"
     headers('*.h')
     files {
             'AsyncLogging.cc',
+            'BinaryLogging.cc',
             'Condition.cc',
             'CountDownLatch.cc',
             'Date.cc',
@@ -21,4 +22,5 @@ project "base"
             'TimeZone.cc',
             'Thread.cc',
             'ThreadPool.cc',
+            'WorkStealingThreadPool.cc',
      }
@@ -1,11 +1,26 @@
 #include <muduo/base/AsyncLogging.h>
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
 #include <muduo/base/Timestamp.h>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/resource.h>
+#include <time.h>
 #include <unistd.h>
 
+// Threads logging LOG_INFO as fast as they can, every append timed.
+// Reports lines per second of the frontend, percentiles of the time one
+// LOG_INFO takes, and how long the backend took to write what was left.
+//
+// Usage: asynclogging_test [threads] [lines_per_thread] [short|long]
+//                          [buffered|blocks|direct]
+
 off_t kRollSize = 500*1000*1000; //滚动大小为500M，超过500M要滚动日志文件
 
 muduo::AsyncLogging* g_asyncLog = NULL;
@@ -15,33 +30,75 @@ void asyncOutput(const char* msg, int len)
   g_asyncLog->append(msg, len);
 }
 
-void bench(bool longLog)
+int64_t nowNanos()
 {
-  muduo::Logger::setOutput(asyncOutput);
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
 
-  int cnt = 0;
-  const int kBatch = 1000;
+void logLines(int lines, bool longLog, muduo::CountDownLatch* start,
+              std::vector<int>* latencies)
+{
   muduo::string empty = " ";
   muduo::string longStr(3000, 'X');
   longStr += " ";
-
-  for (int t = 0; t < 30; ++t)
+  latencies->reserve(lines);
+  start->wait();
+  for (int i = 0; i < lines; ++i)
   {
-    muduo::Timestamp start = muduo::Timestamp::now();
+    int64_t begin = nowNanos();
     // 前端写日志，LOG_INFO会调用asyncOutput函数写入到缓冲区中；写到一定程度，后台程序会将缓冲区内容写入到日志文件中
-    for (int i = 0; i < kBatch; ++i)
-    {
-      LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz "
-               << (longLog ? longStr : empty)
-               << cnt;
-      ++cnt;
-    }
-    muduo::Timestamp end = muduo::Timestamp::now();
-    printf("%f\n", timeDifference(end, start)*1000000/kBatch);
-    // 注释掉下面的睡眠可以加速日志堆积
-    struct timespec ts = { 0, 500*1000*1000 };
-    nanosleep(&ts, NULL);
+    LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz "
+             << (longLog ? longStr : empty)
+             << i;
+    latencies->push_back(static_cast<int>(nowNanos() - begin));
+  }
+}
+
+int percentile(const std::vector<int>& sorted, double p)
+{
+  size_t i = static_cast<size_t>(static_cast<double>(sorted.size() - 1) * p);
+  return sorted[i];
+}
+
+void bench(int numThreads, int lines, bool longLog)
+{
+  muduo::Logger::setOutput(asyncOutput);
+
+  muduo::CountDownLatch start(1);
+  std::vector<std::vector<int>> latencies(numThreads);
+  std::vector<std::unique_ptr<muduo::Thread>> threads;
+  for (int i = 0; i < numThreads; ++i)
+  {
+    threads.emplace_back(new muduo::Thread(
+        std::bind(logLines, lines, longLog, &start, &latencies[i])));
+    threads.back()->start();
   }
+  muduo::Timestamp begin = muduo::Timestamp::now();
+  start.countDown();
+  for (const auto& thr : threads)
+  {
+    thr->join();
+  }
+  double elapsed = timeDifference(muduo::Timestamp::now(), begin);
+  muduo::Timestamp stopping = muduo::Timestamp::now();
+  g_asyncLog->stop();
+  double drain = timeDifference(muduo::Timestamp::now(), stopping);
+
+  std::vector<int> all;
+  for (const auto& l : latencies)
+  {
+    all.insert(all.end(), l.begin(), l.end());
+  }
+  std::sort(all.begin(), all.end());
+  double total = static_cast<double>(all.size());
+  printf("%d threads, %d %s lines each: %.3f s, %.0f lines/s, stop() %.3f s\n",
+         numThreads, lines, longLog ? "long" : "short", elapsed,
+         total / elapsed, drain);
+  printf("append ns: p50 %d p99 %d p99.9 %d max %d\n",
+         percentile(all, 0.5), percentile(all, 0.99),
+         percentile(all, 0.999), all.back());
 }
 
 int main(int argc, char* argv[])
@@ -55,12 +112,25 @@ int main(int argc, char* argv[])
 
   printf("pid = %d\n", getpid());
 
+  int numThreads = argc > 1 ? atoi(argv[1]) : 1;
+  int lines = argc > 2 ? atoi(argv[2]) : 100000;
+  bool longLog = argc > 3 && strcmp(argv[3], "long") == 0;
+  const char* mode = argc > 4 ? argv[4] : "buffered";
+
   char name[256] = { 0 };
   strncpy(name, argv[0], sizeof name - 1);
   muduo::AsyncLogging log(::basename(name), kRollSize);
+  if (strcmp(mode, "blocks") == 0)
+  {
+    log.setFileMode(muduo::FileUtil::AppendFile::kBlocks);
+  }
+  else if (strcmp(mode, "direct") == 0)
+  {
+    log.setFileMode(muduo::FileUtil::AppendFile::kDirect);
+  }
+  printf("file mode %s\n", mode);
   log.start();
   g_asyncLog = &log;
 
-  bool longLog = argc > 1;
-  bench(longLog);
+  bench(numThreads, lines, longLog);
 }
@@ -0,0 +1,81 @@
+#include <muduo/base/BinaryLogging.h>
+
+#include <vector>
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+
+// Prints log files AsyncLogging wrote with setWriteBinary() as text,
+// each line as Logger would have formatted it.
+//
+// Usage: binarylog_decode [-z zonefile] [file...]
+// Times in UTC without -z, standard input without files.
+
+bool decodeFile(FILE* fp, const TimeZone& tz, const char* name)
+{
+  BinaryLogDecoder decoder(tz);
+  std::vector<char> buf(1024 * 1024);
+  size_t len = 0;
+  string out;
+  size_t n = 0;
+  while ((n = ::fread(&buf[len], 1, buf.size() - len, fp)) > 0)
+  {
+    len += n;
+    size_t decoded = decoder.decode(&buf[0], len, &out);
+    ::fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
+    len -= decoded;
+    ::memmove(&buf[0], &buf[decoded], len);
+    if (len == buf.size())
+    {
+      buf.resize(buf.size() * 2);  // a frame larger than the buffer
+    }
+  }
+  if (len > 0)
+  {
+    ::fprintf(stderr, "%s: %zd bytes at the end are not a whole frame\n", name, len);
+  }
+  if (decoder.numErrors() > 0)
+  {
+    ::fprintf(stderr, "%s: %lld frames malformed or of unknown sites\n",
+              name, static_cast<long long>(decoder.numErrors()));
+  }
+  return len == 0 && decoder.numErrors() == 0;
+}
+
+int main(int argc, char* argv[])
+{
+  TimeZone tz;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-z") == 0)
+  {
+    tz = TimeZone(argv[2]);
+    if (!tz.valid())
+    {
+      ::fprintf(stderr, "cannot load time zone %s\n", argv[2]);
+      return 1;
+    }
+    first = 3;
+  }
+
+  bool ok = true;
+  if (first == argc)
+  {
+    ok = decodeFile(stdin, tz, "stdin");
+  }
+  for (int i = first; i < argc; ++i)
+  {
+    FILE* fp = ::fopen(argv[i], "rb");
+    if (fp == NULL)
+    {
+      ::perror(argv[i]);
+      ok = false;
+      continue;
+    }
+    ok = decodeFile(fp, tz, argv[i]) && ok;
+    ::fclose(fp);
+  }
+  return ok ? 0 : 1;
+}
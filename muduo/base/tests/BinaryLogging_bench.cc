@@ -0,0 +1,95 @@
+#define MUDUO_LOG_DEFERRED
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <stdio.h>
+
+using namespace muduo;
+
+// What a LOG_DEBUG costs the thread calling it: formatted at once
+// through LogStream, as LogStream_bench measures piece by piece, or
+// recorded for later.  Then what formatting that record costs the
+// thread which does it later.  Outputs only count bytes.
+
+const int N = 1000000;
+
+int64_t g_total;
+string g_record;
+
+void nullOutput(const char*, int len)
+{
+  g_total += len;
+}
+
+void keepOutput(const char* record, int len)
+{
+  g_total += len;
+  g_record.assign(record, len);
+}
+
+template<typename Statement>
+double bench(Statement statement)
+{
+  g_total = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < N; ++i)
+  {
+    statement(i);
+  }
+  return timeDifference(Timestamp::now(), start) * 1e9 / N;
+}
+
+template<typename Eager, typename Deferred>
+void benchBoth(const char* name, Eager eager, Deferred deferred)
+{
+  double eagerNs = bench(eager);
+  int64_t eagerBytes = g_total / N;
+  BinaryLogger::setOutput(nullOutput);
+  double deferredNs = bench(deferred);
+  int64_t recordBytes = g_total / N;
+
+  // format the last record N times
+  BinaryLogger::setOutput(keepOutput);
+  deferred(0);
+  BinaryLogger::setOutput(NULL);
+  const LogSite* site = LogSite::find(binaryRecordSite(g_record.data(), static_cast<int>(g_record.size())));
+  LogSiteInfo info = site->info();
+  LogStream line;
+  double formatNs = bench([&](int) {
+    line.resetBuffer();
+    formatBinaryRecord(info, g_record.data(), static_cast<int>(g_record.size()), TimeZone(), &line);
+  });
+  printf("%-8s eager %6.1f ns %4lld bytes, deferred %6.1f ns %4lld bytes, formatting later %6.1f ns\n",
+         name, eagerNs, static_cast<long long>(eagerBytes),
+         deferredNs, static_cast<long long>(recordBytes), formatNs);
+}
+
+#define EAGER_DEBUG \
+  muduo::Logger(__FILE__, __LINE__, muduo::Logger::DEBUG, __func__).stream()
+
+int main()
+{
+  Logger::setLogLevel(Logger::DEBUG);
+  Logger::setOutput(nullOutput);
+
+  benchBoth("int",
+            [](int i) { EAGER_DEBUG << i; },
+            [](int i) { LOG_DEBUG << i; });
+  benchBoth("double",
+            [](int i) { EAGER_DEBUG << i * 1.01; },
+            [](int i) { LOG_DEBUG << i * 1.01; });
+  benchBoth("int64_t",
+            [](int i) { EAGER_DEBUG << static_cast<int64_t>(i) * 1000000007; },
+            [](int i) { LOG_DEBUG << static_cast<int64_t>(i) * 1000000007; });
+  benchBoth("void*",
+            [](int i) { EAGER_DEBUG << reinterpret_cast<const void*>(static_cast<uintptr_t>(i)); },
+            [](int i) { LOG_DEBUG << reinterpret_cast<const void*>(static_cast<uintptr_t>(i)); });
+  benchBoth("line",
+            [](int i) { EAGER_DEBUG << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i; },
+            [](int i) { LOG_DEBUG << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i; });
+  benchBoth("numbers",
+            [](int i) { EAGER_DEBUG << "rtt " << i * 0.001 << " cwnd " << i << " srtt " << i * 0.002
+                                    << " bytes " << static_cast<int64_t>(i) << 40; },
+            [](int i) { LOG_DEBUG << "rtt " << i * 0.001 << " cwnd " << i << " srtt " << i * 0.002
+                                  << " bytes " << static_cast<int64_t>(i) << 40; });
+}
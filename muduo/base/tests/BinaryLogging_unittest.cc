@@ -0,0 +1,178 @@
+#define MUDUO_LOG_DEFERRED
+#include <muduo/base/BinaryLogging.h>
+
+#include <limits>
+#include <vector>
+
+#include <stdint.h>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::string;
+
+namespace
+{
+
+std::vector<string> g_lines;
+std::vector<string> g_records;
+
+void textOutput(const char* msg, int len)
+{
+  g_lines.push_back(string(msg, len));
+}
+
+void binaryOutput(const char* record, int len)
+{
+  g_records.push_back(string(record, len));
+}
+
+string format(const string& record)
+{
+  const muduo::LogSite* site =
+      muduo::LogSite::find(muduo::binaryRecordSite(record.data(), static_cast<int>(record.size())));
+  BOOST_REQUIRE(site != NULL);
+  muduo::LogStream line;
+  BOOST_CHECK(muduo::formatBinaryRecord(site->info(), record.data(), static_cast<int>(record.size()),
+                                        muduo::TimeZone(), &line));
+  return line.buffer().toString();
+}
+
+// past the time, which differs
+string untimed(const string& line)
+{
+  return line.substr(26);
+}
+
+}  // namespace
+
+// the eager and the deferred statement on one line
+#define BOTH_INFO(args) \
+  muduo::Logger(__FILE__, __LINE__).stream() << args; LOG_INFO << args
+
+BOOST_AUTO_TEST_CASE(testFormatAsLogger)
+{
+  muduo::Logger::setOutput(textOutput);
+  muduo::BinaryLogger::setOutput(binaryOutput);
+  g_lines.clear();
+  g_records.clear();
+
+  int i = -42;
+  int64_t big = std::numeric_limits<int64_t>::min();
+  string str("a string");
+  const char* nullStr = NULL;
+  BOTH_INFO("Hello " << i << ' ' << 3.14159 << " " << big << " " << true);
+  BOTH_INFO(std::numeric_limits<uint64_t>::max() << static_cast<short>(-7) << 1.0f);
+  BOTH_INFO(str << muduo::StringPiece("piece") << nullStr << &i);
+  BOTH_INFO(muduo::Fmt("%5.2f", 1.5) << static_cast<unsigned short>(65535) << 'c');
+  BOTH_INFO("");
+
+  BOOST_REQUIRE_EQUAL(g_lines.size(), 5u);
+  BOOST_REQUIRE_EQUAL(g_records.size(), 5u);
+  for (size_t n = 0; n < g_lines.size(); ++n)
+  {
+    BOOST_CHECK_EQUAL(untimed(format(g_records[n])), untimed(g_lines[n]));
+  }
+  BOOST_CHECK_EQUAL(g_lines[0].substr(g_lines[0].find("INFO")),
+                    "INFO  Hello -42 3.14159 -9223372036854775808 1 - BinaryLogging_unittest.cc:"
+                    + g_lines[0].substr(g_lines[0].rfind(':') + 1));
+
+  muduo::BinaryLogger::setOutput(NULL);
+}
+
+BOOST_AUTO_TEST_CASE(testWithoutOutput)
+{
+  // formatted at once, through Logger's output
+  muduo::Logger::setOutput(textOutput);
+  g_lines.clear();
+  LOG_WARN << "no binary output " << 1;
+  BOOST_REQUIRE_EQUAL(g_lines.size(), 1u);
+  BOOST_CHECK(g_lines[0].find(" WARN  no binary output 1 - BinaryLogging_unittest.cc:") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testSiteOnce)
+{
+  muduo::BinaryLogger::setOutput(binaryOutput);
+  g_records.clear();
+  for (int i = 0; i < 3; ++i)
+  {
+    LOG_INFO << i;
+  }
+  LOG_INFO << "another";
+  BOOST_REQUIRE_EQUAL(g_records.size(), 4u);
+  uint32_t first = muduo::binaryRecordSite(g_records[0].data(), static_cast<int>(g_records[0].size()));
+  BOOST_CHECK_EQUAL(muduo::binaryRecordSite(g_records[2].data(), static_cast<int>(g_records[2].size())), first);
+  BOOST_CHECK(muduo::binaryRecordSite(g_records[3].data(), static_cast<int>(g_records[3].size())) != first);
+  muduo::BinaryLogger::setOutput(NULL);
+}
+
+BOOST_AUTO_TEST_CASE(testTruncated)
+{
+  muduo::Logger::setOutput(textOutput);
+  muduo::BinaryLogger::setOutput(binaryOutput);
+  g_lines.clear();
+  g_records.clear();
+  string longStr(5000, 'X');
+  BOTH_INFO(longStr << 1);
+  BOTH_INFO(longStr.substr(0, 3900) << 2);
+  BOOST_REQUIRE_EQUAL(g_records.size(), 2u);
+  BOOST_CHECK(g_records[0].size() < muduo::detail::kSmallBuffer);
+  // LogStream drops what doesn't fit, either way
+  BOOST_CHECK_EQUAL(untimed(format(g_records[0])), untimed(g_lines[0]));
+  BOOST_CHECK_EQUAL(untimed(format(g_records[1])), untimed(g_lines[1]));
+  BOOST_CHECK(g_lines[1].find("XXXX2 - ") != string::npos);
+  muduo::BinaryLogger::setOutput(NULL);
+}
+
+BOOST_AUTO_TEST_CASE(testDecodeFrames)
+{
+  muduo::BinaryLogger::setOutput(binaryOutput);
+  g_records.clear();
+  for (int i = 1; i <= 2; ++i)
+  {
+    LOG_INFO << "framed " << i;
+  }
+  muduo::BinaryLogger::setOutput(NULL);
+  BOOST_REQUIRE_EQUAL(g_records.size(), 2u);
+
+  // as AsyncLogging writes them
+  string file;
+  uint32_t id = muduo::binaryRecordSite(g_records[0].data(), static_cast<int>(g_records[0].size()));
+  muduo::LogSiteInfo info = muduo::LogSite::find(id)->info();
+  file.resize(muduo::binarylog::siteFrameSize(info));
+  muduo::binarylog::writeSiteFrame(&*file.begin(), id, info);
+  string text("a text line\n");
+  string expected;
+  for (const string& record : g_records)
+  {
+    char header[muduo::binarylog::kFrameHeaderSize];
+    muduo::binarylog::writeFrameHeader(header, muduo::binarylog::kRecordFrame,
+                                       static_cast<int>(record.size()));
+    file.append(header, sizeof header);
+    file += record;
+    muduo::binarylog::writeFrameHeader(header, muduo::binarylog::kTextFrame,
+                                       static_cast<int>(text.size()));
+    file.append(header, sizeof header);
+    file += text;
+    expected += format(record) + text;
+  }
+
+  muduo::BinaryLogDecoder decoder((muduo::TimeZone()));
+  string out;
+  // a frame cut short waits for the rest
+  size_t n = decoder.decode(file.data(), file.size() - 3, &out);
+  BOOST_CHECK(n < file.size() - 3);
+  n += decoder.decode(file.data() + n, file.size() - n, &out);
+  BOOST_CHECK_EQUAL(n, file.size());
+  BOOST_CHECK_EQUAL(out, expected);
+  BOOST_CHECK_EQUAL(decoder.numErrors(), 0);
+
+  // records of a site never seen are skipped
+  muduo::BinaryLogDecoder another((muduo::TimeZone()));
+  out.clear();
+  size_t siteFrame = static_cast<size_t>(muduo::binarylog::siteFrameSize(info));
+  another.decode(file.data() + siteFrame, file.size() - siteFrame, &out);
+  BOOST_CHECK_EQUAL(out, text + text);
+  BOOST_CHECK_EQUAL(another.numErrors(), 2);
+}
@@ -1,4 +1,6 @@
 #include <muduo/base/BlockingQueue.h>
+#include <muduo/base/BoundedBlockingQueue.h>
+#include <muduo/base/LockFreeBoundedQueue.h>
 #include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/Timestamp.h>
@@ -7,13 +9,24 @@
 #include <string>
 #include <vector>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+// Usage: blockingqueue_bench [threads] [blocking|bounded|lockfree|spsc]
+//          latency from put to take, one producer and `threads` consumers
+//        blockingqueue_bench [threads] throughput
+//          items per second through every queue, `threads` producers and
+//          `threads` consumers (spsc always 1 and 1)
+
+const int kQueueSize = 1024;
+
+template<typename Queue>
 class Bench //用来度量时间的类
 {
  public:
-  Bench(int numThreads)
-    : latch_(numThreads)
+  Bench(Queue* queue, int numThreads)
+    : queue_(queue),
+      latch_(numThreads)
   {
     threads_.reserve(numThreads);
     for (int i = 0; i < numThreads; ++i)
@@ -38,7 +51,7 @@ class Bench //用来度量时间的类
     for (int i = 0; i < times; ++i)
     {
       muduo::Timestamp now(muduo::Timestamp::now());
-      queue_.put(now);
+      queue_->put(now);
       usleep(1000);
     }
   }
@@ -47,7 +60,7 @@ class Bench //用来度量时间的类
   {
     for (size_t i = 0; i < threads_.size(); ++i)
     {
-      queue_.put(muduo::Timestamp::invalid());//生产非法时间
+      queue_->put(muduo::Timestamp::invalid());//生产非法时间
     }
 
     for (auto& thr : threads_)
@@ -69,7 +82,7 @@ class Bench //用来度量时间的类
     bool running = true;
     while (running)
     {
-      muduo::Timestamp t(queue_.take());
+      muduo::Timestamp t(queue_->take());
       muduo::Timestamp now(muduo::Timestamp::now());
       if (t.valid()) //如果是合法的时间
       {
@@ -93,16 +106,103 @@ class Bench //用来度量时间的类
     }
   }
 
-  muduo::BlockingQueue<muduo::Timestamp> queue_;
+  std::unique_ptr<Queue> queue_;
   muduo::CountDownLatch latch_;
   std::vector<std::unique_ptr<muduo::Thread>> threads_;
 };
 
+template<typename Queue>
+void latency(Queue* queue, int threads)
+{
+  Bench<Queue> t(queue, threads);
+  t.run(10000);
+  t.joinAll();
+}
+
+template<typename Queue>
+double throughput(Queue* queue, int producers, int consumers)
+{
+  std::unique_ptr<Queue> owner(queue);
+  const int kItems = 1000000;
+  muduo::CountDownLatch go(1);
+  std::vector<std::unique_ptr<muduo::Thread>> threads;
+  for (int i = 0; i < producers; ++i)
+  {
+    int count = kItems / producers + (i < kItems % producers ? 1 : 0);
+    threads.emplace_back(new muduo::Thread([queue, &go, count]() {
+      go.wait();
+      for (int j = 0; j < count; ++j)
+      {
+        queue->put(j + 1);
+      }
+    }, "producer"));
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    threads.emplace_back(new muduo::Thread([queue]() {
+      while (queue->take() != 0)
+      {
+      }
+    }, "consumer"));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+
+  muduo::Timestamp start(muduo::Timestamp::now());
+  go.countDown();
+  for (int i = 0; i < producers; ++i)
+  {
+    threads[i]->join();
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    queue->put(0);
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    threads[producers + i]->join();
+  }
+  return kItems / timeDifference(muduo::Timestamp::now(), start);
+}
+
 int main(int argc, char* argv[])
 {
   int threads = argc > 1 ? atoi(argv[1]) : 1;
+  const char* queue = argc > 2 ? argv[2] : "blocking";
 
-  Bench t(threads);
-  t.run(10000);
-  t.joinAll();
+  typedef muduo::Timestamp T;
+  if (strcmp(queue, "blocking") == 0)
+  {
+    latency(new muduo::BlockingQueue<T>, threads);
+  }
+  else if (strcmp(queue, "bounded") == 0)
+  {
+    latency(new muduo::BoundedBlockingQueue<T>(kQueueSize), threads);
+  }
+  else if (strcmp(queue, "lockfree") == 0)
+  {
+    latency(new muduo::LockFreeBoundedQueue<T>(kQueueSize), threads);
+  }
+  else if (strcmp(queue, "spsc") == 0)
+  {
+    latency(new muduo::LockFreeBoundedQueue<T, true>(kQueueSize), 1);
+  }
+  else if (strcmp(queue, "throughput") == 0)
+  {
+    printf("%d producers, %d consumers\n", threads, threads);
+    printf("BlockingQueue             %10.0f items/s\n",
+           throughput(new muduo::BlockingQueue<int>, threads, threads));
+    printf("BoundedBlockingQueue      %10.0f items/s\n",
+           throughput(new muduo::BoundedBlockingQueue<int>(kQueueSize), threads, threads));
+    printf("LockFreeBoundedQueue      %10.0f items/s\n",
+           throughput(new muduo::LockFreeBoundedQueue<int>(kQueueSize), threads, threads));
+    printf("LockFreeBoundedQueue SPSC %10.0f items/s (1 producer, 1 consumer)\n",
+           throughput(new muduo::LockFreeBoundedQueue<int, true>(kQueueSize), 1, 1));
+  }
+  else
+  {
+    printf("Usage: %s [threads] [blocking|bounded|lockfree|spsc|throughput]\n", argv[0]);
+  }
 }
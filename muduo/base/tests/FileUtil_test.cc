@@ -1,13 +1,64 @@
 #include <muduo/base/FileUtil.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
 using namespace muduo;
 
+// appends in pieces of odd lengths, the last over 4MB, and reads back
+void testAppendFile(FileUtil::AppendFile::Mode mode, size_t existing)
+{
+  const char* filename = "fileutil_test.append";
+  ::unlink(filename);
+  string expected(existing, 'E');
+  if (existing > 0)
+  {
+    FileUtil::AppendFile file(filename);
+    file.append(expected.data(), expected.size());
+  }
+
+  FileUtil::AppendFile file(filename, mode);
+  const size_t lengths[] = { 1, 100, 4095, 4096, 4097, 12345, 5*1000*1000 };
+  for (size_t len : lengths)
+  {
+    string piece;
+    for (size_t i = 0; i < len; ++i)
+    {
+      piece += static_cast<char>('a' + (i + expected.size()) % 26);
+    }
+    file.append(piece.data(), piece.size());
+    file.flush();
+    expected += piece;
+
+    string content;
+    int err = FileUtil::readFile(filename, 64*1024*1024, &content);
+    if (err != 0 || content != expected)
+    {
+      printf("WRONG: mode %d, %zd bytes read, %zd expected\n", mode, content.size(), expected.size());
+      exit(1);
+    }
+  }
+  if (file.writtenBytes() != static_cast<off_t>(expected.size() - existing))
+  {
+    printf("WRONG: mode %d, writtenBytes %zd\n", mode, static_cast<size_t>(file.writtenBytes()));
+    exit(1);
+  }
+  printf("mode %d, %zd bytes existing: mode %d, %zd bytes\n",
+         mode, existing, file.mode(), expected.size());
+  ::unlink(filename);
+}
+
 int main()
 {
+  testAppendFile(FileUtil::AppendFile::kBuffered, 0);
+  testAppendFile(FileUtil::AppendFile::kBlocks, 10);
+  testAppendFile(FileUtil::AppendFile::kDirect, 0);
+  testAppendFile(FileUtil::AppendFile::kDirect, 8192);
+  testAppendFile(FileUtil::AppendFile::kDirect, 10);  // kBlocks then
+
   string result;
   int64_t size = 0;
   int err = FileUtil::readFile("/proc/self", 1024, &result, &size);
@@ -0,0 +1,123 @@
+#undef NDEBUG
+#include <muduo/base/InplaceFunction.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <assert.h>
+
+typedef muduo::InplaceFunction<void ()> Functor;
+
+int g_live = 0;
+
+struct Counted
+{
+  Counted() { ++g_live; }
+  Counted(const Counted&) { ++g_live; }
+  Counted(Counted&&) noexcept { ++g_live; }
+  ~Counted() { --g_live; }
+  void operator()() const { }
+};
+
+struct Big
+{
+  char data[256];
+  Counted counted;
+  int* result;
+  void operator()() const { *result = 42; }
+};
+
+int add(int a, int b)
+{
+  return a + b;
+}
+
+int main()
+{
+  {
+  Functor f;
+  assert(!f);
+  f = nullptr;
+  assert(!f);
+  bool thrown = false;
+  try
+  {
+    f();
+  }
+  catch (const std::bad_function_call&)
+  {
+    thrown = true;
+  }
+  assert(thrown);
+  }
+
+  {
+  // empty sources make empty ones, as std::function does
+  Functor f{std::function<void ()>()};
+  assert(!f);
+  int (*fp)(int, int) = NULL;
+  muduo::InplaceFunction<int (int, int)> g(fp);
+  assert(!g);
+  std::function<int (int, int)> h(add);
+  muduo::InplaceFunction<int (int, int)> k(h);
+  assert(k && k(2, 3) == 5);
+  }
+
+  {
+  muduo::InplaceFunction<int (int, int)> f(add);
+  assert(f);
+  assert(f(1, 2) == 3);
+  muduo::InplaceFunction<int (int)> g(std::bind(add, 10, std::placeholders::_1));
+  assert(g(5) == 15);
+  }
+
+  {
+  // move-only capture
+  std::unique_ptr<int> p(new int(7));
+  int result = 0;
+  int* r = &result;
+  std::shared_ptr<int> q(std::move(p));
+  Functor f([q, r] { *r = *q; });
+  Functor g(std::move(f));
+  assert(!f);
+  g();
+  assert(result == 7);
+  }
+
+  {
+  // destroyed exactly once, inline and on heap
+  {
+  Functor f{Counted()};
+  assert(g_live == 1);
+  Functor g(std::move(f));
+  assert(g_live == 1);
+  f = std::move(g);
+  assert(g_live == 1);
+  f = nullptr;
+  assert(g_live == 0);
+  }
+  int result = 0;
+  {
+  Big big = Big();
+  big.result = &result;
+  assert(g_live == 1);
+  Functor f(big);
+  assert(g_live == 2);
+  Functor g(std::move(f));
+  assert(g_live == 2);
+  g();
+  }
+  assert(result == 42);
+  assert(g_live == 0);
+  }
+
+  {
+  std::string s(100, 'x');
+  std::string moved;
+  muduo::InplaceFunction<void (std::string&&)> f(
+      [&moved](std::string&& str) { moved = std::move(str); });
+  f(std::move(s));
+  assert(moved.size() == 100);
+  }
+}
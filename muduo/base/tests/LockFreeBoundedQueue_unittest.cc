@@ -0,0 +1,141 @@
+#undef NDEBUG
+#include <muduo/base/LockFreeBoundedQueue.h>
+#include <muduo/base/Thread.h>
+
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+void testBasics()
+{
+  LockFreeBoundedQueue<int> queue(5);
+  assert(queue.capacity() == 8);
+  assert(queue.empty());
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(queue.tryPut(i));
+  }
+  assert(queue.full());
+  assert(!queue.tryPut(8));
+  int x = -1;
+  for (int i = 0; i < 8; ++i)
+  {
+    assert(queue.tryTake(&x));
+    assert(x == i);
+  }
+  assert(!queue.tryTake(&x));
+  assert(queue.empty());
+}
+
+template<bool SPSC>
+void testMoveOnly()
+{
+  std::shared_ptr<int> counted(new int(42));
+  {
+    LockFreeBoundedQueue<std::unique_ptr<std::shared_ptr<int>>, SPSC> queue(4);
+    for (int i = 0; i < 3; ++i)
+    {
+      queue.put(std::unique_ptr<std::shared_ptr<int>>(new std::shared_ptr<int>(counted)));
+    }
+    assert(counted.use_count() == 4);
+    std::unique_ptr<std::shared_ptr<int>> p(queue.take());
+    assert(**p == 42);
+    p.reset();
+    assert(counted.use_count() == 3);
+  }
+  // leftovers destroyed with the queue
+  assert(counted.use_count() == 1);
+}
+
+// Every value is taken exactly once, and in order from each producer.
+template<bool SPSC>
+void testThreads(int producers, int consumers)
+{
+  const int kItems = 200000;
+  LockFreeBoundedQueue<int64_t, SPSC> queue(64);
+  std::vector<std::vector<int64_t>> taken(consumers);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < producers; ++i)
+  {
+    threads.emplace_back(new Thread([&queue, i]() {
+      for (int j = 0; j < kItems; ++j)
+      {
+        int64_t x = static_cast<int64_t>(i) << 32 | j;
+        if (j % 1000 == 0)
+        {
+          queue.spinPut(x);
+        }
+        else
+        {
+          queue.put(x);
+        }
+      }
+    }, "producer"));
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    threads.emplace_back(new Thread([&queue, &taken, i]() {
+      for (;;)
+      {
+        int64_t x = queue.take();
+        if (x < 0)
+        {
+          break;
+        }
+        taken[i].push_back(x);
+      }
+    }, "consumer"));
+  }
+  for (auto& thr : threads)
+  {
+    thr->start();
+  }
+  for (int i = 0; i < producers; ++i)
+  {
+    threads[i]->join();
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    queue.put(-1);
+  }
+  for (int i = 0; i < consumers; ++i)
+  {
+    threads[producers + i]->join();
+  }
+
+  std::vector<int> count(producers * kItems);
+  for (const auto& values : taken)
+  {
+    std::vector<int> last(producers, -1);
+    for (int64_t x : values)
+    {
+      int producer = static_cast<int>(x >> 32);
+      int seq = static_cast<int>(x & 0xffffffff);
+      assert(seq > last[producer]);
+      last[producer] = seq;
+      ++count[producer * kItems + seq];
+    }
+  }
+  for (int c : count)
+  {
+    assert(c == 1);
+  }
+  assert(queue.empty());
+}
+
+int main()
+{
+  testBasics();
+  testMoveOnly<false>();
+  testMoveOnly<true>();
+  testThreads<true>(1, 1);
+  testThreads<false>(1, 1);
+  testThreads<false>(3, 3);
+  testThreads<false>(4, 1);
+  testThreads<false>(1, 4);
+  printf("All tests passed\n");
+}
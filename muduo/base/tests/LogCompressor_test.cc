@@ -0,0 +1,164 @@
+#include <muduo/base/LogCompressor.h>
+#include <muduo/base/FileUtil.h>
+#include <muduo/base/GzipFile.h>
+#include <muduo/base/LogFile.h>
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+// Compresses log files in a directory of its own, checks what's kept
+// reads back the same, prints the ratio and the speed.
+
+void check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("WRONG: %s\n", what);
+    exit(1);
+  }
+}
+
+std::vector<string> listFiles()
+{
+  std::vector<string> names;
+  DIR* dir = ::opendir(".");
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (entry->d_name[0] != '.')
+    {
+      names.push_back(entry->d_name);
+    }
+  }
+  ::closedir(dir);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+string logLines(int file, int bytes)
+{
+  string lines;
+  char buf[256];
+  for (int i = 0; static_cast<int>(lines.size()) < bytes; ++i)
+  {
+    snprintf(buf, sizeof buf,
+             "20181121 06:%02d:%02d.%06d %5d INFO  connection %d from 10.0.%d.%d:%d is UP"
+             " - TcpServer.cc:%d\n",
+             file, i / 1000 % 60, i * 37 % 1000000, 12345 + i % 8, i, i % 256, i * 7 % 256,
+             40000 + i % 20000, 80 + i % 3);
+    lines += buf;
+  }
+  return lines;
+}
+
+string gunzip(const string& filename)
+{
+  GzipFile file = GzipFile::openForRead(filename);
+  check(file.valid(), "gzopen");
+  string content;
+  char buf[64 * 1024];
+  int n = 0;
+  while ((n = file.read(buf, sizeof buf)) > 0)
+  {
+    content.append(buf, n);
+  }
+  return content;
+}
+
+void testRetention()
+{
+  const int kBytes = 4 * 1000 * 1000;
+  std::vector<string> contents;
+  for (int i = 0; i < 5; ++i)
+  {
+    contents.push_back(logLines(i, kBytes));
+    char name[64];
+    snprintf(name, sizeof name, "lctest.2018112%d-060448.host.1.log", i);
+    FileUtil::AppendFile file(name);
+    file.append(contents.back().data(), contents.back().size());
+  }
+
+  Timestamp start(Timestamp::now());
+  {
+    LogCompressor compressor("lctest", 3, 0);
+    for (const string& name : listFiles())
+    {
+      compressor.compress(name);
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+
+  std::vector<string> kept = listFiles();
+  check(kept.size() == 3, "three files kept");
+  off_t compressed = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    char name[64];
+    snprintf(name, sizeof name, "lctest.2018112%d-060448.host.1.log.gz", i + 2);
+    check(kept[i] == name, "the newest kept");
+    check(gunzip(name) == contents[i + 2], "same content");
+    int64_t size = 0;
+    string ignored;
+    FileUtil::readFile(name, 0, &ignored, &size);
+    compressed += size;
+  }
+  printf("%d MB compressed %.1fx, %.1f MB/s\n", 5 * kBytes / 1000 / 1000,
+         3.0 * kBytes / static_cast<double>(compressed), 5 * kBytes / seconds / 1e6);
+
+  // room for two of them
+  {
+    LogCompressor compressor("lctest", 0, compressed * 2 / 3 + 1);
+    string name("lctest.20181126-060448.host.1.log");
+    FileUtil::AppendFile file(name);
+    file.append(contents[0].data(), contents[0].size());
+    compressor.compress(name);
+  }
+  kept = listFiles();
+  check(kept.size() == 2 && kept[1] == "lctest.20181126-060448.host.1.log.gz",
+        "kept within maxBytes");
+  for (const string& name : kept)
+  {
+    ::unlink(name.c_str());
+  }
+}
+
+void testLogFile()
+{
+  string line("a line to compress\n");
+  {
+    LogCompressor compressor("lctest", 3, 0);
+    LogFile file("lctest", 1000 * 1000, false);
+    file.setRollCallback(std::bind(&LogCompressor::compress, &compressor, std::placeholders::_1));
+    file.append(line.data(), static_cast<int>(line.size()));
+    ::sleep(1);  // rolls once a second at most
+    check(file.rollFile(), "rolled");
+  }
+
+  std::vector<string> names = listFiles();
+  check(names.size() == 2, "one compressed, one current");
+  check(names[0].find(".log.gz") != string::npos, "compressed");
+  check(names[1].find(".log.gz") == string::npos, "current");
+  check(gunzip(names[0]) == line, "rolled content");
+  for (const string& name : names)
+  {
+    ::unlink(name.c_str());
+  }
+}
+
+int main()
+{
+  char dir[] = "/tmp/logcompressor_test.XXXXXX";
+  check(::mkdtemp(dir) != NULL && ::chdir(dir) == 0, "mkdtemp");
+  testRetention();
+  testLogFile();
+  check(listFiles().empty(), "nothing left");
+  ::rmdir(dir);
+  printf("PASSED\n");
+}
@@ -43,8 +43,9 @@ void bench(const char* type)
   }
   muduo::Timestamp end(muduo::Timestamp::now());
   double seconds = timeDifference(end, start);
-  printf("%12s: %f seconds, %d bytes, %10.2f msg/s, %.2f MiB/s\n",
-         type, seconds, g_total, n / seconds, g_total / seconds / (1024 * 1024));
+  printf("%12s: %f seconds, %d bytes, %10.2f msg/s, %.2f MiB/s, %.1f ns/msg\n",
+         type, seconds, g_total, n / seconds, g_total / seconds / (1024 * 1024),
+         seconds * 1e9 / n);
 }
 
 void logInThread()
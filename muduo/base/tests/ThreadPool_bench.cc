@@ -0,0 +1,99 @@
+#include <muduo/base/ThreadPool.h>
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Producer threads, like I/O threads offloading work, run() tasks into
+// a pool until all of them have run, for ThreadPool and
+// WorkStealingThreadPool, with tiny (empty) and medium (~10us) tasks.
+//
+// Usage: threadpool_bench [num_workers] [num_producers] [num_tasks]
+
+muduo::AtomicInt64 g_remaining;
+muduo::CountDownLatch* g_done = NULL;
+volatile uint64_t g_sink;
+
+void done()
+{
+  if (g_remaining.decrementAndGet() == 0)
+  {
+    g_done->countDown();
+  }
+}
+
+void tinyTask()
+{
+  done();
+}
+
+void mediumTask()
+{
+  uint64_t h = 14695981039346656037ull;
+  for (int i = 0; i < 4000; ++i)
+  {
+    h = (h ^ static_cast<uint64_t>(i)) * 1099511628211ull;
+  }
+  g_sink = h;
+  done();
+}
+
+template<typename Pool>
+double bench(int numWorkers, int numProducers, int numTasks, void (*task)())
+{
+  Pool pool;
+  pool.start(numWorkers);
+  muduo::CountDownLatch done(1);
+  g_done = &done;
+  g_remaining.getAndSet(numTasks);
+
+  muduo::CountDownLatch go(1);
+  std::vector<std::unique_ptr<muduo::Thread>> producers;
+  for (int i = 0; i < numProducers; ++i)
+  {
+    int count = numTasks / numProducers + (i < numTasks % numProducers ? 1 : 0);
+    producers.emplace_back(new muduo::Thread([&pool, &go, count, task]() {
+      go.wait();
+      for (int j = 0; j < count; ++j)
+      {
+        pool.run(task);
+      }
+    }, "producer"));
+    producers.back()->start();
+  }
+
+  muduo::Timestamp start(muduo::Timestamp::now());
+  go.countDown();
+  done.wait();
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  for (auto& thr : producers)
+  {
+    thr->join();
+  }
+  pool.stop();
+  return static_cast<double>(numTasks) / seconds;
+}
+
+int main(int argc, char* argv[])
+{
+  int numWorkers = argc > 1 ? atoi(argv[1]) : 4;
+  int numProducers = argc > 2 ? atoi(argv[2]) : 2;
+  int numTasks = argc > 3 ? atoi(argv[3]) : 1000000;
+
+  printf("%d workers, %d producers, %d tasks\n", numWorkers, numProducers, numTasks);
+  printf("tiny   ThreadPool             %10.0f tasks/s\n",
+         bench<muduo::ThreadPool>(numWorkers, numProducers, numTasks, tinyTask));
+  printf("tiny   WorkStealingThreadPool %10.0f tasks/s\n",
+         bench<muduo::WorkStealingThreadPool>(numWorkers, numProducers, numTasks, tinyTask));
+  printf("medium ThreadPool             %10.0f tasks/s\n",
+         bench<muduo::ThreadPool>(numWorkers, numProducers, numTasks / 10, mediumTask));
+  printf("medium WorkStealingThreadPool %10.0f tasks/s\n",
+         bench<muduo::WorkStealingThreadPool>(numWorkers, numProducers, numTasks / 10, mediumTask));
+}
@@ -1,6 +1,8 @@
 #include <muduo/base/TimeZone.h>
 #include <muduo/base/Types.h>
 
+#include <limits>
+
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
@@ -63,6 +65,16 @@ void test(const TimeZone& tz, TestCase tc)
     printf("WRONG: ");
   }
   printf("%s -> %s\n", tc.gmt, buf);
+
+  time_t from = 0, until = 0;
+  time_t offset = tz.gmtOffset(gmt, &from, &until);
+  if (offset != local.tm_gmtoff || gmt < from || gmt >= until
+      || (from > 0 && tz.toLocalTime(from).tm_gmtoff != offset)
+      || (until != std::numeric_limits<time_t>::max() && tz.toLocalTime(until - 1).tm_gmtoff != offset))
+  {
+    printf("WRONG gmtOffset: %ld in [%ld, %ld)\n",
+           static_cast<long>(offset), static_cast<long>(from), static_cast<long>(until));
+  }
   }
 
   {
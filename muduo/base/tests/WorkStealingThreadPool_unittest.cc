@@ -0,0 +1,162 @@
+#undef NDEBUG
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/Atomic.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Thread.h>
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace muduo;
+
+// Every task runs exactly once: from several outside threads, from tasks
+// (forking a tree, which overflows the initial deque), with a bounded
+// queue, and with idle periods long enough for workers to fall asleep.
+// Tasks run() while the pool stops are destroyed, not leaked.
+
+const int kWorkers = 4;
+
+AtomicInt64 g_ran;
+
+void countTask()
+{
+  g_ran.increment();
+}
+
+void forkTree(WorkStealingThreadPool* pool, int depth, CountDownLatch* latch)
+{
+  g_ran.increment();
+  if (depth == 0)
+  {
+    latch->countDown();
+    return;
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    pool->run(std::bind(forkTree, pool, depth - 1, latch));
+  }
+}
+
+void testOutside(int maxQueueSize)
+{
+  WorkStealingThreadPool pool("outside");
+  pool.setMaxQueueSize(maxQueueSize);
+  pool.start(kWorkers);
+  g_ran.getAndSet(0);
+
+  const int kProducers = 3;
+  const int kTasks = 100000;
+  std::vector<std::unique_ptr<Thread>> producers;
+  for (int i = 0; i < kProducers; ++i)
+  {
+    producers.emplace_back(new Thread([&pool, maxQueueSize]() {
+      for (int j = 0; j < kTasks; ++j)
+      {
+        pool.run(countTask);
+        if (maxQueueSize > 0)
+        {
+          assert(pool.queueSize() <= static_cast<size_t>(maxQueueSize));
+        }
+      }
+    }, "producer"));
+    producers.back()->start();
+  }
+  for (auto& thr : producers)
+  {
+    thr->join();
+  }
+  CountDownLatch latch(1);
+  // after the producers, so every worker is busy or asleep by now
+  while (g_ran.get() < kProducers * kTasks)
+  {
+    ::usleep(1000);
+  }
+  pool.run(std::bind(&CountDownLatch::countDown, &latch));
+  latch.wait();
+  assert(g_ran.get() == kProducers * kTasks);
+  pool.stop();
+}
+
+void testFork()
+{
+  WorkStealingThreadPool pool("fork");
+  pool.start(kWorkers);
+  g_ran.getAndSet(0);
+  const int kDepth = 15;
+  CountDownLatch latch(1 << kDepth);
+  pool.run(std::bind(forkTree, &pool, kDepth, &latch));
+  latch.wait();
+  assert(g_ran.get() == (2 << kDepth) - 1);
+  pool.stop();
+}
+
+void testIdle()
+{
+  WorkStealingThreadPool pool("idle");
+  pool.start(kWorkers);
+  for (int i = 0; i < 20; ++i)
+  {
+    ::usleep(10 * 1000);  // all asleep
+    CountDownLatch latch(kWorkers * 2);
+    for (int j = 0; j < kWorkers * 2; ++j)
+    {
+      pool.run(std::bind(&CountDownLatch::countDown, &latch));
+    }
+    latch.wait();
+  }
+}
+
+void testStop(int maxQueueSize)
+{
+  std::shared_ptr<int> token(new int(0));
+  {
+    WorkStealingThreadPool pool("stop");
+    pool.setMaxQueueSize(maxQueueSize);
+    pool.start(kWorkers);
+    std::vector<std::unique_ptr<Thread>> producers;
+    for (int i = 0; i < 2; ++i)
+    {
+      producers.emplace_back(new Thread([&pool, token]() {
+        for (int j = 0; j < 100000; ++j)
+        {
+          pool.run([token]() { });
+        }
+      }));
+      producers.back()->start();
+    }
+    ::usleep(1000);
+    pool.stop();
+    for (auto& thr : producers)
+    {
+      thr->join();
+    }
+  }
+  assert(token.use_count() == 1);
+}
+
+void testInline()
+{
+  WorkStealingThreadPool pool("inline");
+  pool.start(0);
+  int tid = 0;
+  pool.run([&tid]() { tid = CurrentThread::tid(); });
+  assert(tid == CurrentThread::tid());
+}
+
+int main()
+{
+  testOutside(0);
+  testOutside(16);
+  testFork();
+  testIdle();
+  testStop(0);
+  testStop(16);
+  testInline();
+  printf("All tests passed\n");
+}
@@ -26,6 +26,7 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
   : loop_(loop),
     acceptSocket_(sockets::createNonblockingOrDie(listenAddr.family())),//创建了一个套接字
     acceptChannel_(loop, acceptSocket_.fd()),//关注套接字的一些事件
+    acceptBudget_(1),
     listenning_(false),
     idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))//预先准备了空闲文件描述符
 {
@@ -55,36 +56,57 @@ void Acceptor::listen()
 void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
-  InetAddress peerAddr;
-  //FIXME loop until no more
-  int connfd = acceptSocket_.accept(&peerAddr);
-  if (connfd >= 0) //得到一个连接
+  for (int i = 0; i < acceptBudget_; ++i)
   {
-    // 接受连接
-    // string hostport = peerAddr.toIpPort();
-    // LOG_TRACE << "Accepts of " << hostport;
-    if (newConnectionCallback_)
+    InetAddress peerAddr;
+    int connfd = acceptSocket_.accept(&peerAddr);
+    if (connfd >= 0) //得到一个连接
     {
-      newConnectionCallback_(connfd, peerAddr);
+      // 接受连接
+      // string hostport = peerAddr.toIpPort();
+      // LOG_TRACE << "Accepts of " << hostport;
+      if (newConnectionsCallback_)
+      {
+        accepted_.push_back(std::make_pair(connfd, peerAddr));
+      }
+      else if (newConnectionCallback_)
+      {
+        newConnectionCallback_(connfd, peerAddr);
+      }
+      else//没设置上层回调函数时关掉
+      {
+        sockets::close(connfd);
+      }
     }
-    else//没设置上层回调函数时关掉
-    {
-      sockets::close(connfd);
-    }
-  }
-  else //失败了
-  {
-    LOG_SYSERR << "in Acceptor::handleRead";
-    // Read the section named "The special problem of
-    // accept()ing when you can't" in libev's doc.
-    // By Marc Lehmann, author of libev.
-    if (errno == EMFILE)//文件描述符太多
+    else //失败了
     {
+      if (errno == EAGAIN)  // drained
+      {
+        break;
+      }
+      if (errno != EMFILE && errno != ENFILE)
+      {
+        // ECONNABORTED, EINTR, EPROTO, EPERM: about this one connection,
+        // those queued behind it can still be accepted
+        continue;
+      }
+      LOG_SYSERR << "in Acceptor::handleRead";
+      // Read the section named "The special problem of
+      // accept()ing when you can't" in libev's doc.
+      // By Marc Lehmann, author of libev.
+      // 文件描述符太多
       ::close(idleFd_); //关闭空闲文件描述符，以便腾出一个文件描述符接受新文件描述符；否则不处理的话会一直触发
       idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
       ::close(idleFd_); //接受后关闭掉
       idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+      break;
     }
   }
+
+  if (!accepted_.empty())
+  {
+    newConnectionsCallback_(accepted_);
+    accepted_.clear();
+  }
 }
 
@@ -12,8 +12,11 @@
 #define MUDUO_NET_ACCEPTOR_H
 
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include <muduo/net/Channel.h>
+#include <muduo/net/InetAddress.h>
 #include <muduo/net/Socket.h>
 
 namespace muduo
@@ -22,7 +25,6 @@ namespace net
 {
 
 class EventLoop;
-class InetAddress;
 
 ///
 /// Acceptor of incoming TCP connections.
@@ -31,16 +33,33 @@ class Acceptor : noncopyable
 {
  public:
   typedef std::function<void (int sockfd, const InetAddress&)> NewConnectionCallback;
+  typedef std::vector<std::pair<int, InetAddress>> AcceptedList;
+  typedef std::function<void (const AcceptedList&)> NewConnectionsCallback;
 
   Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reuseport);
   ~Acceptor();
 
   void setNewConnectionCallback(const NewConnectionCallback& cb)
   { newConnectionCallback_ = cb; }
+  /// Called once per wakeup with all connections accepted in it,
+  /// instead of the above.
+  void setNewConnectionsCallback(const NewConnectionsCallback& cb)
+  { newConnectionsCallback_ = cb; }
+  /// Accepts up to @c budget connections per wakeup, default 1.
+  /// A big budget drains a burst with one epoll_wait() instead of many,
+  /// a small one keeps other channels of the loop from waiting on it.
+  void setAcceptBudget(int budget)
+  { acceptBudget_ = budget > 0 ? budget : 1; }
 
+  EventLoop* getLoop() const { return loop_; }
   bool listenning() const { return listenning_; }
   void listen();
 
+  /// see Socket::attachReusePortCpuFilter()
+  bool attachReusePortCpuFilter(int groupSize,
+                                const std::vector<int>& indexOfCpu = std::vector<int>())
+  { return acceptSocket_.attachReusePortCpuFilter(groupSize, indexOfCpu); }
+
  private:
   void handleRead();
 
@@ -49,6 +68,9 @@ class Acceptor : noncopyable
   Channel acceptChannel_; //用于观察此socket的readable事件，Poller::poll能够返回此channel，调用handleEvent,并回调Acceptor::handleRead()
   // Acceptor::handleRead()会调用accept(2)来接受新连接，并回调用户callback
   NewConnectionCallback newConnectionCallback_; //
+  NewConnectionsCallback newConnectionsCallback_;
+  AcceptedList accepted_;  // of one handleRead(), reused
+  int acceptBudget_;
   bool listenning_; //channel所属的EventLoop是否处在监听状态
   int idleFd_;
 };
@@ -9,6 +9,7 @@
 
 #include <muduo/net/Buffer.h>
 
+#include <muduo/net/BufferSearch.h>
 #include <muduo/net/SocketsOps.h>
 
 #include <errno.h>
@@ -22,6 +23,58 @@ const char Buffer::kCRLF[] = "\r\n";
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
+static_assert(BufferPool::kMinBlockSize == Buffer::kCheapPrepend + Buffer::kInitialSize,
+              "a new Buffer takes the smallest block");
+
+void Buffer::releaseToPool()
+{
+  // a Buffer on the heap keeps what it has grown to, as it always did
+  BufferPool* pool = buffer_.get_allocator().pool().get();  // kept alive by buffer_
+  if (pool && buffer_.capacity() > pool->maxIdleCapacity())
+  {
+    std::vector<char, Allocator> empty(kCheapPrepend, buffer_.get_allocator());
+    buffer_.swap(empty);
+  }
+}
+
+const char* Buffer::findDelimiter(const char* start, const StringPiece& delim) const
+{
+  assert(peek() <= start);
+  assert(start <= beginWrite());
+  if (delim.size() != 1 && delim.size() != 2)
+  {
+    if (delim.empty())
+    {
+      return NULL;
+    }
+    const char* found = std::search(start, static_cast<const char*>(beginWrite()),
+                                    delim.begin(), delim.end());
+    return found == beginWrite() ? NULL : found;
+  }
+  const uint32_t key = static_cast<uint32_t>(delim.size()) << 16
+      | static_cast<uint32_t>(static_cast<unsigned char>(delim[0])) << 8
+      | (delim.size() == 2 ? static_cast<unsigned char>(delim[1]) : 0);
+  const char* known = peek();  // no delim starts before it
+  if (key == scannedDelimiter_)
+  {
+    assert(scannedBytes_ <= readableBytes());
+    known += scannedBytes_;
+  }
+  const char* end = beginWrite();
+  const char* from = std::max(start, known);
+  const char* found = delim.size() == 1
+      ? search::findByte(from, end, delim[0])
+      : search::findPair(from, end, delim[0], delim[1]);
+  if (start <= known)  // all of it before found or end is searched now
+  {
+    const size_t unsearched = static_cast<size_t>(delim.size() - 1);  // may start one yet to come
+    scannedDelimiter_ = key;
+    scannedBytes_ = found ? implicit_cast<size_t>(found - peek())
+                          : readableBytes() - std::min(readableBytes(), unsearched);
+  }
+  return found;
+}
+
 // 结合栈上的空间，避免内存使用过大，提高内存使用率
 // 如果有5k个连接，每个连接就分配64k(接收缓冲区）+64k（发送缓冲区）的缓冲区的话，将占用640M内存，
 // 而大多数时间，这些缓冲区的使用率很低
@@ -15,6 +15,7 @@
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
+#include <muduo/net/BufferPool.h>
 #include <muduo/net/Endian.h>
 
 #include <algorithm>
@@ -39,6 +40,15 @@ namespace net
 /// |                   |                  |                  |
 /// 0      <=      readerIndex   <=   writerIndex    <=     size
 /// @endcode
+///
+/// A Buffer made with a BufferPool takes its storage from the pool.
+/// Whenever it is drained, by retrieveAll() or shrink(), storage grown
+/// past BufferPool::maxIdleCapacity() goes back to the pool, leaving
+/// no writable bytes until the next write.
+///
+/// findCRLF(), findEOL() and findDelimiter() are const but remember how
+/// far they searched, so unlike other const members they must not be
+/// called on one Buffer from two threads at once without a lock.
 class Buffer : public muduo::copyable
 {
  public:
@@ -48,7 +58,22 @@ class Buffer : public muduo::copyable
   explicit Buffer(size_t initialSize = kInitialSize)
     : buffer_(kCheapPrepend + initialSize),
       readerIndex_(kCheapPrepend),
-      writerIndex_(kCheapPrepend)
+      writerIndex_(kCheapPrepend),
+      scannedDelimiter_(0),
+      scannedBytes_(0)
+  {
+    assert(readableBytes() == 0);
+    assert(writableBytes() == initialSize);
+    assert(prependableBytes() == kCheapPrepend);
+  }
+
+  explicit Buffer(const std::shared_ptr<BufferPool>& pool,
+                  size_t initialSize = kInitialSize)
+    : buffer_(kCheapPrepend + initialSize, Allocator(pool)),
+      readerIndex_(kCheapPrepend),
+      writerIndex_(kCheapPrepend),
+      scannedDelimiter_(0),
+      scannedBytes_(0)
   {
     assert(readableBytes() == 0);
     assert(writableBytes() == initialSize);
@@ -58,11 +83,14 @@ class Buffer : public muduo::copyable
   // implicit copy-ctor, move-ctor, dtor and assignment are fine
   // NOTE: implicit move-ctor is added in g++ 4.6
 
+  // the pool goes with the storage, a copy is on the heap
   void swap(Buffer& rhs)
   {
     buffer_.swap(rhs.buffer_);
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(scannedDelimiter_, rhs.scannedDelimiter_);
+    std::swap(scannedBytes_, rhs.scannedBytes_);
   }
 
   size_t readableBytes() const
@@ -79,34 +107,36 @@ class Buffer : public muduo::copyable
 
   const char* findCRLF() const
   {
-    // FIXME: replace with memmem()?
-    const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return findDelimiter(peek(), StringPiece(kCRLF, 2));
   }
 
   const char* findCRLF(const char* start) const
   {
-    assert(peek() <= start);
-    assert(start <= beginWrite());
-    // FIXME: replace with memmem()?
-    const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? NULL : crlf;
+    return findDelimiter(start, StringPiece(kCRLF, 2));
   }
 
   const char* findEOL() const
   {
-    const void* eol = memchr(peek(), '\n', readableBytes());
-    return static_cast<const char*>(eol);
+    return findDelimiter(peek(), StringPiece("\n", 1));
   }
 
   const char* findEOL(const char* start) const
   {
-    assert(peek() <= start);
-    assert(start <= beginWrite());
-    const void* eol = memchr(start, '\n', beginWrite() - start);
-    return static_cast<const char*>(eol);
+    return findDelimiter(start, StringPiece("\n", 1));
   }
 
+  /// First @c delim of one or two bytes, NULL if none, with SSE2 or AVX2
+  /// if the CPU has them.  The search resumes where the previous one for
+  /// the same delimiter ended, so parsing a message as it arrives doesn't
+  /// scan the same bytes again.  A longer @c delim is searched with
+  /// std::search every time, an empty one is never found.
+  const char* findDelimiter(const StringPiece& delim) const
+  {
+    return findDelimiter(peek(), delim);
+  }
+
+  const char* findDelimiter(const char* start, const StringPiece& delim) const;
+
   // retrieve returns void, to prevent
   // string str(retrieve(readableBytes()), readableBytes());
   // the evaluation of two functions are unspecified
@@ -116,6 +146,7 @@ class Buffer : public muduo::copyable
     if (len < readableBytes())
     {
       readerIndex_ += len;
+      scannedBytes_ = scannedBytes_ > len ? scannedBytes_ - len : 0;
     }
     else
     {
@@ -154,6 +185,11 @@ class Buffer : public muduo::copyable
   {
     readerIndex_ = kCheapPrepend;
     writerIndex_ = kCheapPrepend;
+    scannedBytes_ = 0;
+    if (buffer_.capacity() > kCheapPrepend + kInitialSize)
+    {
+      releaseToPool();
+    }
   }
 
   string retrieveAllAsString()
@@ -217,6 +253,8 @@ class Buffer : public muduo::copyable
   {
     assert(len <= readableBytes());
     writerIndex_ -= len;
+    // the last byte left may start a delimiter with what comes next
+    scannedBytes_ = std::min(scannedBytes_, readableBytes() > 0 ? readableBytes() - 1 : 0);
   }
 
   ///
@@ -356,6 +394,7 @@ class Buffer : public muduo::copyable
   {
     assert(len <= prependableBytes());
     readerIndex_ -= len;
+    scannedBytes_ = 0;
     const char* d = static_cast<const char*>(data);
     std::copy(d, d+len, begin()+readerIndex_);
   }
@@ -364,7 +403,7 @@ class Buffer : public muduo::copyable
   void shrink(size_t reserve)
   {
     // FIXME: use vector::shrink_to_fit() in C++ 11 if possible.
-    Buffer other;
+    Buffer other(pool(), kInitialSize);
     other.ensureWritableBytes(readableBytes()+reserve);
     other.append(toStringPiece());
     swap(other);
@@ -375,6 +414,12 @@ class Buffer : public muduo::copyable
     return buffer_.capacity();
   }
 
+  /// NULL if on the heap.
+  std::shared_ptr<BufferPool> pool() const
+  {
+    return buffer_.get_allocator().pool();
+  }
+
   /// Read data directly into buffer.
   ///
   /// It may implement with readv(2)
@@ -389,6 +434,8 @@ class Buffer : public muduo::copyable
   const char* begin() const
   { return &*buffer_.begin(); }
 
+  void releaseToPool();
+
   void makeSpace(size_t len)
   {
     if (writableBytes() + prependableBytes() < len + kCheapPrepend)
@@ -411,9 +458,13 @@ class Buffer : public muduo::copyable
   }
 
  private:
-  std::vector<char> buffer_; //vector用于替代固定大小数组
+  typedef BufferPoolAllocator<char> Allocator;
+  std::vector<char, Allocator> buffer_; //vector用于替代固定大小数组
   size_t readerIndex_; //读位置
   size_t writerIndex_; //写位置
+  // no scannedDelimiter_ starts in the first scannedBytes_ readable bytes
+  mutable uint32_t scannedDelimiter_;
+  mutable size_t scannedBytes_;
 
   static const char kCRLF[];
 };
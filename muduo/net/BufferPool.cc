@@ -0,0 +1,113 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/BufferPool.h>
+
+#include <muduo/base/CurrentThread.h>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t BufferPool::kMinBlockSize;
+const int BufferPool::kNumClasses;
+
+BufferPool::BufferPool(size_t maxCachedBytes)
+  : threadId_(CurrentThread::tid()),
+    maxCachedBytes_(maxCachedBytes),
+    maxIdleCapacity_(kMinBlockSize),
+    cachedBytes_(0),
+    numAllocated_(0),
+    numReused_(0)
+{
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    freeLists_[i] = NULL;
+  }
+}
+
+BufferPool::~BufferPool()
+{
+  // the last Buffer may go away in any thread, nobody else can touch us now
+  freeCached();
+}
+
+int BufferPool::sizeClass(size_t bytes)
+{
+  // a block would be more than half wasted, e.g. Buffer(0)
+  if (bytes < kMinBlockSize / 2)
+  {
+    return -1;
+  }
+  int cls = 0;
+  while (cls < kNumClasses && blockSize(cls) < bytes)
+  {
+    ++cls;
+  }
+  return cls < kNumClasses ? cls : -1;
+}
+
+bool BufferPool::inOwnerThread() const
+{
+  return threadId_ == CurrentThread::tid();
+}
+
+void* BufferPool::allocate(size_t bytes)
+{
+  int cls = sizeClass(bytes);
+  if (cls < 0)
+  {
+    return ::operator new(bytes);
+  }
+  if (inOwnerThread())
+  {
+    if (FreeBlock* block = freeLists_[cls])
+    {
+      freeLists_[cls] = block->next;
+      cachedBytes_ -= blockSize(cls);
+      ++numReused_;
+      return block;
+    }
+    ++numAllocated_;
+  }
+  // whole block, so that it can be cached when released in owner thread
+  return ::operator new(blockSize(cls));
+}
+
+void BufferPool::deallocate(void* p, size_t bytes)
+{
+  int cls = sizeClass(bytes);
+  if (cls >= 0
+      && inOwnerThread()
+      && cachedBytes_ + blockSize(cls) <= maxCachedBytes_)
+  {
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = freeLists_[cls];
+    freeLists_[cls] = block;
+    cachedBytes_ += blockSize(cls);
+  }
+  else
+  {
+    ::operator delete(p);
+  }
+}
+
+void BufferPool::trim()
+{
+  assert(inOwnerThread());
+  freeCached();
+}
+
+void BufferPool::freeCached()
+{
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    while (FreeBlock* block = freeLists_[i])
+    {
+      freeLists_[i] = block->next;
+      ::operator delete(block);
+    }
+  }
+  cachedBytes_ = 0;
+}
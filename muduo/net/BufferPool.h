@@ -0,0 +1,179 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_BUFFERPOOL_H
+#define MUDUO_NET_BUFFERPOOL_H
+
+#include <muduo/base/noncopyable.h>
+#include <muduo/base/Types.h>
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Recycles Buffer storage by size class, one per EventLoop, so that
+/// connection churn doesn't hit malloc for every connection.
+///
+/// Block sizes are kMinBlockSize times a power of 2, which is what
+/// Buffer grows through, from its kCheapPrepend + kInitialSize.
+/// A drained Buffer holding more than maxIdleCapacity() gives it back.
+/// Every block is a heap block on its own, only the thread which created
+/// the pool caches and reuses them, other threads take and release them
+/// on the heap directly, so Buffers may be used and destroyed anywhere.
+///
+class BufferPool : noncopyable
+{
+ public:
+  static const size_t kMinBlockSize = 1024 + 8;
+  static const int kNumClasses = 8;  // largest cached block is 129 KiB
+
+  /// Owned by the calling thread.
+  explicit BufferPool(size_t maxCachedBytes = 32 * 1024 * 1024);
+  ~BufferPool();
+
+  void* allocate(size_t bytes);
+  void deallocate(void* p, size_t bytes);
+
+  /// Frees the cached blocks, in owner thread.
+  void trim();
+
+  /// Most a drained Buffer of this pool keeps, one holding more gives
+  /// all its storage back and takes it again on the next write.
+  /// At least kMinBlockSize, the default.
+  void setMaxIdleCapacity(size_t bytes)
+  { maxIdleCapacity_ = bytes > kMinBlockSize ? bytes : kMinBlockSize; }
+  size_t maxIdleCapacity() const { return maxIdleCapacity_; }
+
+  /// Statistics of the owner thread, not safe to read from others.
+  size_t cachedBytes() const { return cachedBytes_; }
+  size_t maxCachedBytes() const { return maxCachedBytes_; }
+  int64_t numAllocated() const { return numAllocated_; }  // from the heap
+  int64_t numReused() const { return numReused_; }
+
+ private:
+  struct FreeBlock
+  {
+    FreeBlock* next;
+  };
+
+  /// -1 for sizes allocated exactly on the heap.
+  static int sizeClass(size_t bytes);
+  static size_t blockSize(int sizeClass)
+  { return kMinBlockSize << sizeClass; }
+
+  bool inOwnerThread() const;
+  void freeCached();
+
+  const pid_t threadId_;
+  const size_t maxCachedBytes_;
+  size_t maxIdleCapacity_;
+  size_t cachedBytes_;
+  int64_t numAllocated_;
+  int64_t numReused_;
+  FreeBlock* freeLists_[kNumClasses];
+};
+
+///
+/// Allocator of Buffer, takes from a BufferPool, or the heap without one.
+///
+/// The pool travels with the storage when a Buffer is swapped, moved or
+/// move-assigned, a copy of a Buffer is on the heap.  Elements are
+/// default-initialized, so growing a Buffer doesn't zero the bytes which
+/// are about to be written.
+///
+template<typename T>
+class BufferPoolAllocator
+{
+ public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  template<typename U>
+  struct rebind
+  {
+    typedef BufferPoolAllocator<U> other;
+  };
+
+  BufferPoolAllocator()
+  { }
+
+  explicit BufferPoolAllocator(const std::shared_ptr<BufferPool>& pool)
+    : pool_(pool)
+  { }
+
+  template<typename U>
+  BufferPoolAllocator(const BufferPoolAllocator<U>& rhs)
+    : pool_(rhs.pool())
+  { }
+
+  T* allocate(size_t n)
+  {
+    void* p = pool_ ? pool_->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T));
+    return static_cast<T*>(p);
+  }
+
+  void deallocate(T* p, size_t n)
+  {
+    if (pool_)
+    {
+      pool_->deallocate(p, n * sizeof(T));
+    }
+    else
+    {
+      ::operator delete(p);
+    }
+  }
+
+  template<typename U>
+  void construct(U* p)
+  {
+    ::new(static_cast<void*>(p)) U;
+  }
+
+  template<typename U, typename... Args>
+  void construct(U* p, Args&&... args)
+  {
+    ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  BufferPoolAllocator select_on_container_copy_construction() const
+  {
+    return BufferPoolAllocator();
+  }
+
+  const std::shared_ptr<BufferPool>& pool() const { return pool_; }
+
+ private:
+  std::shared_ptr<BufferPool> pool_;
+};
+
+template<typename T, typename U>
+bool operator==(const BufferPoolAllocator<T>& lhs, const BufferPoolAllocator<U>& rhs)
+{
+  return lhs.pool() == rhs.pool();
+}
+
+template<typename T, typename U>
+bool operator!=(const BufferPoolAllocator<T>& lhs, const BufferPoolAllocator<U>& rhs)
+{
+  return lhs.pool() != rhs.pool();
+}
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_BUFFERPOOL_H
@@ -0,0 +1,300 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/BufferSearch.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MUDUO_SEARCH_X86 1
+#endif
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const char* findBytePortable(const char* begin, const char* end, char c)
+{
+  return static_cast<const char*>(::memchr(begin, c, end - begin));
+}
+
+const char* findPairPortable(const char* begin, const char* end, char c1, char c2)
+{
+  const char* p = begin;
+  while (end - p >= 2)
+  {
+    p = static_cast<const char*>(::memchr(p, c1, end - p - 1));
+    if (p == NULL)
+    {
+      return NULL;
+    }
+    if (p[1] == c2)
+    {
+      return p;
+    }
+    ++p;
+  }
+  return NULL;
+}
+
+#ifdef MUDUO_SEARCH_X86
+
+// Fewer bytes than a vector, not worth a call to memchr().
+inline const char* findByteTail(const char* p, const char* end, char c)
+{
+  for (; p < end; ++p)
+  {
+    if (*p == c)
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+inline const char* findPairTail(const char* p, const char* end, char c1, char c2)
+{
+  for (; end - p >= 2; ++p)
+  {
+    if (p[0] == c1 && p[1] == c2)
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+// The pair kernels compare a block at p with c1 and the block at p + 1
+// with c2, a bit set in both is a match, so a pair across two blocks is
+// found too.  The loops test two or four blocks at once, like memchr().
+
+__attribute__((target("sse2")))
+const char* findByteSse2(const char* begin, const char* end, char c)
+{
+  const __m128i needle = _mm_set1_epi8(c);
+  const char* p = begin;
+  for (; end - p >= 32; p += 32)
+  {
+    __m128i eq0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), needle);
+    __m128i eq1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)), needle);
+    int mask = _mm_movemask_epi8(_mm_or_si128(eq0, eq1));
+    if (mask != 0)
+    {
+      int mask0 = _mm_movemask_epi8(eq0);
+      return mask0 != 0 ? p + __builtin_ctz(mask0)
+                        : p + 16 + __builtin_ctz(_mm_movemask_epi8(eq1));
+    }
+  }
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findByteTail(p, end, c);
+}
+
+__attribute__((target("sse2")))
+inline __m128i matchPairSse2(const char* p, __m128i first, __m128i second)
+{
+  __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+  return _mm_and_si128(_mm_cmpeq_epi8(block, first), _mm_cmpeq_epi8(next, second));
+}
+
+__attribute__((target("sse2")))
+const char* findPairSse2(const char* begin, const char* end, char c1, char c2)
+{
+  const __m128i first = _mm_set1_epi8(c1);
+  const __m128i second = _mm_set1_epi8(c2);
+  const char* p = begin;
+  for (; end - p > 32; p += 32)
+  {
+    __m128i match0 = matchPairSse2(p, first, second);
+    __m128i match1 = matchPairSse2(p + 16, first, second);
+    if (_mm_movemask_epi8(_mm_or_si128(match0, match1)) != 0)
+    {
+      int mask0 = _mm_movemask_epi8(match0);
+      return mask0 != 0 ? p + __builtin_ctz(mask0)
+                        : p + 16 + __builtin_ctz(_mm_movemask_epi8(match1));
+    }
+  }
+  for (; end - p > 16; p += 16)
+  {
+    int mask = _mm_movemask_epi8(matchPairSse2(p, first, second));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findPairTail(p, end, c1, c2);
+}
+
+__attribute__((target("avx2")))
+inline unsigned maskAvx2(__m256i x)
+{
+  return static_cast<unsigned>(_mm256_movemask_epi8(x));
+}
+
+// Past an unaligned first block, the AVX2 kernels load aligned blocks,
+// which never straddle cache lines.
+inline const char* nextAligned32(const char* p)
+{
+  return p + 32 - (reinterpret_cast<uintptr_t>(p) & 31);
+}
+
+__attribute__((target("avx2")))
+inline __m256i load32(const char* p)
+{
+  return _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+__attribute__((target("avx2")))
+const char* findByteAvx2(const char* begin, const char* end, char c)
+{
+  if (end - begin < 32)
+  {
+    return findByteSse2(begin, end, c);
+  }
+  const __m256i needle = _mm256_set1_epi8(c);
+  unsigned mask = maskAvx2(_mm256_cmpeq_epi8(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin)), needle));
+  if (mask != 0)
+  {
+    return begin + __builtin_ctz(mask);
+  }
+  const char* p = nextAligned32(begin);
+  for (; end - p >= 128; p += 128)
+  {
+    __m256i eq0 = _mm256_cmpeq_epi8(load32(p), needle);
+    __m256i eq1 = _mm256_cmpeq_epi8(load32(p + 32), needle);
+    __m256i eq2 = _mm256_cmpeq_epi8(load32(p + 64), needle);
+    __m256i eq3 = _mm256_cmpeq_epi8(load32(p + 96), needle);
+    __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+    if (!_mm256_testz_si256(any, any))
+    {
+      uint64_t low = maskAvx2(eq0) | static_cast<uint64_t>(maskAvx2(eq1)) << 32;
+      if (low != 0)
+      {
+        return p + __builtin_ctzll(low);
+      }
+      uint64_t high = maskAvx2(eq2) | static_cast<uint64_t>(maskAvx2(eq3)) << 32;
+      return p + 64 + __builtin_ctzll(high);
+    }
+  }
+  for (; end - p >= 32; p += 32)
+  {
+    mask = maskAvx2(_mm256_cmpeq_epi8(load32(p), needle));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  if (p < end)
+  {
+    // the last 32 bytes, those before p didn't match
+    const char* last = end - 32;
+    mask = maskAvx2(_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last)), needle));
+    if (mask != 0)
+    {
+      return last + __builtin_ctz(mask);
+    }
+  }
+  return NULL;
+}
+
+// For 64 aligned bytes at p, bit i set if p[i] == c1 and p[i + 1] == c2,
+// the bit for p[64] comes from the caller.
+__attribute__((target("avx2")))
+inline uint64_t matchPairAvx2(const char* p, __m256i first, __m256i second, bool nextIsSecond)
+{
+  __m256i block0 = load32(p);
+  __m256i block1 = load32(p + 32);
+  uint64_t firsts = maskAvx2(_mm256_cmpeq_epi8(block0, first))
+      | static_cast<uint64_t>(maskAvx2(_mm256_cmpeq_epi8(block1, first))) << 32;
+  uint64_t seconds = maskAvx2(_mm256_cmpeq_epi8(block0, second))
+      | static_cast<uint64_t>(maskAvx2(_mm256_cmpeq_epi8(block1, second))) << 32;
+  return firsts & (seconds >> 1 | static_cast<uint64_t>(nextIsSecond) << 63);
+}
+
+__attribute__((target("avx2")))
+const char* findPairAvx2(const char* begin, const char* end, char c1, char c2)
+{
+  if (end - begin <= 96)
+  {
+    return findPairSse2(begin, end, c1, c2);
+  }
+  // the first block may start a pair, nextAligned32() begins after it
+  const char* head = findPairSse2(begin, begin + 33, c1, c2);
+  if (head != NULL)
+  {
+    return head;
+  }
+  const __m256i first = _mm256_set1_epi8(c1);
+  const __m256i second = _mm256_set1_epi8(c2);
+  const char* p = nextAligned32(begin);
+  for (; end - p > 64; p += 64)
+  {
+    uint64_t match = matchPairAvx2(p, first, second, p[64] == c2);
+    if (match != 0)
+    {
+      return p + __builtin_ctzll(match);
+    }
+  }
+  return findPairSse2(p, end, c1, c2);
+}
+
+#endif  // MUDUO_SEARCH_X86
+
+std::vector<search::Kernels> detectKernels()
+{
+  std::vector<search::Kernels> kernels;
+  search::Kernels portable = { "memchr", findBytePortable, findPairPortable };
+  kernels.push_back(portable);
+#ifdef MUDUO_SEARCH_X86
+  __builtin_cpu_init();  // may run before the constructor of libgcc
+  if (__builtin_cpu_supports("sse2"))
+  {
+    search::Kernels sse2 = { "sse2", findByteSse2, findPairSse2 };
+    kernels.push_back(sse2);
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    search::Kernels avx2 = { "avx2", findByteAvx2, findPairAvx2 };
+    kernels.push_back(avx2);
+  }
+#endif
+  return kernels;
+}
+
+const search::Kernels& bestKernels()
+{
+  static const search::Kernels best = search::supportedKernels().back();
+  return best;
+}
+
+}  // namespace
+
+const std::vector<search::Kernels>& search::supportedKernels()
+{
+  static const std::vector<Kernels> kernels = detectKernels();
+  return kernels;
+}
+
+const char* search::findByte(const char* begin, const char* end, char c)
+{
+  return bestKernels().findByte(begin, end, c);
+}
+
+const char* search::findPair(const char* begin, const char* end, char c1, char c2)
+{
+  return bestKernels().findPair(begin, end, c1, c2);
+}
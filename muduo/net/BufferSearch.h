@@ -0,0 +1,38 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_BUFFERSEARCH_H
+#define MUDUO_NET_BUFFERSEARCH_H
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+namespace search
+{
+
+/// First @c c in [begin, end), NULL if none.
+const char* findByte(const char* begin, const char* end, char c);
+/// First @c c1 followed by @c c2 in [begin, end), NULL if none.
+const char* findPair(const char* begin, const char* end, char c1, char c2);
+
+struct Kernels
+{
+  const char* name;
+  const char* (*findByte)(const char* begin, const char* end, char c);
+  const char* (*findPair)(const char* begin, const char* end, char c1, char c2);
+};
+
+/// Every implementation this CPU runs, the portable one first,
+/// findByte() and findPair() use the last one.
+const std::vector<Kernels>& supportedKernels();
+
+}  // namespace search
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_BUFFERSEARCH_H
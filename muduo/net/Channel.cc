@@ -28,10 +28,15 @@ Channel::Channel(EventLoop* loop, int fd__)
     revents_(0),
     index_(-1),
     logHup_(true),
+    edgeTriggered_(false),
     tied_(false),
     eventHandling_(false),
-    addedToLoop_(false)
+    addedToLoop_(false),
+    hasRecvResult_(false),
+    recvResult_(0),
+    recvBuffer_(NULL)
 {
+  loop_->countChannel(1);
 }
 
 Channel::~Channel()
@@ -42,6 +47,7 @@ Channel::~Channel()
   {
     assert(!loop_->hasChannel(this));
   }
+  loop_->countChannel(-1);
 }
 
 void Channel::tie(const std::shared_ptr<void>& obj)
@@ -56,6 +62,15 @@ void Channel::update()
   loop_->updateChannel(this);
 }
 
+void Channel::setEdgeTriggered(bool on)
+{
+  edgeTriggered_ = on;
+  if (!isNoneEvent())
+  {
+    update();
+  }
+}
+
 void Channel::remove()
 {
   assert(isNoneEvent());
@@ -63,6 +78,33 @@ void Channel::remove()
   loop_->removeChannel(this);
 }
 
+void Channel::addRecvResult(ssize_t n)
+{
+  if (!hasRecvResult_)
+  {
+    hasRecvResult_ = true;
+    recvResult_ = n;
+  }
+  else if (recvResult_ > 0 && n > 0)
+  {
+    recvResult_ += n;
+  }
+  // else deliver the bytes first, EOF or error is reported again
+  // by the poller after it re-arms the receive.
+}
+
+ssize_t Channel::takeRecvResult(int* savedErrno)
+{
+  assert(hasRecvResult_);
+  hasRecvResult_ = false;
+  if (recvResult_ < 0)
+  {
+    *savedErrno = static_cast<int>(-recvResult_);
+    return -1;
+  }
+  return recvResult_;
+}
+
 void Channel::handleEvent(Timestamp receiveTime)
 {
   std::shared_ptr<void> guard;
@@ -22,6 +22,7 @@ namespace muduo
 namespace net
 {
 
+class Buffer;
 class EventLoop;
 
 ///
@@ -57,7 +58,7 @@ class Channel : noncopyable
   int fd() const { return fd_; }
   int events() const { return events_; }
   void set_revents(int revt) { revents_ = revt; } // used by pollers
-  // int revents() const { return revents_; }
+  int revents() const { return revents_; }
   bool isNoneEvent() const { return events_ == kNoneEvent; }
 
 // Channel调用update会调用EventLoop 的update，实际上又调用了Poller的update把事件注册到Poller
@@ -79,6 +80,24 @@ class Channel : noncopyable
 
   void doNotLogHup() { logHup_ = false; }
 
+  /// Reports readiness once per change (EPOLLET) instead of while it lasts,
+  /// the callbacks must then read or write until EAGAIN.
+  /// Only EPollPoller supports it, the others ignore it.
+  void setEdgeTriggered(bool on);
+  bool isEdgeTriggered() const { return edgeTriggered_; }
+
+  /// Lets a completion based Poller receive into @c buf on behalf of
+  /// the read callback, NULL (the default) means readiness only.
+  /// Pollers which don't support it ignore it.
+  void setRecvBuffer(Buffer* buf) { recvBuffer_ = buf; }
+  Buffer* recvBuffer() const { return recvBuffer_; }
+  // for Poller, bytes already appended to recvBuffer(), 0 for EOF, or -errno
+  void addRecvResult(ssize_t n);
+  bool hasRecvResult() const { return hasRecvResult_; }
+  /// Returns bytes received into recvBuffer(), 0 for EOF,
+  /// or -1 with *savedErrno set.
+  ssize_t takeRecvResult(int* savedErrno);
+
   EventLoop* ownerLoop() { return loop_; }
   void remove();
 
@@ -98,11 +117,15 @@ class Channel : noncopyable
   int        revents_; // it's the received event types of epoll or poll；（poll/epoll返回的事件）
   int        index_; // used by Poller.表示在poll的事件数组中的序号；如果<0说明是新增的事件，还没添加到数组中，添加
   bool       logHup_; //For POLLHUP
+  bool       edgeTriggered_;
 
   std::weak_ptr<void> tie_; //弱引用，引用计数不会自动加1
   bool tied_;
   bool eventHandling_; //是否处于处理事件中
   bool addedToLoop_;
+  bool hasRecvResult_;
+  ssize_t recvResult_;
+  Buffer* recvBuffer_;
   ReadEventCallback readCallback_;
   EventCallback writeCallback_;
   EventCallback closeCallback_;
@@ -10,6 +10,8 @@
 
 #include <muduo/base/Logging.h>
 #include <muduo/base/Mutex.h>
+#include <muduo/base/ThreadLocalSingleton.h>
+#include <muduo/net/BufferPool.h>
 #include <muduo/net/Channel.h>
 #include <muduo/net/Poller.h>
 #include <muduo/net/SocketsOps.h>
@@ -31,6 +33,19 @@ namespace
 __thread EventLoop* t_loopInThisThread = 0;
 
 const int kPollTimeMs = 10000;
+const size_t kMaxFreeFunctors = 1024;
+const int64_t kMinSpinMicroSeconds = 10;  // where the busy poll restarts
+
+int64_t microSecondsBetween(Timestamp high, Timestamp low)
+{
+  return high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+}
+
+// only the loop thread writes it, other threads read
+void accumulate(std::atomic<int64_t>* total, int64_t delta)
+{
+  total->store(total->load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
 
 int createEventfd()
 {
@@ -58,6 +73,45 @@ class IgnoreSigPipe
 IgnoreSigPipe initObj;
 }  // namespace
 
+namespace muduo
+{
+namespace net
+{
+
+struct PendingFunctor
+{
+  EventLoop::Functor functor;
+  PendingFunctor* next;
+};
+
+}  // namespace net
+}  // namespace muduo
+
+namespace
+{
+
+void deleteFunctors(PendingFunctor* node)
+{
+  while (node)
+  {
+    PendingFunctor* next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+// Nodes a thread took back from some loop's freeFunctors_,
+// so queueInLoop() doesn't allocate in the steady state.
+struct FreeFunctors : noncopyable
+{
+  FreeFunctors() : head(NULL) { }
+  ~FreeFunctors() { deleteFunctors(head); }
+
+  PendingFunctor* head;
+};
+
+}  // namespace
+
 EventLoop* EventLoop::getEventLoopOfCurrentThread()
 {
   return t_loopInThisThread;
@@ -69,12 +123,23 @@ EventLoop::EventLoop()
     eventHandling_(false),
     callingPendingFunctors_(false),
     iteration_(0),
+    numChannels_(0),
+    busyMicroSeconds_(0),
+    spinMicroSeconds_(0),
+    blockMicroSeconds_(0),
+    maxSpinMicroSeconds_(0),
+    spinLimitMicroSeconds_(0),
     threadId_(CurrentThread::tid()),
     poller_(Poller::newDefaultPoller(this)),
     timerQueue_(new TimerQueue(this)),
+    bufferPool_(std::make_shared<BufferPool>()),
     wakeupFd_(createEventfd()),
     wakeupChannel_(new Channel(this, wakeupFd_)),
-    currentActiveChannel_(NULL)
+    currentActiveChannel_(NULL),
+    pendingFunctors_(NULL),
+    freeFunctors_(NULL),
+    pendingCount_(0),
+    wakeupPending_(false)
 {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
   // 如果当前线程已经创建了EventLoop对象，终止（LOG_FATAL)
@@ -101,6 +166,8 @@ EventLoop::~EventLoop()
   wakeupChannel_->remove();
   ::close(wakeupFd_);
   t_loopInThisThread = NULL;
+  deleteFunctors(pendingFunctors_.exchange(NULL));
+  deleteFunctors(freeFunctors_.exchange(NULL));
 }
 
 // 事件循环，该函数不能跨线程调用
@@ -114,10 +181,19 @@ void EventLoop::loop()
   quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
   LOG_TRACE << "EventLoop " << this << " start looping";
 
+  Timestamp iterationEnd(Timestamp::now());
   while (!quit_)
   {
     activeChannels_.clear();//把活动通道清除
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);//调用poll返回活动通道 &activeChannels_
+    if (maxSpinMicroSeconds_ > 0)
+    {
+      pollReturnTime_ = busyPoll(iterationEnd);
+    }
+    else
+    {
+      pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);//调用poll返回活动通道 &activeChannels_
+      accumulate(&blockMicroSeconds_, microSecondsBetween(pollReturnTime_, iterationEnd));
+    }
     ++iteration_;
     if (Logger::logLevel() <= Logger::TRACE)
     {
@@ -134,12 +210,56 @@ void EventLoop::loop()
     currentActiveChannel_ = NULL;
     eventHandling_ = false;
     doPendingFunctors(); //
+
+    iterationEnd = Timestamp::now();
+    accumulate(&busyMicroSeconds_, microSecondsBetween(iterationEnd, pollReturnTime_));
   }
 
   LOG_TRACE << "EventLoop " << this << " stop looping";
   looping_ = false;
 }
 
+void EventLoop::setBusyPoll(int64_t maxSpinMicroSeconds)
+{
+  assertInLoopThread();
+  maxSpinMicroSeconds_ = std::max<int64_t>(maxSpinMicroSeconds, 0);
+  spinLimitMicroSeconds_ = maxSpinMicroSeconds_;
+}
+
+Timestamp EventLoop::busyPoll(Timestamp start)
+{
+  Timestamp now(start);
+  const int64_t deadline = start.microSecondsSinceEpoch() + spinLimitMicroSeconds_;
+  while (spinLimitMicroSeconds_ > 0 && !quit_)
+  {
+    now = poller_->poll(0, &activeChannels_);
+    if (!activeChannels_.empty() || now.microSecondsSinceEpoch() >= deadline)
+    {
+      break;
+    }
+  }
+  accumulate(&spinMicroSeconds_, microSecondsBetween(now, start));
+  if (!activeChannels_.empty())
+  {
+    return now;
+  }
+
+  Timestamp blockStart(now);
+  now = poller_->poll(kPollTimeMs, &activeChannels_);
+  int64_t blocked = microSecondsBetween(now, blockStart);
+  accumulate(&blockMicroSeconds_, blocked);
+  if (!activeChannels_.empty() && blocked <= maxSpinMicroSeconds_)
+  {
+    spinLimitMicroSeconds_ = std::min(std::max(spinLimitMicroSeconds_ * 2, kMinSpinMicroSeconds),
+                                      maxSpinMicroSeconds_);
+  }
+  else
+  {
+    spinLimitMicroSeconds_ /= 2;
+  }
+  return now;
+}
+
 // 该函数可以跨线程调用
 void EventLoop::quit()
 {
@@ -174,14 +294,34 @@ void EventLoop::runInLoop(Functor cb)
 // 将任务添加到队列里
 void EventLoop::queueInLoop(Functor cb)
 {
+  FreeFunctors& cache = ThreadLocalSingleton<FreeFunctors>::instance();
+  if (!cache.head && freeFunctors_.load(std::memory_order_relaxed))
+  {
+    cache.head = freeFunctors_.exchange(NULL, std::memory_order_acquire);
+  }
+  PendingFunctor* node = cache.head;
+  if (node)
+  {
+    cache.head = node->next;
+  }
+  else
   {
-  MutexLockGuard lock(mutex_);
-  pendingFunctors_.push_back(std::move(cb));
+    node = new PendingFunctor;
   }
+  node->functor = std::move(cb);
+  node->next = pendingFunctors_.load(std::memory_order_relaxed);
+  while (!pendingFunctors_.compare_exchange_weak(node->next, node,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed))
+  {
+  }
+  pendingCount_.fetch_add(1, std::memory_order_relaxed);
 // 调用queueInLoop的线程不是当前IO线程则需要唤醒它，以便当前线程能及时执行这个任务
 // 或者调用queueInLoop的线程是当前IO线程，并且此时正在调用pendingfunctor，需要唤醒
 // 只有当IO线程的事件回调中调用queueInLoop才不需要唤醒
-  if (!isInLoopThread() || callingPendingFunctors_)
+// 已经有人唤醒过且doPendingFunctors()还没开始取，则不必再写eventfd
+  if ((!isInLoopThread() || callingPendingFunctors_)
+      && !wakeupPending_.exchange(true, std::memory_order_acq_rel))
   {
     wakeup();
   }
@@ -189,33 +329,50 @@ void EventLoop::queueInLoop(Functor cb)
 
 size_t EventLoop::queueSize() const
 {
-  MutexLockGuard lock(mutex_);
-  return pendingFunctors_.size();
+  return pendingCount_.load(std::memory_order_relaxed);
 }
 
-TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+TimerId EventLoop::runAt(Timestamp time, Functor cb)
 {
   // 0.0表示不是一个重复的定时器
   return timerQueue_->addTimer(std::move(cb), time, 0.0);
 }
 
-TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+TimerId EventLoop::runAfter(double delay, Functor cb)
 {
   Timestamp time(addTime(Timestamp::now(), delay));
   return runAt(time, std::move(cb));
 }
 
-TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+TimerId EventLoop::runEvery(double interval, Functor cb)
 {
   Timestamp time(addTime(Timestamp::now(), interval));
   return timerQueue_->addTimer(std::move(cb), time, interval);
 }
 
+TimerId EventLoop::runAfter(double delay, double slack, Functor cb)
+{
+  Timestamp time(addTime(Timestamp::now(), delay));
+  return timerQueue_->addTimer(std::move(cb), time, 0.0, slack);
+}
+
+TimerId EventLoop::runEvery(double interval, double slack, Functor cb)
+{
+  Timestamp time(addTime(Timestamp::now(), interval));
+  return timerQueue_->addTimer(std::move(cb), time, interval, slack);
+}
+
 void EventLoop::cancel(TimerId timerId)
 {
   return timerQueue_->cancel(timerId);
 }
 
+void EventLoop::useTimingWheel(double tick)
+{
+  int64_t us = static_cast<int64_t>(tick * Timestamp::kMicroSecondsPerSecond);
+  timerQueue_->useTimingWheel(us > 0 ? us : 1);
+}
+
 void EventLoop::updateChannel(Channel* channel)
 {
   assert(channel->ownerLoop() == this);
@@ -271,17 +428,55 @@ void EventLoop::handleRead()
 
 void EventLoop::doPendingFunctors()
 {
-  std::vector<Functor> functors;
   callingPendingFunctors_ = true;
 
+  // Cleared before taking the list: a callback queued after this either is
+  // in the list, or it sees false and wakes up the next poll.
+  wakeupPending_.exchange(false, std::memory_order_acq_rel);
+  //pendingFunctors_ 中任务都取出来了，按入队顺序逆转链表
+  PendingFunctor* node = pendingFunctors_.exchange(NULL, std::memory_order_acquire);
+  PendingFunctor* functors = NULL;
+  size_t count = 0;
+  while (node)
   {
-  MutexLockGuard lock(mutex_);
-  functors.swap(pendingFunctors_);//pendingFunctors_ 中任务都放到了functors中
+    PendingFunctor* next = node->next;
+    node->next = functors;
+    functors = node;
+    node = next;
+    ++count;
   }
+  pendingCount_.fetch_sub(count, std::memory_order_relaxed);
 
-  for (const Functor& functor : functors)
+  // Keeps the first nodes for reuse, no more than a burst would need.
+  PendingFunctor* last = NULL;
+  size_t kept = 0;
+  for (PendingFunctor* it = functors; it; )
   {
-    functor();
+    PendingFunctor* next = it->next;
+    it->functor();
+    it->functor = nullptr;
+    if (kept < kMaxFreeFunctors)
+    {
+      last = it;
+      ++kept;
+    }
+    else
+    {
+      delete it;
+    }
+    it = next;
+  }
+
+  // Only this thread pushes to freeFunctors_ and producers take all of it
+  // at once, so there is no ABA.
+  if (last)
+  {
+    last->next = freeFunctors_.load(std::memory_order_relaxed);
+    while (!freeFunctors_.compare_exchange_weak(last->next, functors,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed))
+    {
+    }
   }
   callingPendingFunctors_ = false;
 }
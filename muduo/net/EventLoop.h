@@ -13,10 +13,12 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <vector>
 
 #include <boost/any.hpp>
 
+#include <muduo/base/InplaceFunction.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/CurrentThread.h>
 #include <muduo/base/Timestamp.h>
@@ -28,9 +30,11 @@ namespace muduo
 namespace net
 {
 // 前项声明
+class BufferPool;
 class Channel;
 class Poller;
 class TimerQueue;
+struct PendingFunctor;
 
 ///
 /// Reactor, at most one per thread.
@@ -39,7 +43,8 @@ class TimerQueue;
 class EventLoop : noncopyable
 {
  public:
-  typedef std::function<void()> Functor;
+  /// Move-only, closures up to 64 bytes don't allocate.
+  typedef InplaceFunction<void ()> Functor;
 
   EventLoop();
   ~EventLoop();  // force out-line dtor, for std::unique_ptr members.
@@ -64,6 +69,35 @@ class EventLoop : noncopyable
 
   int64_t iteration() const { return iteration_; }
 
+  /// Channels of this loop, about the number of its connections.
+  /// Safe to call from other threads, for balancing load.
+  int numChannels() const
+  { return numChannels_.load(std::memory_order_relaxed); }
+  /// Total time spent in handlers and pending functors, i.e. not waiting.
+  /// Safe to call from other threads, for balancing load.
+  int64_t busyMicroSeconds() const
+  { return busyMicroSeconds_.load(std::memory_order_relaxed); }
+  /// Total time spent polling without blocking, see setBusyPoll().
+  /// Safe to call from other threads.
+  int64_t spinMicroSeconds() const
+  { return spinMicroSeconds_.load(std::memory_order_relaxed); }
+  /// Total time spent blocked in the poller.
+  /// Safe to call from other threads.
+  int64_t blockMicroSeconds() const
+  { return blockMicroSeconds_.load(std::memory_order_relaxed); }
+
+  ///
+  /// Polls with zero timeout for up to @c maxSpinMicroSeconds before
+  /// blocking in the poller, burning a CPU for a shorter wakeup latency.
+  /// The spin adapts like KVM's halt polling: it doubles when an event
+  /// came within the limit after blocking, i.e. spinning would have
+  /// caught it, and halves when blocking lasted longer, down to none in
+  /// an idle loop.  0 turns it off, the default.
+  /// The loop needs a core of its own, see ThreadPlacement, spinning on a
+  /// shared one only delays the threads it waits for.
+  /// Must be called in loop thread.
+  void setBusyPoll(int64_t maxSpinMicroSeconds);
+
   /// Runs callback immediately in the loop thread.
   /// It wakes up the loop, and run the cb.
   /// If in the same loop thread, cb is run within the function.
@@ -71,9 +105,10 @@ class EventLoop : noncopyable
   void runInLoop(Functor cb);
   /// Queues callback in the loop thread.
   /// Runs after finish pooling.
-  /// Safe to call from other threads.
+  /// Safe to call from other threads, lock-free.
   void queueInLoop(Functor cb);
 
+  /// Approximate, it changes while other threads queue callbacks.
   size_t queueSize() const;
 
   // timers
@@ -82,28 +117,56 @@ class EventLoop : noncopyable
   /// Runs callback at 'time'.
   /// Safe to call from other threads.
   ///在某个时刻运行定时器
-  TimerId runAt(Timestamp time, TimerCallback cb);
+  TimerId runAt(Timestamp time, Functor cb);
   ///
   /// Runs callback after @c delay seconds.
   /// Safe to call from other threads.
   /// 过一段时间运行定时器
-  TimerId runAfter(double delay, TimerCallback cb);
+  TimerId runAfter(double delay, Functor cb);
   ///
   /// Runs callback every @c interval seconds.
   /// Safe to call from other threads.
   /// 每隔一段时间运行定时器
-  TimerId runEvery(double interval, TimerCallback cb);
+  TimerId runEvery(double interval, Functor cb);
+  ///
+  /// Same as above, but the callback may run up to @c slack seconds late,
+  /// timers with slack are rounded so nearby ones expire together and cost
+  /// one wakeup and one timerfd_settime().  For timeouts which need not be
+  /// exact, e.g. idle connections.
+  /// Safe to call from other threads.
+  TimerId runAfter(double delay, double slack, Functor cb);
+  TimerId runEvery(double interval, double slack, Functor cb);
   ///
   /// Cancels the timer.
   /// Safe to call from other threads.
   /// 取消定时器
   void cancel(TimerId timerId);
+  ///
+  /// Keeps timers in a hierarchical timing wheel of @c tick seconds
+  /// instead of balanced trees: O(1) runAt() and cancel(), but timers
+  /// fire up to one tick late.  For loops with very many timers,
+  /// e.g. idle timeouts of all connections.
+  /// Must be called in loop thread.
+  void useTimingWheel(double tick = 0.001);
+
+  ///
+  /// Recycles the Buffer storage of the connections of this loop, only
+  /// this thread takes from it and returns to it.
+  ///
+  const std::shared_ptr<BufferPool>& bufferPool() const { return bufferPool_; }
+  /// NULL for the plain heap, for connections created afterwards.
+  /// A pool must be created in loop thread.
+  void setBufferPool(const std::shared_ptr<BufferPool>& pool)
+  { bufferPool_ = pool; }
 
   // internal usage
   void wakeup();
   void updateChannel(Channel* channel);//在Poller中添加（注册）或者更新通道
   void removeChannel(Channel* channel);//从Poller中移除通道
   bool hasChannel(Channel* channel);
+  // by Channel ctor and dtor, and TcpServer for connections on their way
+  void countChannel(int delta)
+  { numChannels_.fetch_add(delta, std::memory_order_relaxed); }
 
   // pid_t threadId() const { return threadId_; }
   void assertInLoopThread()
@@ -132,6 +195,7 @@ class EventLoop : noncopyable
   void abortNotInLoopThread();
   void handleRead();  // waked up
   void doPendingFunctors();
+  Timestamp busyPoll(Timestamp start);
 
   void printActiveChannels() const; // DEBUG
 
@@ -142,10 +206,18 @@ class EventLoop : noncopyable
   bool eventHandling_; /* atomic */ //当前线程是否处于事件处理状态
   bool callingPendingFunctors_; /* atomic */
   int64_t iteration_;
+  // before the channels below
+  std::atomic<int> numChannels_;
+  std::atomic<int64_t> busyMicroSeconds_;
+  std::atomic<int64_t> spinMicroSeconds_;
+  std::atomic<int64_t> blockMicroSeconds_;
+  int64_t maxSpinMicroSeconds_;
+  int64_t spinLimitMicroSeconds_;  // adapted, at most maxSpinMicroSeconds_
   const pid_t threadId_; //当前对象所属线程id
   Timestamp pollReturnTime_;//调用poll函数返回的时间戳
   std::unique_ptr<Poller> poller_;
   std::unique_ptr<TimerQueue> timerQueue_;
+  std::shared_ptr<BufferPool> bufferPool_;
   int wakeupFd_; //用于eventfd创建的文件描述符
   // unlike in TimerQueue, which is an internal class,
   // we don't expose Channel to client.
@@ -156,8 +228,14 @@ class EventLoop : noncopyable
   ChannelList activeChannels_; //Poller返回的活动通道
   Channel* currentActiveChannel_;//当前正在处理的活动通道
 
-  mutable MutexLock mutex_;
-  std::vector<Functor> pendingFunctors_ GUARDED_BY(mutex_);
+  // Pending functors, a lock-free LIFO list pushed by any thread,
+  // doPendingFunctors() takes it as a whole and runs it reversed.
+  std::atomic<PendingFunctor*> pendingFunctors_;
+  std::atomic<PendingFunctor*> freeFunctors_;  // ran, for reuse
+  std::atomic<size_t> pendingCount_;
+  // eventfd is written since the last doPendingFunctors(),
+  // so one wakeup serves all callbacks queued meanwhile.
+  std::atomic<bool> wakeupPending_;
 };
 
 }  // namespace net
@@ -31,6 +31,9 @@ class EventLoopThread : noncopyable
   EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
                   const string& name = string());
   ~EventLoopThread();
+  /// Must be called before startLoop().
+  void setPlacement(const ThreadPlacement& placement)
+  { thread_.setPlacement(placement); }
   EventLoop* startLoop(); //启动线程，该线程就成为了IO线程，线程函数运行
 
  private:
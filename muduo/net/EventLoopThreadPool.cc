@@ -11,11 +11,89 @@
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/EventLoopThread.h>
 
+#include <random>
+
 #include <stdio.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+EventLoop* selectLeastConnections(const std::vector<EventLoop*>& loops)
+{
+  EventLoop* least = loops[0];
+  for (EventLoop* loop : loops)
+  {
+    if (loop->numChannels() < least->numChannels())
+    {
+      least = loop;
+    }
+  }
+  return least;
+}
+
+class LeastRecentlyBusy
+{
+ public:
+  explicit LeastRecentlyBusy(double sampleInterval)
+    : sampleInterval_(sampleInterval),
+      rng_(static_cast<unsigned>(Timestamp::now().microSecondsSinceEpoch()))
+  { }
+
+  EventLoop* operator()(const std::vector<EventLoop*>& loops)
+  {
+    Timestamp now(Timestamp::now());
+    if (samples_.size() != loops.size()
+        || timeDifference(now, sampled_) >= sampleInterval_)
+    {
+      sample(loops, now);
+    }
+    if (loops.size() == 1)
+    {
+      return loops[0];
+    }
+    size_t i = rng_() % loops.size();
+    size_t j = rng_() % (loops.size() - 1);
+    if (j >= i)
+    {
+      ++j;
+    }
+    if (samples_[i].recent != samples_[j].recent)
+    {
+      return samples_[i].recent < samples_[j].recent ? loops[i] : loops[j];
+    }
+    return loops[i]->numChannels() <= loops[j]->numChannels() ? loops[i] : loops[j];
+  }
+
+ private:
+  struct Sample
+  {
+    int64_t total;
+    int64_t recent;
+  };
+
+  void sample(const std::vector<EventLoop*>& loops, Timestamp now)
+  {
+    samples_.resize(loops.size(), Sample());
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+      int64_t total = loops[i]->busyMicroSeconds();
+      samples_[i].recent = total - samples_[i].total;
+      samples_[i].total = total;
+    }
+    sampled_ = now;
+  }
+
+  double sampleInterval_;
+  std::vector<Sample> samples_;  // same order as loops
+  Timestamp sampled_;
+  std::minstd_rand rng_;
+};
+
+}  // namespace
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg)
   : baseLoop_(baseLoop),
     name_(nameArg),
@@ -44,6 +122,10 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
     snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
     EventLoopThread* t = new EventLoopThread(cb, buf);
     threads_.push_back(std::unique_ptr<EventLoopThread>(t));
+    if (!placement_.empty())
+    {
+      t->setPlacement(placement_[i % placement_.size()]);
+    }
     loops_.push_back(t->startLoop()); //启动EventLoopThread线程，在进入事件循环之前，会调用cb；返回值压入loops_
   }
   if (numThreads_ == 0 && cb)//没有创建
@@ -61,7 +143,11 @@ EventLoop* EventLoopThreadPool::getNextLoop()
 
 // 如果loops_为空（意味着numThreads为0，没有创建出新的线程），则loop指向baseLoop，单线程
 // 如果不为空，按照round-robin（RR，轮叫）的调度方式选择一个EventLoop，多线程
-  if (!loops_.empty())
+  if (!loops_.empty() && selector_)
+  {
+    loop = selector_(loops_);
+  }
+  else if (!loops_.empty())
   {
     // round-robin
     loop = loops_[next_];
@@ -99,3 +185,13 @@ std::vector<EventLoop*> EventLoopThreadPool::getAllLoops()
     return loops_;
   }
 }
+
+EventLoopThreadPool::LoopSelector EventLoopThreadPool::leastConnections()
+{
+  return selectLeastConnections;
+}
+
+EventLoopThreadPool::LoopSelector EventLoopThreadPool::leastRecentlyBusy(double sampleInterval)
+{
+  return LeastRecentlyBusy(sampleInterval);
+}
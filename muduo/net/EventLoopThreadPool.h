@@ -12,6 +12,7 @@
 #define MUDUO_NET_EVENTLOOPTHREADPOOL_H
 
 #include <muduo/base/noncopyable.h>
+#include <muduo/base/Thread.h>
 #include <muduo/base/Types.h>
 
 #include <functional>
@@ -31,14 +32,33 @@ class EventLoopThreadPool : noncopyable
 {
  public:
   typedef std::function<void(EventLoop*)> ThreadInitCallback;
+  /// Picks one of the I/O loops for a new connection.
+  typedef std::function<EventLoop* (const std::vector<EventLoop*>& loops)> LoopSelector;
 
   EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg);
   ~EventLoopThreadPool();
   void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+  /// Loop i is placed by plan[i % plan.size()], see ThreadPlacement.
+  void setThreadPlacement(const std::vector<ThreadPlacement>& plan)
+  { placement_ = plan; }
+  const std::vector<ThreadPlacement>& threadPlacement() const
+  { return placement_; }
   void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
+  /// Replaces round-robin in getNextLoop(), called in base loop thread.
+  void setLoopSelector(const LoopSelector& selector) { selector_ = selector; }
+
+  /// The loop with the fewest channels, i.e. connections, counting
+  /// those TcpServer handed to a loop and it has not created yet.
+  static LoopSelector leastConnections();
+  /// The less busy of two random loops, by time spent in handlers
+  /// in the last @c sampleInterval seconds, random pairs keep a burst of
+  /// connections from all going to the one loop which was idle when last
+  /// sampled.
+  static LoopSelector leastRecentlyBusy(double sampleInterval = 0.1);
+
   // valid after calling start()
-  /// round-robin
+  /// round-robin, unless setLoopSelector()
   EventLoop* getNextLoop();
 
   /// with the same hash code, it will always return the same EventLoop
@@ -59,6 +79,8 @@ class EventLoopThreadPool : noncopyable
   bool started_; //是否启动
   int numThreads_; //线程数
   int next_; //新连接到来，所选择的EventLoop对象下标
+  LoopSelector selector_;
+  std::vector<ThreadPlacement> placement_;
   std::vector<std::unique_ptr<EventLoopThread>> threads_; //IO线程列表
   std::vector<EventLoop*> loops_; //EventLoop列表
 };
@@ -12,6 +12,8 @@
 #include <muduo/net/InetAddress.h>
 #include <muduo/net/SocketsOps.h>
 
+#include <errno.h>
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <stdio.h>  // snprintf
@@ -128,3 +130,61 @@ void Socket::setKeepAlive(bool on)
   // FIXME CHECK
 }
 
+bool Socket::setZeroCopy(bool on)
+{
+  int optval = on ? 1 : 0;
+  return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY,
+                      &optval, static_cast<socklen_t>(sizeof optval)) == 0;
+}
+
+bool Socket::setBusyPoll(int microSeconds)
+{
+#ifdef SO_BUSY_POLL
+  return ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL,
+                      &microSeconds, static_cast<socklen_t>(sizeof microSeconds)) == 0;
+#else
+  (void)microSeconds;
+  errno = ENOPROTOOPT;
+  return false;
+#endif
+}
+
+bool Socket::attachReusePortCpuFilter(int groupSize, const std::vector<int>& indexOfCpu)
+{
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  assert(groupSize > 0);
+  std::vector<struct sock_filter> code;
+  // A = raw_smp_processor_id()
+  code.push_back({ BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) });
+  for (size_t cpu = 0; cpu < indexOfCpu.size(); ++cpu)
+  {
+    if (indexOfCpu[cpu] >= 0)
+    {
+      assert(indexOfCpu[cpu] < groupSize);
+      // if (A == cpu) return index
+      code.push_back({ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, static_cast<uint32_t>(cpu) });
+      code.push_back({ BPF_RET | BPF_K, 0, 0, static_cast<uint32_t>(indexOfCpu[cpu]) });
+    }
+  }
+  // A = A % groupSize
+  code.push_back({ BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(groupSize) });
+  // return A
+  code.push_back({ BPF_RET | BPF_A, 0, 0, 0 });
+  struct sock_fprog prog;
+  prog.len = static_cast<unsigned short>(code.size());
+  prog.filter = code.data();
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                         &prog, static_cast<socklen_t>(sizeof prog));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+    return false;
+  }
+  return true;
+#else
+  (void)groupSize;
+  (void)indexOfCpu;
+  LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+  return false;
+#endif
+}
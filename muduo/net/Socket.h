@@ -14,6 +14,8 @@
 
 #include <muduo/base/noncopyable.h>
 
+#include <vector>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
@@ -84,6 +86,25 @@ class Socket : noncopyable
   /// TCP keepalibe是指定期探测连接是否存在，如果应用层有心跳的话，这个选项不是必须要设置的
   void setKeepAlive(bool on);
 
+  ///
+  /// Enable/disable SO_ZEROCOPY, allows send(2) with MSG_ZEROCOPY.
+  /// Returns false if not supported.
+  bool setZeroCopy(bool on);
+
+  ///
+  /// SO_BUSY_POLL, a blocking receive polls the device queue for up to
+  /// @c microSeconds.  Raising it above net.core.busy_read needs
+  /// CAP_NET_ADMIN.  Returns false if not supported.
+  bool setBusyPoll(int microSeconds);
+
+  ///
+  /// Steers new connections of the SO_REUSEPORT group this socket is in
+  /// to its (cpu % @c groupSize)-th listening socket, in listen(2) order,
+  /// with a classic BPF program.  Returns false if not supported.
+  /// Or to socket indexOfCpu[cpu], for the CPUs where it's not negative.
+  bool attachReusePortCpuFilter(int groupSize,
+                                const std::vector<int>& indexOfCpu = std::vector<int>());
+
  private:
   const int sockfd_;
 };
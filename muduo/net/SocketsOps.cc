@@ -14,9 +14,13 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <stdio.h>  // snprintf
+#include <string.h>  // memcpy
+#include <sys/sendfile.h>
 #include <sys/socket.h>
-#include <sys/uio.h>  // readv
+#include <sys/uio.h>  // readv, writev
 #include <unistd.h>
 
 using namespace muduo;
@@ -130,7 +134,10 @@ int sockets::accept(int sockfd, struct sockaddr_in6* addr)
   {
     // 如果错了
     int savedErrno = errno;
-    LOG_SYSERR << "Socket::accept"; //内部可能会调用系统调用更改errno的值
+    if (savedErrno != EAGAIN)  // the end of a batch, see Acceptor::handleRead()
+    {
+      LOG_SYSERR << "Socket::accept"; //内部可能会调用系统调用更改errno的值
+    }
     switch (savedErrno)
     {
       case EAGAIN:
@@ -139,13 +146,13 @@ int sockets::accept(int sockfd, struct sockaddr_in6* addr)
       case EPROTO: // ???
       case EPERM:
       case EMFILE: // per-process lmit of open file desctiptor ???
+      case ENFILE:
         // expected errors
         errno = savedErrno; //上面几种不是致命的错误，将errno还原
         break;
       case EBADF:
       case EFAULT:
       case EINVAL:
-      case ENFILE:
       case ENOBUFS:
       case ENOMEM:
       case ENOTSOCK:
@@ -182,6 +189,51 @@ ssize_t sockets::write(int sockfd, const void *buf, size_t count)
   return ::write(sockfd, buf, count);
 }
 
+ssize_t sockets::writev(int sockfd, const struct iovec *iov, int iovcnt)
+{
+  return ::writev(sockfd, iov, iovcnt);
+}
+
+ssize_t sockets::sendfile(int sockfd, int infd, off_t* offset, size_t count)
+{
+  return ::sendfile(sockfd, infd, offset, count);
+}
+
+ssize_t sockets::sendZeroCopy(int sockfd, const void* buf, size_t count)
+{
+  return ::send(sockfd, buf, count, MSG_ZEROCOPY);
+}
+
+int sockets::recvZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied)
+{
+  char control[128];
+  struct msghdr msg;
+  memZero(&msg, sizeof msg);
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof control;
+  if (::recvmsg(sockfd, &msg, MSG_ERRQUEUE) < 0)
+  {
+    return -1;
+  }
+  for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != NULL; cm = CMSG_NXTHDR(&msg, cm))
+  {
+    if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+        || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+    {
+      struct sock_extended_err serr;
+      memcpy(&serr, CMSG_DATA(cm), sizeof serr);
+      if (serr.ee_errno == 0 && serr.ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+      {
+        *lo = serr.ee_info;
+        *hi = serr.ee_data;
+        *copied = (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
 // 关闭文件描述符
 void sockets::close(int sockfd)
 {
@@ -200,6 +252,23 @@ void sockets::shutdownWrite(int sockfd)
   }
 }
 
+void sockets::abortConnection(int sockfd)
+{
+  struct linger lingerOpt;
+  lingerOpt.l_onoff = 1;
+  lingerOpt.l_linger = 0;
+  if (::setsockopt(sockfd, SOL_SOCKET, SO_LINGER,
+                   &lingerOpt, static_cast<socklen_t>(sizeof lingerOpt)) < 0)
+  {
+    LOG_SYSERR << "sockets::abortConnection SO_LINGER";
+  }
+  // connect(2) to AF_UNSPEC disconnects a TCP socket, with a RST
+  struct sockaddr unspec;
+  memZero(&unspec, sizeof unspec);
+  unspec.sa_family = AF_UNSPEC;
+  ::connect(sockfd, &unspec, static_cast<socklen_t>(sizeof unspec));
+}
+
 // 将地址转换成IP与 地址形式存在buf中
 void sockets::toIpPort(char* buf, size_t size,
                        const struct sockaddr* addr)
@@ -35,8 +35,20 @@ int  accept(int sockfd, struct sockaddr_in6* addr);
 ssize_t read(int sockfd, void *buf, size_t count);
 ssize_t readv(int sockfd, const struct iovec *iov, int iovcnt);
 ssize_t write(int sockfd, const void *buf, size_t count);
+ssize_t writev(int sockfd, const struct iovec *iov, int iovcnt);
+// zero copy from file infd to socket, *offset is advanced
+ssize_t sendfile(int sockfd, int infd, off_t* offset, size_t count);
+// send(2) with MSG_ZEROCOPY, buf must not change until its completion
+ssize_t sendZeroCopy(int sockfd, const void* buf, size_t count);
+// reads one message from the error queue, returns 1 if it is a
+// MSG_ZEROCOPY completion of sends [*lo, *hi], 0 if it is something else,
+// -1 on error, EAGAIN if the queue is empty.
+int recvZeroCopyCompletion(int sockfd, uint32_t* lo, uint32_t* hi, bool* copied);
 void close(int sockfd);
 void shutdownWrite(int sockfd);
+// resets the connection and drops what it has not sent, even if other fds
+// still refer to the socket, a close() after does not linger either.
+void abortConnection(int sockfd);
 
 void toIpPort(char* buf, size_t size,
               const struct sockaddr* addr);
@@ -16,10 +16,44 @@
 #include <muduo/net/SocketsOps.h>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>  // IOV_MAX
+#include <sys/uio.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+const size_t kDefaultReadBudget = 64 * 1024;
+const double kZeroCopyLingerInterval = 0.1;  // seconds
+const double kZeroCopyLingerTimeout = 10.0;  // seconds
+}  // namespace
+
+// MSG_ZEROCOPY blocks of a destroyed connection, with a dup of its socket
+// so their completions can still be read, owned by the timer polling it.
+struct TcpConnection::ZeroCopyLinger : noncopyable
+{
+  ZeroCopyLinger(int fd, const string& nameArg, std::deque<ZeroCopyBlock>* blocks)
+    : sockfd(fd),
+      name(nameArg),
+      deadline(addTime(Timestamp::now(), kZeroCopyLingerTimeout))
+  {
+    pending.swap(*blocks);
+  }
+
+  ~ZeroCopyLinger()
+  {
+    sockets::close(sockfd);
+  }
+
+  const int sockfd;
+  const string name;
+  const Timestamp deadline;
+  std::deque<ZeroCopyBlock> pending;
+};
+
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)
 {
   LOG_TRACE << conn->localAddress().toIpPort() << " -> "
@@ -44,11 +78,20 @@ TcpConnection::TcpConnection(EventLoop* loop,
     name_(nameArg),
     state_(kConnecting),
     reading_(true),
+    recvCompletion_(false),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    inputBuffer_(loop->bufferPool(), 0),  // mostly idle, allocated when used
+    outputBuffer_(loop->bufferPool(), 0),
+    outputTail_(NULL),
+    outputBlocksBytes_(0),
+    zeroCopyThreshold_(0),
+    zeroCopySeq_(0),
+    readBudget_(kDefaultReadBudget),
+    readResumeQueued_(false)
 {
   // 通道可读事件到来的时候，回调TcpConnection::handleRead，_1是事件发生时间
   channel_->setReadCallback(
@@ -76,6 +119,13 @@ TcpConnection::~TcpConnection()
             << " fd=" << channel_->fd()
             << " state=" << stateToString();
   assert(state_ == kDisconnected);
+  for (const OutputBlock& block : outputBlocks_)
+  {
+    if (block.fd >= 0)
+    {
+      ::close(block.fd);
+    }
+  }
 }
 
 bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
@@ -83,6 +133,18 @@ bool TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
   return socket_->getTcpInfo(tcpi);
 }
 
+size_t TcpConnection::memoryFootprint() const
+{
+  loop_->assertInLoopThread();
+  size_t bytes = sizeof(TcpConnection) + sizeof(Socket) + sizeof(Channel)
+      + inputBuffer_.internalCapacity() + outputBuffer_.internalCapacity();
+  if (outputTail_)
+  {
+    bytes += outputTail_->capacity();
+  }
+  return bytes;
+}
+
 string TcpConnection::getTcpInfoString() const
 {
   char buf[1024];
@@ -117,6 +179,26 @@ void TcpConnection::send(const StringPiece& message)
   }
 }
 
+// 线程安全的，可以跨线程调用
+void TcpConnection::send(string&& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendInLoop(message);
+    }
+    else
+    {
+      void (TcpConnection::*fp)(const StringPiece& message) = &TcpConnection::sendInLoop;
+      loop_->runInLoop(
+          std::bind(fp,
+                    this,     // FIXME
+                    std::move(message)));
+    }
+  }
+}
+
 // FIXME efficiency!!!
 void TcpConnection::send(Buffer* buf)
 {
@@ -139,12 +221,66 @@ void TcpConnection::send(Buffer* buf)
   }
 }
 
+void TcpConnection::send(const std::shared_ptr<const string>& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendBlockInLoop(message);
+    }
+    else
+    {
+      loop_->runInLoop(
+          std::bind(&TcpConnection::sendBlockInLoop,
+                    this,     // FIXME
+                    message));
+    }
+  }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len)
+{
+  if (state_ == kConnected)
+  {
+    int dupfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (dupfd < 0)
+    {
+      LOG_SYSERR << "TcpConnection::sendFile";
+      return;
+    }
+    if (loop_->isInLoopThread())
+    {
+      sendFileInLoop(dupfd, offset, len);
+    }
+    else
+    {
+      loop_->runInLoop(
+          std::bind(&TcpConnection::sendFileInLoop,
+                    this,     // FIXME
+                    dupfd, offset, len));
+    }
+  }
+}
+
 void TcpConnection::sendInLoop(const StringPiece& message)
 {
   sendInLoop(message.data(), message.size());
 }
 
 void TcpConnection::sendInLoop(const void* data, size_t len)
+{
+  sendInLoop(data, len, std::shared_ptr<const string>());
+}
+
+void TcpConnection::sendBlockInLoop(const std::shared_ptr<const string>& message)
+{
+  sendInLoop(message->data(), message->size(), message);
+}
+
+// data points into *block if block is not null, queue it instead of copying
+void TcpConnection::sendInLoop(const void* data, size_t len,
+                               const std::shared_ptr<const string>& block)
 {
   loop_->assertInLoopThread();
   ssize_t nwrote = 0;
@@ -157,9 +293,16 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   }
   // if no thing in output queue, try writing directly
   // 通道没有关注可写事件并且发送缓冲区没有数据，直接write
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  if (!channel_->isWriting() && outputBytes() == 0)
   {
-    nwrote = sockets::write(channel_->fd(), data, len);
+    if (block && zeroCopyThreshold_ > 0 && len >= zeroCopyThreshold_)
+    {
+      nwrote = sendZeroCopy(block, static_cast<const char*>(data), len);
+    }
+    else
+    {
+      nwrote = sockets::write(channel_->fd(), data, len);
+    }
     if (nwrote >= 0)
     {
       remaining = len - nwrote;
@@ -187,15 +330,19 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   // 没有错误，并且还有未写完的数据（说明内核发送缓冲区满，要将未写完的数据添加到output buffer中）
   if (!faultError && remaining > 0)
   {
-    size_t oldLen = outputBuffer_.readableBytes();
-    // 如果超过highWaterMark_（高水位标），回到highWaterMarkCallback_ 
-    if (oldLen + remaining >= highWaterMark_
-        && oldLen < highWaterMark_
-        && highWaterMarkCallback_)
+    checkHighWaterMark(remaining);
+    const char* rest = static_cast<const char*>(data) + nwrote;
+    if (block)
     {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      OutputBlock ob = { block, implicit_cast<size_t>(rest - block->data()), 0, -1 };
+      outputBlocks_.push_back(std::move(ob));
+      outputTail_ = NULL;
+      outputBlocksBytes_ += remaining;
+    }
+    else
+    {
+      appendOutput(rest, remaining);
     }
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
     if (!channel_->isWriting())
     {
       channel_->enableWriting(); //关注POLLOUT事件
@@ -203,6 +350,79 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   }
 }
 
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len)
+{
+  loop_->assertInLoopThread();
+  ssize_t nwrote = 0;
+  size_t remaining = len;
+  bool faultError = false;
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    ::close(fd);
+    return;
+  }
+  if (!channel_->isWriting() && outputBytes() == 0)
+  {
+    off_t off = offset;
+    nwrote = sockets::sendfile(channel_->fd(), fd, &off, len);
+    if (nwrote > 0 || len == 0)
+    {
+      remaining = len - nwrote;
+      if (remaining == 0 && writeCompleteCallback_)
+      {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+    }
+    else if (nwrote == 0)
+    {
+      LOG_ERROR << "TcpConnection::sendFileInLoop - file ends before offset " << offset;
+      faultError = true;
+    }
+    else // nwrote < 0
+    {
+      nwrote = 0;
+      if (errno != EWOULDBLOCK)
+      {
+        // EINVAL if fd doesn't support mmap-like operations, such as a pipe
+        LOG_SYSERR << "TcpConnection::sendFileInLoop";
+        faultError = true;
+      }
+    }
+  }
+
+  assert(remaining <= len);
+  if (!faultError && remaining > 0)
+  {
+    checkHighWaterMark(remaining);
+    const size_t start = implicit_cast<size_t>(offset) + nwrote;
+    OutputBlock ob = { std::shared_ptr<const string>(), start, start + remaining, fd };
+    outputBlocks_.push_back(std::move(ob));
+    outputTail_ = NULL;
+    outputBlocksBytes_ += remaining;
+    if (!channel_->isWriting())
+    {
+      channel_->enableWriting();
+    }
+  }
+  else
+  {
+    ::close(fd);
+  }
+}
+
+void TcpConnection::checkHighWaterMark(size_t remaining)
+{
+  size_t oldLen = outputBytes();
+  // 如果超过highWaterMark_（高水位标），回到highWaterMarkCallback_ 
+  if (oldLen + remaining >= highWaterMark_
+      && oldLen < highWaterMark_
+      && highWaterMarkCallback_)
+  {
+    loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+  }
+}
+
 // 应用程序想关闭连接，但是可能处于发送数据的过程中，output Buffer中有数据还没发完，不能直接调用close()
 // 不可以跨线程调用
 void TcpConnection::shutdown()
@@ -304,6 +524,14 @@ void TcpConnection::setTcpNoDelay(bool on)
   socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setBusyPoll(int microSeconds)
+{
+  if (!socket_->setBusyPoll(microSeconds))
+  {
+    LOG_SYSERR << "TcpConnection::setBusyPoll [" << name_ << "]";
+  }
+}
+
 void TcpConnection::startRead()
 {
   loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
@@ -341,6 +569,11 @@ void TcpConnection::connectEstablished()
   setState(kConnected);
   // LOG_TRACE << "wyy: [3] usecount=" << shared_from_this().use_count();//shared_from_this()生成的为临时对象，马上销毁，引用计数又变为2
   channel_->tie(shared_from_this()); //获得这个对象的shared_ptr对象；tie操作后引用计数又变为3，shared_from_this()生成的为临时对象，马上销毁，引用计数又变为2   
+  if (recvCompletion_)
+  {
+    releaseInputBuffer();
+    channel_->setRecvBuffer(&inputBuffer_);
+  }
   channel_->enableReading(); //TcpConnection所对应的通道加入Poller关注
 
   connectionCallback_(shared_from_this());
@@ -350,7 +583,8 @@ void TcpConnection::connectEstablished()
 void TcpConnection::connectDestroyed()
 {
   loop_->assertInLoopThread();
-  if (state_ == kConnected)
+  // also with a shutdown or forceClose() queued, which then does nothing
+  if (state_ == kConnected || state_ == kDisconnecting)
   {
     setState(kDisconnected);
     channel_->disableAll();
@@ -358,16 +592,38 @@ void TcpConnection::connectDestroyed()
     connectionCallback_(shared_from_this());
   }
   channel_->remove();
+  if (!zeroCopyPending_.empty())
+  {
+    lingerZeroCopy();
+  }
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
   loop_->assertInLoopThread();
   int savedErrno = 0;
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  ssize_t n = 0;
+  if (channel_->hasRecvResult())
+  {
+    // completion mode, the poller has received into inputBuffer_
+    n = channel_->takeRecvResult(&savedErrno);
+  }
+  else if (channel_->isEdgeTriggered())
+  {
+    handleReadEdgeTriggered(receiveTime);
+    return;
+  }
+  else
+  {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  }
   if (n > 0)
   {
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    if (recvCompletion_ && inputBuffer_.readableBytes() == 0)
+    {
+      releaseInputBuffer();
+    }
   }
   else if (n == 0)
   {
@@ -381,20 +637,78 @@ void TcpConnection::handleRead(Timestamp receiveTime)
   }
 }
 
+// No event comes for what's left to read, so read it all now, or if
+// this connection floods us, in a functor after the other channels.
+void TcpConnection::handleReadEdgeTriggered(Timestamp receiveTime)
+{
+  size_t total = 0;
+  int savedErrno = 0;
+  ssize_t n = 0;
+  while (total < readBudget_)
+  {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    if (n <= 0)
+    {
+      break;
+    }
+    total += static_cast<size_t>(n);
+  }
+  if (total > 0)
+  {
+    messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+  }
+  if (n > 0)
+  {
+    if (!readResumeQueued_)  // edges keep coming while it floods
+    {
+      readResumeQueued_ = true;
+      loop_->queueInLoop(std::bind(&TcpConnection::resumeRead, shared_from_this()));
+    }
+  }
+  else if (n == 0)
+  {
+    handleClose();
+  }
+  else if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK)
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "TcpConnection::handleRead";
+    handleError();
+  }
+}
+
+void TcpConnection::resumeRead()
+{
+  readResumeQueued_ = false;
+  if (channel_->isReading())  // not closed or stopRead() meanwhile
+  {
+    handleReadEdgeTriggered(Timestamp::now());
+  }
+}
+
+void TcpConnection::releaseInputBuffer()
+{
+  Buffer empty(inputBuffer_.pool(), 0);
+  inputBuffer_.swap(empty);
+}
+
 // 内核发送缓冲区有空间了，回调该函数
 void TcpConnection::handleWrite()
 {
   loop_->assertInLoopThread();
   if (channel_->isWriting())
   {
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
+    ssize_t n = writeOutput();
     // 不一定把readableBytes()数据都发送完毕
-    if (n > 0)
+    if (n > 0 || (n == 0 && outputBytes() == 0))
     {
-      outputBuffer_.retrieve(n);//向前移动n个字节
-      if (outputBuffer_.readableBytes() == 0) //应用层发送缓冲区已清空
+      retrieveOutput(n);//向前移动n个字节
+      if (outputBytes() > 0 && channel_->isEdgeTriggered())
+      {
+        // one block may not fill the socket, if it did this gets EAGAIN
+        loop_->queueInLoop(std::bind(&TcpConnection::handleWrite, shared_from_this()));
+      }
+      else if (outputBytes() == 0) //应用层发送缓冲区已清空
       {
         channel_->disableWriting(); //停止关注POLLOUT事件，以免出现busyloop
         if (writeCompleteCallback_) //回调writeCompleteCallback_
@@ -408,6 +722,10 @@ void TcpConnection::handleWrite()
         }
       }
     }
+    else if (n < 0 && errno == EWOULDBLOCK && channel_->isEdgeTriggered())
+    {
+      // full, wait for the next edge
+    }
     else
     {
       LOG_SYSERR << "TcpConnection::handleWrite";
@@ -424,6 +742,231 @@ void TcpConnection::handleWrite()
   }
 }
 
+void TcpConnection::appendOutput(const char* data, size_t len)
+{
+  if (outputBlocks_.empty())
+  {
+    outputBuffer_.append(data, len);
+    return;
+  }
+  if (!outputTail_)
+  {
+    std::shared_ptr<string> tail(std::make_shared<string>());
+    outputTail_ = tail.get();
+    OutputBlock ob = { std::move(tail), 0, 0, -1 };
+    outputBlocks_.push_back(std::move(ob));
+  }
+  outputTail_->append(data, len);
+  outputBlocksBytes_ += len;
+}
+
+ssize_t TcpConnection::writeOutput()
+{
+  if (outputBlocks_.empty())
+  {
+    return sockets::write(channel_->fd(),
+                          outputBuffer_.peek(),
+                          outputBuffer_.readableBytes());
+  }
+
+  if (outputBuffer_.readableBytes() == 0 && outputBlocks_.front().fd >= 0)
+  {
+    OutputBlock& block = outputBlocks_.front();
+    off_t offset = static_cast<off_t>(block.offset);
+    ssize_t n = sockets::sendfile(channel_->fd(), block.fd, &offset, block.readableBytes());
+    if (n == 0)
+    {
+      LOG_ERROR << "TcpConnection::writeOutput - file ends before offset " << block.offset;
+      outputBlocksBytes_ -= block.readableBytes();
+      ::close(block.fd);
+      outputBlocks_.pop_front();
+      return writeOutput();
+    }
+    return n;
+  }
+
+  const OutputBlock& front = outputBlocks_.front();
+  if (outputBuffer_.readableBytes() == 0
+      && zeroCopyThreshold_ > 0
+      && front.data
+      && front.data.get() != outputTail_  // still being appended to
+      && front.readableBytes() >= zeroCopyThreshold_)
+  {
+    return sendZeroCopy(front.data, front.data->data() + front.offset,
+                        front.readableBytes());
+  }
+
+  struct iovec vec[IOV_MAX];
+  int iovcnt = 0;
+  if (outputBuffer_.readableBytes() > 0)
+  {
+    vec[iovcnt].iov_base = const_cast<char*>(outputBuffer_.peek());
+    vec[iovcnt].iov_len = outputBuffer_.readableBytes();
+    ++iovcnt;
+  }
+  for (const OutputBlock& block : outputBlocks_)
+  {
+    if (iovcnt == IOV_MAX || block.fd >= 0)
+    {
+      break;
+    }
+    vec[iovcnt].iov_base = const_cast<char*>(block.data->data() + block.offset);
+    vec[iovcnt].iov_len = block.readableBytes();
+    ++iovcnt;
+  }
+  return sockets::writev(channel_->fd(), vec, iovcnt);
+}
+
+void TcpConnection::retrieveOutput(size_t len)
+{
+  assert(len <= outputBytes());
+  size_t n = std::min(len, outputBuffer_.readableBytes());
+  outputBuffer_.retrieve(n);
+  len -= n;
+  while (len > 0)
+  {
+    OutputBlock& block = outputBlocks_.front();
+    const size_t avail = block.readableBytes();
+    if (len < avail)
+    {
+      block.offset += len;
+      outputBlocksBytes_ -= len;
+      break;
+    }
+    len -= avail;
+    outputBlocksBytes_ -= avail;
+    if (block.data.get() == outputTail_)
+    {
+      outputTail_ = NULL;
+    }
+    if (block.fd >= 0)
+    {
+      ::close(block.fd);
+    }
+    outputBlocks_.pop_front();
+  }
+}
+
+void TcpConnection::setEdgeTriggered(bool on)
+{
+  channel_->setEdgeTriggered(on);
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t bytes)
+{
+  if (bytes > 0 && !socket_->setZeroCopy(true))
+  {
+    LOG_SYSERR << "TcpConnection::setZeroCopyThreshold [" << name_ << "]";
+    bytes = 0;
+  }
+  zeroCopyThreshold_ = bytes;
+}
+
+// data points into *block, it is pinned until its completion arrives
+ssize_t TcpConnection::sendZeroCopy(const std::shared_ptr<const string>& block,
+                                    const char* data, size_t len)
+{
+  ssize_t n = sockets::sendZeroCopy(channel_->fd(), data, len);
+  if (n > 0)
+  {
+    ZeroCopyBlock zb = { zeroCopySeq_++, block };
+    zeroCopyPending_.push_back(std::move(zb));
+  }
+  else if (n < 0 && errno == ENOBUFS)
+  {
+    // over optmem_max of pinned pages, copy this time
+    n = sockets::write(channel_->fd(), data, len);
+  }
+  return n;
+}
+
+// drains MSG_ZEROCOPY completions from the socket error queue,
+// returns false if there were none, so POLLERR is for a real error.
+bool TcpConnection::handleZeroCopyCompletions()
+{
+  return drainZeroCopyCompletions(channel_->fd(), name_, &zeroCopyPending_);
+}
+
+bool TcpConnection::drainZeroCopyCompletions(int sockfd, const string& name,
+                                             std::deque<ZeroCopyBlock>* pending)
+{
+  bool completed = false;
+  uint32_t lo = 0, hi = 0;
+  bool copied = false;
+  int ret;
+  while ((ret = sockets::recvZeroCopyCompletion(sockfd, &lo, &hi, &copied)) >= 0)
+  {
+    if (ret == 0)
+    {
+      continue;
+    }
+    completed = true;
+    LOG_TRACE << name << " zerocopy completed [" << lo << ", " << hi << "]"
+              << (copied ? " copied" : "");
+    for (ZeroCopyBlock& zb : *pending)
+    {
+      if (zb.seq - lo <= hi - lo)  // in [lo, hi], modulo 2^32
+      {
+        zb.data.reset();
+      }
+    }
+    while (!pending->empty() && !pending->front().data)
+    {
+      pending->pop_front();
+    }
+  }
+  return completed;
+}
+
+// The kernel may still send from the pages of pending blocks, which must
+// not be freed and reused before their completions arrive.  Those are read
+// from the error queue of the socket, so a dup keeps it open after the
+// connection closes its fd, and sends the FIN the close would have.  A
+// peer that never takes the data is reset after kZeroCopyLingerTimeout,
+// which frees what was queued, and the blocks with it.
+void TcpConnection::lingerZeroCopy()
+{
+  loop_->assertInLoopThread();
+  handleZeroCopyCompletions();
+  if (zeroCopyPending_.empty())
+  {
+    return;
+  }
+  int sockfd = ::fcntl(channel_->fd(), F_DUPFD_CLOEXEC, 0);
+  if (sockfd < 0)
+  {
+    LOG_SYSERR << "TcpConnection::lingerZeroCopy [" << name_ << "] "
+               << zeroCopyPending_.size() << " blocks dropped";
+    return;
+  }
+  LOG_DEBUG << name_ << " lingers for " << zeroCopyPending_.size() << " zerocopy blocks";
+  // fails if the peer reset it already, then the completions are on the way
+  ::shutdown(sockfd, SHUT_WR);
+  std::shared_ptr<ZeroCopyLinger> linger(new ZeroCopyLinger(sockfd, name_, &zeroCopyPending_));
+  loop_->runAfter(kZeroCopyLingerInterval, kZeroCopyLingerInterval / 2,
+                  std::bind(&TcpConnection::checkZeroCopyLinger, loop_, linger));
+}
+
+void TcpConnection::checkZeroCopyLinger(EventLoop* loop,
+                                        const std::shared_ptr<ZeroCopyLinger>& linger)
+{
+  drainZeroCopyCompletions(linger->sockfd, linger->name, &linger->pending);
+  if (!linger->pending.empty() && Timestamp::now() >= linger->deadline)
+  {
+    LOG_WARN << linger->name << " resets after " << kZeroCopyLingerTimeout
+             << "s, " << linger->pending.size() << " zerocopy blocks unsent";
+    sockets::abortConnection(linger->sockfd);
+    drainZeroCopyCompletions(linger->sockfd, linger->name, &linger->pending);
+    linger->pending.clear();
+  }
+  else if (!linger->pending.empty())
+  {
+    loop->runAfter(kZeroCopyLingerInterval, kZeroCopyLingerInterval / 2,
+                   std::bind(&TcpConnection::checkZeroCopyLinger, loop, linger));
+  }
+  // else the last copy of linger goes with this timer, closing the dup
+}
+
 void TcpConnection::handleClose()
 {
   loop_->assertInLoopThread();
@@ -444,6 +987,10 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+  if (!zeroCopyPending_.empty() && handleZeroCopyCompletions())
+  {
+    return;
+  }
   int err = sockets::getSocketError(channel_->fd());
   LOG_ERROR << "TcpConnection::handleError [" << name_
             << "] - SO_ERROR = " << err << " " << strerror_tl(err);
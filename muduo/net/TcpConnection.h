@@ -18,6 +18,7 @@
 #include <muduo/net/Buffer.h>
 #include <muduo/net/InetAddress.h>
 
+#include <deque>
 #include <memory>
 
 #include <boost/any.hpp>
@@ -62,16 +63,28 @@ class TcpConnection : noncopyable,
   bool getTcpInfo(struct tcp_info*) const;
   string getTcpInfoString() const;
 
-  // void send(string&& message); // C++11
   void send(const void* message, int len);
   void send(const StringPiece& message);
+  /// Moves @c message into the loop thread instead of copying it.
+  void send(string&& message);
+  void send(const char* message)
+  { send(StringPiece(message)); }
   // void send(Buffer&& message); // C++11
   void send(Buffer* message);  // this one will swap data
+  /// Queues @c message without copying it, the same block can be
+  /// sent to many connections.  *message must not be modified afterwards.
+  void send(const std::shared_ptr<const string>& message);
+  /// Queues @c len bytes of file @c fd from @c offset, they are sent with
+  /// sendfile(2) in order with data of other send() calls.
+  /// @c fd is dup(2)ed, the caller may close it right after.
+  void sendFile(int fd, off_t offset, size_t len);
   void shutdown(); // NOT thread safe, no simultaneous calling
   // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
   void forceClose();
   void forceCloseWithDelay(double seconds);
   void setTcpNoDelay(bool on);
+  /// SO_BUSY_POLL, see EventLoop::setBusyPoll() for the loop side.
+  void setBusyPoll(int microSeconds);
   // reading or not
   void startRead();
   void stopRead();
@@ -99,10 +112,49 @@ class TcpConnection : noncopyable,
   void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
   { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+  /// Completion mode reading, a capable poller (MUDUO_USE_IOURING) receives
+  /// into inputBuffer() from buffers shared by the whole loop, and
+  /// inputBuffer() is released whenever the message callback drains it.
+  /// Falls back to readiness reading with other pollers.
+  /// Must be called before connectEstablished().
+  void setRecvCompletion(bool on)
+  { recvCompletion_ = on; }
+
+  /// Blocks of send(shared_ptr) with at least @c bytes left are sent with
+  /// MSG_ZEROCOPY, the block is kept alive until the kernel reports on
+  /// the socket error queue that it is done with the pages.  Blocks still
+  /// in flight when the connection is destroyed are kept by its loop,
+  /// with a dup of the socket to read their completions, until they come.
+  /// 0 disables, which is the default.
+  /// Must be called before connectEstablished() or in loop thread.
+  void setZeroCopyThreshold(size_t bytes);
+
+  /// Edge-triggered readiness, see Channel::setEdgeTriggered(), saves the
+  /// epoll_wait() returns for a connection read slower than it receives.
+  /// Reads until EAGAIN, but at most readBudget bytes per turn, the rest
+  /// is read after the other ready connections of the loop had theirs.
+  /// Must be called before connectEstablished() or in loop thread.
+  void setEdgeTriggered(bool on);
+  void setReadBudget(size_t bytes)
+  { readBudget_ = bytes > 0 ? bytes : 1; }
+
+  /// Bytes held by this connection: itself and its buffers, including
+  /// output it copied, not blocks shared by send(shared_ptr).  The buffers
+  /// are empty until used and drained ones give back what they grew past
+  /// BufferPool::maxIdleCapacity(), so an idle connection holds little.
+  /// In loop thread.
+  size_t memoryFootprint() const;
+
+  /// Blocks sent with MSG_ZEROCOPY and not yet completed.
+  size_t zeroCopyPendingBlocks() const
+  { return zeroCopyPending_.size(); }
+
   /// Advanced interface
   Buffer* inputBuffer()
   { return &inputBuffer_; }
 
+  /// Head of the output queue, blocks queued by send(shared_ptr)
+  /// and the bytes sent after them are not in it.
   Buffer* outputBuffer()
   { return &outputBuffer_; }
 
@@ -118,12 +170,34 @@ class TcpConnection : noncopyable,
  private:
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
   void handleRead(Timestamp receiveTime);
+  void handleReadEdgeTriggered(Timestamp receiveTime);
+  void resumeRead();
   void handleWrite();
   void handleClose();
   void handleError();
   // void sendInLoop(string&& message);
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
+  void sendBlockInLoop(const std::shared_ptr<const string>& message);
+  void sendFileInLoop(int fd, off_t offset, size_t len);
+  void checkHighWaterMark(size_t remaining);
+  void sendInLoop(const void* message, size_t len,
+                  const std::shared_ptr<const string>& block);
+  size_t outputBytes() const
+  { return outputBuffer_.readableBytes() + outputBlocksBytes_; }
+  void appendOutput(const char* data, size_t len);
+  ssize_t writeOutput();
+  void retrieveOutput(size_t len);
+  struct ZeroCopyBlock;
+  struct ZeroCopyLinger;
+  ssize_t sendZeroCopy(const std::shared_ptr<const string>& block,
+                       const char* data, size_t len);
+  bool handleZeroCopyCompletions();
+  static bool drainZeroCopyCompletions(int sockfd, const string& name,
+                                       std::deque<ZeroCopyBlock>* pending);
+  void lingerZeroCopy();
+  static void checkZeroCopyLinger(EventLoop* loop,
+                                  const std::shared_ptr<ZeroCopyLinger>& linger);
   void shutdownInLoop();
   // void shutdownAndForceCloseInLoop(double seconds);
   void forceCloseInLoop();
@@ -131,11 +205,13 @@ class TcpConnection : noncopyable,
   const char* stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
+  void releaseInputBuffer();
 
   EventLoop* loop_;
   const string name_;
   StateE state_;  // FIXME: use atomic variable
   bool reading_;
+  bool recvCompletion_;
   // we don't expose those classes to client.
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_; //channel_关注socket_的可读可写事件
@@ -149,7 +225,31 @@ class TcpConnection : noncopyable,
   CloseCallback closeCallback_; //内部的连接断开回调函数
   size_t highWaterMark_; //高水位标
   Buffer inputBuffer_; //应用层接收缓冲区（每个线程私有）
-  Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer. 应用层发送缓冲区
+  // 应用层发送缓冲区: outputBuffer_ followed by outputBlocks_, flushed with writev
+  struct OutputBlock
+  {
+    std::shared_ptr<const string> data;  // NULL for a file region
+    size_t offset;  // next byte to write, in *data or in the file
+    size_t end;     // of the file region
+    int fd;         // owned, file region queued by sendFile()
+
+    size_t readableBytes() const
+    { return data ? data->size() - offset : end - offset; }
+  };
+  Buffer outputBuffer_;
+  std::deque<OutputBlock> outputBlocks_;
+  string* outputTail_;  // outputBlocks_.back() if it's ours to append copies to
+  size_t outputBlocksBytes_;
+  struct ZeroCopyBlock
+  {
+    uint32_t seq;  // of the send(2), numbered by the kernel per socket
+    std::shared_ptr<const string> data;  // NULL once completed
+  };
+  size_t zeroCopyThreshold_;
+  uint32_t zeroCopySeq_;
+  std::deque<ZeroCopyBlock> zeroCopyPending_;
+  size_t readBudget_;  // per turn, with edge-triggered channel_
+  bool readResumeQueued_;
   boost::any context_; //绑定一个未知类型的上下文对象
   // FIXME: creationTime_, lastReceiveTime_
   //        bytesReceived_, bytesSent_
@@ -8,6 +8,7 @@
 
 #include <muduo/net/TcpServer.h>
 
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Acceptor.h>
 #include <muduo/net/EventLoop.h>
@@ -19,6 +20,31 @@
 using namespace muduo;
 using namespace muduo::net;
 
+namespace
+{
+
+void listenInLoop(Acceptor* acceptor, CountDownLatch* latch)
+{
+  acceptor->listen();
+  latch->countDown();
+}
+
+void destroyInLoop(Acceptor* acceptor, CountDownLatch* latch)
+{
+  delete acceptor;
+  latch->countDown();
+}
+
+void connectEstablished(const std::vector<TcpConnectionPtr>& conns)
+{
+  for (const TcpConnectionPtr& conn : conns)
+  {
+    conn->connectEstablished();
+  }
+}
+
+}  // namespace
+
 TcpServer::TcpServer(EventLoop* loop,
                      const InetAddress& listenAddr,
                      const string& nameArg,
@@ -26,16 +52,24 @@ TcpServer::TcpServer(EventLoop* loop,
   : loop_(CHECK_NOTNULL(loop)),//检查loop不是空指针
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
-    acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    listenAddr_(listenAddr),
+    option_(option),
+    acceptor_(new Acceptor(loop, listenAddr, option != kNoReusePort)),
     threadPool_(new EventLoopThreadPool(loop, name_)), //将mainReactor，baseloop_传进来
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
-    nextConnId_(1)
+    recvCompletion_(false),
+    zeroCopyThreshold_(0),
+    edgeTriggered_(false),
+    reusePortCpuSteering_(false),
+    acceptBudget_(1),
+    loadBalance_(kRoundRobin),
+    self_(new TcpServer*(this))
 {
-  // Acceptor::handleRead函数中会回调TcpServer::newConnection
-  // _1对应的是socket文件描述符，_2对应的是对等方的地址（InetAddress)
-  acceptor_->setNewConnectionCallback(
-      std::bind(&TcpServer::newConnection, this, _1, _2));
+  // Acceptor::handleRead函数中会回调TcpServer::newConnections
+  // _1是这次唤醒accept到的所有(socket文件描述符, 对等方的地址)
+  acceptor_->setNewConnectionsCallback(
+      std::bind(&TcpServer::newConnections, this, _1));
 }
 
 TcpServer::~TcpServer()
@@ -43,13 +77,34 @@ TcpServer::~TcpServer()
   loop_->assertInLoopThread();
   LOG_TRACE << "TcpServer::~TcpServer [" << name_ << "] destructing";
 
-  for (auto& item : connections_)
+  // stops accepting before touching connections_
+  CountDownLatch latch(static_cast<int>(ioLoopAcceptors_.size()));
+  for (auto& acceptor : ioLoopAcceptors_)
   {
-    TcpConnectionPtr conn(item.second);
-    item.second.reset();
-    conn->getLoop()->runInLoop(
-      std::bind(&TcpConnection::connectDestroyed, conn));
+    EventLoop* ioLoop = acceptor->getLoop();
+    ioLoop->runInLoop(std::bind(destroyInLoop, acceptor.release(), &latch));
+  }
+  latch.wait();
+
+  // Waits for every loop to destroy its connections.  A close being
+  // handled in an I/O loop is over by then, and the others can't call
+  // removeConnection() any more.  Batches newConnections() queued to a
+  // loop before run first, so their connections are made and destroyed
+  // here, not left to a functor which outlives this.
+  std::vector<EventLoop*> loops;
+  if (threadPool_->started())
+  {
+    loops = threadPool_->getAllLoops();
+  }
+  CountDownLatch destroyed(static_cast<int>(loops.size()));
+  for (EventLoop* ioLoop : loops)
+  {
+    ioLoop->runInLoop(std::bind(&TcpServer::destroyConnectionsInLoop, this, ioLoop, &destroyed));
   }
+  destroyed.wait();
+  assert(connections_.empty());
+  // removeConnectionInLoop() queued in loop_ meanwhile skips this server
+  self_.reset();
 }
 
 void TcpServer::setThreadNum(int numThreads)
@@ -58,29 +113,149 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);//设置线程池中IO线程个数，不包括主EventLoop所属的IO线程
 }
 
+void TcpServer::setThreadPlacement(const std::vector<ThreadPlacement>& plan)
+{
+  threadPool_->setThreadPlacement(plan);
+}
+
 // 该函数多次调用是无害的
 // 该函数可以跨线程调用
 void TcpServer::start()
 {
   if (started_.getAndSet(1) == 0)
   {
+    if (loadBalance_ == kLeastConnections)
+    {
+      threadPool_->setLoopSelector(EventLoopThreadPool::leastConnections());
+    }
+    else if (loadBalance_ == kLeastRecentlyBusy)
+    {
+      threadPool_->setLoopSelector(EventLoopThreadPool::leastRecentlyBusy());
+    }
     threadPool_->start(threadInitCallback_); //线程初始化的回调函数
 
     assert(!acceptor_->listenning());
-    // get_pointer返回原生指针
-    loop_->runInLoop(
-        std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+    acceptor_->setAcceptBudget(acceptBudget_);
+    if (option_ == kReusePortPerLoop && threadPool_->getAllLoops()[0] != loop_)
+    {
+      startIoLoopAcceptors();
+    }
+    else
+    {
+      // get_pointer返回原生指针
+      loop_->runInLoop(
+          std::bind(&Acceptor::listen, get_pointer(acceptor_)));
+    }
+  }
+}
+
+// The kernel picks a socket of a SO_REUSEPORT group by the order they
+// listen, so they are started one by one for the CPU steering.
+void TcpServer::startIoLoopAcceptors()
+{
+  std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+  for (EventLoop* ioLoop : loops)
+  {
+    Acceptor* acceptor = new Acceptor(ioLoop, listenAddr_, true);
+    ioLoopAcceptors_.emplace_back(acceptor);
+    acceptor->setAcceptBudget(acceptBudget_);
+    acceptor->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnectionInIoLoop, this, ioLoop, _1, _2));
+    CountDownLatch latch(1);
+    ioLoop->runInLoop(std::bind(listenInLoop, acceptor, &latch));
+    latch.wait();
+  }
+  if (reusePortCpuSteering_)
+  {
+    // loop i is the i-th to listen
+    const std::vector<ThreadPlacement>& plan = threadPool_->threadPlacement();
+    std::vector<int> indexOfCpu;
+    for (size_t i = 0; i < loops.size() && !plan.empty(); ++i)
+    {
+      for (int cpu : plan[i % plan.size()].cpus)
+      {
+        if (static_cast<size_t>(cpu) >= indexOfCpu.size())
+        {
+          indexOfCpu.resize(cpu + 1, -1);
+        }
+        if (indexOfCpu[cpu] < 0)
+        {
+          indexOfCpu[cpu] = static_cast<int>(i);
+        }
+      }
+    }
+    ioLoopAcceptors_.front()->attachReusePortCpuFilter(static_cast<int>(loops.size()),
+                                                       indexOfCpu);
   }
+  LOG_INFO << "TcpServer::start [" << name_ << "] - accepting in "
+           << loops.size() << " loops";
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
+// Hands the connections to their loops with one functor per loop,
+// not one per connection, that's one wakeup of each loop per batch.
+void TcpServer::newConnections(const std::vector<std::pair<int, InetAddress>>& accepted)
 {
   loop_->assertInLoopThread();
-  // 按照轮叫的方式选择一个EventLoop
-  EventLoop* ioLoop = threadPool_->getNextLoop();
+  if (!threadPool_->threadPlacement().empty())
+  {
+    std::map<EventLoop*, std::vector<std::pair<int, InetAddress>>> batches;
+    for (const auto& it : accepted)
+    {
+      // counted until its channel is, for leastConnections()
+      EventLoop* ioLoop = threadPool_->getNextLoop();
+      ioLoop->countChannel(1);
+      batches[ioLoop].push_back(it);
+    }
+    for (auto& batch : batches)
+    {
+      batch.first->runInLoop(std::bind(&TcpServer::newConnectionsInIoLoop, this,
+                                       batch.first, std::move(batch.second)));
+    }
+    return;
+  }
+
+  if (accepted.size() == 1)
+  {
+    EventLoop* ioLoop = threadPool_->getNextLoop();
+    TcpConnectionPtr conn = createConnection(ioLoop, accepted[0].first, accepted[0].second);
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    return;
+  }
+
+  std::map<EventLoop*, std::vector<TcpConnectionPtr>> batches;
+  for (const auto& it : accepted)
+  {
+    // 按照轮叫的方式选择一个EventLoop
+    EventLoop* ioLoop = threadPool_->getNextLoop();
+    batches[ioLoop].push_back(createConnection(ioLoop, it.first, it.second));
+  }
+  for (auto& batch : batches)
+  {
+    batch.first->runInLoop(std::bind(connectEstablished, std::move(batch.second)));
+  }
+}
+
+void TcpServer::newConnectionInIoLoop(EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr)
+{
+  ioLoop->assertInLoopThread();
+  createConnection(ioLoop, sockfd, peerAddr)->connectEstablished();
+}
+
+void TcpServer::newConnectionsInIoLoop(EventLoop* ioLoop,
+                                       const std::vector<std::pair<int, InetAddress>>& accepted)
+{
+  ioLoop->assertInLoopThread();
+  for (const auto& it : accepted)
+  {
+    createConnection(ioLoop, it.first, it.second)->connectEstablished();
+    ioLoop->countChannel(-1);
+  }
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr)
+{
   char buf[64];
-  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-  ++nextConnId_;
+  snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_.incrementAndGet());
   string connName = name_ + buf;
 
   LOG_INFO << "TcpServer::newConnection [" << name_
@@ -95,33 +270,102 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
                                           localAddr,
                                           peerAddr));
   // LOG_TRACE << "wyy: [1] usecount=" << conn.use_count();
-  connections_[connName] = conn;
+  {
+    MutexLockGuard lock(mutex_);
+    connections_[connName] = conn;
+  }
   // LOG_TRACE << "wyy: [2] usecount=" << connn.use_count();
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setRecvCompletion(recvCompletion_);
+  if (zeroCopyThreshold_ > 0)
+  {
+    conn->setZeroCopyThreshold(zeroCopyThreshold_);
+  }
+  if (edgeTriggered_)
+  {
+    conn->setEdgeTriggered(true);
+  }
   conn->setCloseCallback(
-      std::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
-  ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
-  // LOG_TRACE << "wyy: [5] usecount=" << conn.use_count(); //2，跳出newConnection后引用计数变为1，只有connections_中存了一个指针
+      std::bind(&TcpServer::removeConnection, this, _1));
+  return conn;
+}
+
+void TcpServer::destroyConnectionsInLoop(EventLoop* ioLoop, CountDownLatch* latch)
+{
+  ioLoop->assertInLoopThread();
+  std::vector<TcpConnectionPtr> conns;
+  {
+    MutexLockGuard lock(mutex_);
+    for (ConnectionMap::iterator it = connections_.begin(); it != connections_.end(); )
+    {
+      if (it->second->getLoop() == ioLoop)
+      {
+        conns.push_back(it->second);
+        it = connections_.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+  for (const TcpConnectionPtr& conn : conns)
+  {
+    // no removeConnection() of a destroyed server afterwards
+    conn->setCloseCallback(CloseCallback());
+    conn->connectDestroyed();
+  }
+  latch->countDown();
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr& conn)
 {
-  // FIXME: unsafe
-  loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+  if (option_ == kReusePortPerLoop)
+  {
+    // called in the loop of conn, the one which accepted it
+    removeConnectionInLoop(conn);
+    return;
+  }
+  loop_->runInLoop(std::bind(&TcpServer::removeConnectionIfAlive,
+                             std::weak_ptr<TcpServer*>(self_), conn));
+}
+
+void TcpServer::removeConnectionIfAlive(const std::weak_ptr<TcpServer*>& server,
+                                        const TcpConnectionPtr& conn)
+{
+  std::shared_ptr<TcpServer*> guard(server.lock());
+  if (guard)
+  {
+    (*guard)->removeConnectionInLoop(conn);
+  }
 }
 
 void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
 {
-  loop_->assertInLoopThread();
+  if (option_ == kReusePortPerLoop)
+  {
+    conn->getLoop()->assertInLoopThread();
+  }
+  else
+  {
+    loop_->assertInLoopThread();
+  }
   LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
            << "] - connection " << conn->name();
   // LOG_TRACE << "wyy: [8] usecount=" << conn.use_count();//3
-  size_t n = connections_.erase(conn->name());
+  size_t n = 0;
+  {
+    MutexLockGuard lock(mutex_);
+    n = connections_.erase(conn->name());
+  }
   // LOG_TRACE << "wyy: [9] usecount=" << conn.use_count();//2
-  (void)n;
-  assert(n == 1);
+  if (n == 0)
+  {
+    // kReusePortPerLoop, the destructor has it and destroys it
+    return;
+  }
   EventLoop* ioLoop = conn->getLoop();
   ioLoop->queueInLoop(
       std::bind(&TcpConnection::connectDestroyed, conn));
@@ -12,13 +12,21 @@
 #define MUDUO_NET_TCPSERVER_H
 
 #include <muduo/base/Atomic.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
 #include <muduo/base/Types.h>
+#include <muduo/net/InetAddress.h>
 #include <muduo/net/TcpConnection.h>
 
 #include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace muduo
 {
+class CountDownLatch;
+
 namespace net
 {
 
@@ -38,6 +46,18 @@ class TcpServer : noncopyable
   {
     kNoReusePort,
     kReusePort,
+    /// Every I/O loop accepts on its own SO_REUSEPORT socket and keeps
+    /// the connections it accepts, the kernel spreads new connections
+    /// over the sockets, so accepting scales with the I/O threads.
+    kReusePortPerLoop,
+  };
+  /// How new connections are assigned to the I/O loops,
+  /// see EventLoopThreadPool::setLoopSelector() for others.
+  enum LoadBalance
+  {
+    kRoundRobin,
+    kLeastConnections,
+    kLeastRecentlyBusy,
   };
 
   //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
@@ -53,7 +73,8 @@ class TcpServer : noncopyable
 
   /// Set the number of threads for handling input.
   ///
-  /// Always accepts new connection in loop's thread.
+  /// Accepts new connection in loop's thread, unless the option
+  /// is kReusePortPerLoop.
   /// Must be called before @c start
   /// @param numThreads
   /// - 0 means all I/O in loop's thread, no thread will created.
@@ -62,6 +83,40 @@ class TcpServer : noncopyable
   /// - N means a thread pool with N threads, new connections
   ///   are assigned on a round-robin basis.
   void setThreadNum(int numThreads);
+  /// Default kRoundRobin, not used with kReusePortPerLoop.
+  /// Must be called before @c start
+  void setLoadBalance(LoadBalance loadBalance)
+  { loadBalance_ = loadBalance; }
+  /// Read new connections in completion mode,
+  /// see TcpConnection::setRecvCompletion().
+  /// Must be called before @c start
+  void setRecvCompletion(bool on)
+  { recvCompletion_ = on; }
+  /// see TcpConnection::setZeroCopyThreshold().
+  /// Must be called before @c start
+  void setZeroCopyThreshold(size_t bytes)
+  { zeroCopyThreshold_ = bytes; }
+  /// see TcpConnection::setEdgeTriggered().
+  /// Must be called before @c start
+  void setEdgeTriggered(bool on)
+  { edgeTriggered_ = on; }
+  /// With kReusePortPerLoop, steers a new connection to the loop with
+  /// index (cpu % numThreads) of the CPU which received it, with a BPF
+  /// program, so it stays on one CPU if loop i is pinned to CPU i.
+  /// With setThreadPlacement(), to the loop placed on that CPU.
+  /// Must be called before @c start
+  void setReusePortCpuSteering(bool on)
+  { reusePortCpuSteering_ = on; }
+  /// Pins the I/O threads, see EventLoopThreadPool::setThreadPlacement().
+  /// New connections are then created in their I/O thread, so their
+  /// buffers are allocated on its NUMA node.
+  /// Must be called before @c start
+  void setThreadPlacement(const std::vector<ThreadPlacement>& plan);
+  /// see Acceptor::setAcceptBudget(), accepted connections are handed
+  /// to the I/O loops in one batch per loop.
+  /// Must be called before @c start
+  void setAcceptBudget(int budget)
+  { acceptBudget_ = budget; }
   void setThreadInitCallback(const ThreadInitCallback& cb)
   { threadInitCallback_ = cb; }
   /// valid after calling start()
@@ -93,27 +148,52 @@ class TcpServer : noncopyable
 
  private:
   /// Not thread safe, but in loop
-  void newConnection(int sockfd, const InetAddress& peerAddr);
+  void newConnections(const std::vector<std::pair<int, InetAddress>>& accepted);
+  /// Not thread safe, but in ioLoop, for kReusePortPerLoop
+  void newConnectionInIoLoop(EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr);
+  /// Not thread safe, but in ioLoop, with a thread placement
+  void newConnectionsInIoLoop(EventLoop* ioLoop,
+                              const std::vector<std::pair<int, InetAddress>>& accepted);
+  TcpConnectionPtr createConnection(EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr);
+  /// In ioLoop, from the destructor
+  void destroyConnectionsInLoop(EventLoop* ioLoop, CountDownLatch* latch);
   /// Thread safe.
   void removeConnection(const TcpConnectionPtr& conn);
-  /// Not thread safe, but in loop
+  /// In loop, does nothing if the server is gone.
+  static void removeConnectionIfAlive(const std::weak_ptr<TcpServer*>& server,
+                                      const TcpConnectionPtr& conn);
+  /// Not thread safe, but in loop, or in the loop of conn for kReusePortPerLoop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
+  void startIoLoopAcceptors();
 
   typedef std::map<string, TcpConnectionPtr> ConnectionMap;//TcpConnectionPtr连接对象的指针
 
   EventLoop* loop_;  // the acceptor loop; Acceptor所属的EventLoop，不一定是连接所属的EventLoop
   const string ipPort_; //服务端口
   const string name_; //服务名
+  const InetAddress listenAddr_;
+  const Option option_;
   std::unique_ptr<Acceptor> acceptor_; // avoid revealing Acceptor； 有创建套接字和监听的功能
+  // one per I/O loop for kReusePortPerLoop, acceptor_ then only holds the port
+  std::vector<std::unique_ptr<Acceptor>> ioLoopAcceptors_;
   std::shared_ptr<EventLoopThreadPool> threadPool_;
   ConnectionCallback connectionCallback_; //连接到来的回调函数
   MessageCallback messageCallback_; //消息到来的回调函数
   WriteCompleteCallback writeCompleteCallback_;
   ThreadInitCallback threadInitCallback_;
+  bool recvCompletion_;
+  size_t zeroCopyThreshold_;
+  bool edgeTriggered_;
+  bool reusePortCpuSteering_;
+  int acceptBudget_;
+  LoadBalance loadBalance_;
   AtomicInt32 started_; //是否已经启动
-  // always in loop thread
-  int nextConnId_; //下一个连接ID
-  ConnectionMap connections_; //连接列表
+  AtomicInt32 nextConnId_; //下一个连接ID
+  // in loop thread, or in any I/O loop for kReusePortPerLoop
+  mutable MutexLock mutex_;
+  ConnectionMap connections_ GUARDED_BY(mutex_); //连接列表
+  // reset by the dtor, for functors it leaves queued in loop_
+  std::shared_ptr<TcpServer*> self_;
 };
 
 }  // namespace net
@@ -8,6 +8,8 @@
 
 #include <muduo/net/Timer.h>
 
+#include <assert.h>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -18,10 +20,34 @@ void Timer::restart(Timestamp now)
   if (repeat_)
   {
     // 重复的计数器，重新计算下一个超时时刻
-    expiration_ = addTime(now, interval_);
+    expiration_ = coalesce(addTime(now, interval_), slack_);
   }
   else
   {
     expiration_ = Timestamp::invalid();
   }
 }
+
+void Timer::reuse(InplaceFunction<void ()> cb, Timestamp when, double interval,
+                  double slack)
+{
+  assert(wheelSlot_ < 0);
+  callback_ = std::move(cb);
+  expiration_ = coalesce(when, slack);
+  interval_ = interval;
+  slack_ = slack;
+  repeat_ = interval > 0.0;
+  sequence_ = s_numCreated_.incrementAndGet();
+}
+
+Timestamp Timer::coalesce(Timestamp when, double slack)
+{
+  int64_t slackUs = static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond);
+  if (slackUs <= 1 || !when.valid())
+  {
+    return when;
+  }
+  int64_t granularity = static_cast<int64_t>(1) << (63 - __builtin_clzll(static_cast<uint64_t>(slackUs)));
+  int64_t us = when.microSecondsSinceEpoch();
+  return Timestamp((us + granularity - 1) / granularity * granularity);
+}
@@ -12,6 +12,7 @@
 #define MUDUO_NET_TIMER_H
 
 #include <muduo/base/Atomic.h>
+#include <muduo/base/InplaceFunction.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/net/Callbacks.h>
 
@@ -26,12 +27,18 @@ namespace net
 class Timer : noncopyable
 {
  public:
-  Timer(TimerCallback cb, Timestamp when, double interval)
+  Timer(InplaceFunction<void ()> cb, Timestamp when, double interval,
+        double slack = 0.0)
     : callback_(std::move(cb)),
-      expiration_(when),
+      expiration_(coalesce(when, slack)),
       interval_(interval),
+      slack_(slack),
       repeat_(interval > 0.0),
-      sequence_(s_numCreated_.incrementAndGet())
+      sequence_(s_numCreated_.incrementAndGet()),
+      wheelPrev_(NULL),
+      wheelNext_(NULL),
+      wheelSlot_(-1),
+      hashNext_(NULL)
   { }
 
   void run() const
@@ -45,14 +52,34 @@ class Timer : noncopyable
 
   void restart(Timestamp now);
 
+  /// Makes a finished timer a new one with a new sequence, so TimerQueue
+  /// can recycle it.  Must not be in a TimingWheel.
+  void reuse(InplaceFunction<void ()> cb, Timestamp when, double interval,
+             double slack);
+  /// Drops the callback and what it holds, before the timer is recycled.
+  void release() { callback_ = nullptr; }
+
   static int64_t numCreated() { return s_numCreated_.get(); }
 
+  /// Rounds @c when up to a multiple of the largest power of two
+  /// microseconds not above @c slack seconds, so timers with similar
+  /// slack and nearby expirations share one and fire in one wakeup.
+  static Timestamp coalesce(Timestamp when, double slack);
+
  private:
-  const TimerCallback callback_; //定时器回调函数
+  InplaceFunction<void ()> callback_; //定时器回调函数
   Timestamp expiration_; //下一次的超时时刻
-  const double interval_;//超时时间间隔，如果是一次性定时器，该值为0
-  const bool repeat_; //是否重复
-  const int64_t sequence_; //定时器序号
+  double interval_;//超时时间间隔，如果是一次性定时器，该值为0
+  double slack_;  // how late it may fire, in seconds
+  bool repeat_; //是否重复
+  int64_t sequence_; //定时器序号
+
+  // links of the TimingWheel slot and hash bucket it is in
+  friend class TimingWheel;
+  Timer* wheelPrev_;
+  Timer* wheelNext_;
+  int wheelSlot_;  // level * 64 + index, -1 if not in a wheel
+  Timer* hashNext_;
 
   static AtomicInt64 s_numCreated_;//定时器计数，当前已经创建的定时器数量
 };
@@ -13,9 +13,11 @@
 #include <muduo/net/TimerQueue.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/base/ThreadLocalSingleton.h>
 #include <muduo/net/EventLoop.h>
 #include <muduo/net/Timer.h>
 #include <muduo/net/TimerId.h>
+#include <muduo/net/TimingWheel.h>
 
 #include <sys/timerfd.h>
 #include <unistd.h>
@@ -27,6 +29,22 @@ namespace net
 namespace detail
 {
 
+const size_t kMaxFreeTimers = 1024;
+
+// Finished timers of the loops in this thread, reused by the timers it adds.
+struct FreeTimers : noncopyable
+{
+  ~FreeTimers()
+  {
+    for (Timer* timer : timers)
+    {
+      delete timer;
+    }
+  }
+
+  std::vector<Timer*> timers;
+};
+
 int createTimerfd()
 {
   int timerfd = ::timerfd_create(CLOCK_MONOTONIC,
@@ -120,15 +138,29 @@ TimerQueue::~TimerQueue()
 }
 
 // 线程安全的
-TimerId TimerQueue::addTimer(TimerCallback cb,
+TimerId TimerQueue::addTimer(InplaceFunction<void ()> cb,
                              Timestamp when,
-                             double interval)
+                             double interval,
+                             double slack)
 {
-  Timer* timer = new Timer(std::move(cb), when, interval);
+  Timer* timer = NULL;
+  std::vector<Timer*>& freeTimers = ThreadLocalSingleton<FreeTimers>::instance().timers;
+  if (!freeTimers.empty())
+  {
+    timer = freeTimers.back();
+    freeTimers.pop_back();
+    timer->reuse(std::move(cb), when, interval, slack);
+  }
+  else
+  {
+    timer = new Timer(std::move(cb), when, interval, slack);
+  }
+  // read before the loop has it, it may fire and be reused by then
+  const int64_t sequence = timer->sequence();
   // addTimerInLoop任务会交给loop_对应的IO线程来处理；所以addTimerInLoop中insert就不用加锁了
   loop_->runInLoop(
       std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return TimerId(timer, timer->sequence());
+  return TimerId(timer, sequence);
 }
 
 void TimerQueue::cancel(TimerId timerId)
@@ -146,7 +178,34 @@ void TimerQueue::addTimerInLoop(Timer* timer)
   if (earliestChanged)
   {
     // 重置定时器的超时时刻（timerfd_settime)
-    resetTimerfd(timerfd_, timer->expiration());
+    resetTimerfd(timerfd_, wheel_ ? wheel_->nextExpiration() : timer->expiration());
+  }
+}
+
+void TimerQueue::useTimingWheel(int64_t tickMicroSeconds)
+{
+  loop_->assertInLoopThread();
+  assert(!callingExpiredTimers_);
+  std::vector<Timer*> timers;
+  if (wheel_)
+  {
+    wheel_->takeAll(&timers);
+  }
+  for (const Entry& it : timers_)
+  {
+    timers.push_back(it.second);
+  }
+  timers_.clear();
+  activeTimers_.clear();
+
+  wheel_.reset(new TimingWheel(tickMicroSeconds, Timestamp::now()));
+  for (Timer* timer : timers)
+  {
+    wheel_->insert(timer);
+  }
+  if (!timers.empty())
+  {
+    resetTimerfd(timerfd_, wheel_->nextExpiration());
   }
 }
 
@@ -155,12 +214,24 @@ void TimerQueue::cancelInLoop(TimerId timerId)
   loop_->assertInLoopThread();
   assert(timers_.size() == activeTimers_.size());
   ActiveTimer timer(timerId.timer_, timerId.sequence_);
+  if (wheel_)
+  {
+    if (wheel_->erase(timerId.timer_, timerId.sequence_))
+    {
+      recycle(timerId.timer_);
+    }
+    else if (callingExpiredTimers_)
+    {
+      cancelingTimers_.insert(timer);
+    }
+    return;
+  }
   ActiveTimerSet::iterator it = activeTimers_.find(timer);
   if (it != activeTimers_.end())
   {
     size_t n = timers_.erase(Entry(it->first->expiration(), it->first));
     assert(n == 1); (void)n;
-    delete it->first; // FIXME: no delete please ，如果用了unique_ptr，这里就不需要手动删除了
+    recycle(it->first);
     activeTimers_.erase(it);
   }
   else if (callingExpiredTimers_)
@@ -199,6 +270,17 @@ std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
 {
   assert(timers_.size() == activeTimers_.size());
   std::vector<Entry> expired;
+  if (wheel_)
+  {
+    std::vector<Timer*> timers;
+    wheel_->takeExpired(now, &timers);
+    expired.reserve(timers.size());
+    for (Timer* timer : timers)
+    {
+      expired.push_back(Entry(timer->expiration(), timer));
+    }
+    return expired;
+  }
   Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
   // 返回第一个未到期的Timer的迭代器
   // lower_bound的含义是返回第一个值>=sentry的元素的iterator
@@ -240,12 +322,15 @@ void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
     else
     {
       // 一次性定时器或者已被取消的定时器是不能重置的，因此删除该定时器
-      // FIXME move to a free list
-      delete it.second; // FIXME: no delete please
+      recycle(it.second);
     }
   }
 
-  if (!timers_.empty())
+  if (wheel_)
+  {
+    nextExpire = wheel_->nextExpiration();
+  }
+  else if (!timers_.empty())
   {
     // 获取最早到期的定时器超时时间
     nextExpire = timers_.begin()->second->expiration();
@@ -257,10 +342,30 @@ void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
   }
 }
 
+void TimerQueue::recycle(Timer* timer)
+{
+  std::vector<Timer*>& freeTimers = ThreadLocalSingleton<FreeTimers>::instance().timers;
+  if (freeTimers.size() < kMaxFreeTimers)
+  {
+    timer->release();
+    freeTimers.push_back(timer);
+  }
+  else
+  {
+    delete timer;
+  }
+}
+
 bool TimerQueue::insert(Timer* timer)
 {
   loop_->assertInLoopThread();
   assert(timers_.size() == activeTimers_.size());
+  if (wheel_)
+  {
+    Timestamp earliest = wheel_->nextExpiration();
+    wheel_->insert(timer);
+    return !earliest.valid() || wheel_->nextExpiration() < earliest;
+  }
   // 最早到期时间是否改变
   bool earliestChanged = false;
   Timestamp when = timer->expiration();
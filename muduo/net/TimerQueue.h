@@ -11,9 +11,11 @@
 #ifndef MUDUO_NET_TIMERQUEUE_H
 #define MUDUO_NET_TIMERQUEUE_H
 
+#include <memory>
 #include <set>
 #include <vector>
 
+#include <muduo/base/InplaceFunction.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/net/Callbacks.h>
@@ -27,6 +29,7 @@ namespace net
 class EventLoop;
 class Timer;
 class TimerId;
+class TimingWheel;
 
 ///
 /// A best efforts timer queue.
@@ -46,16 +49,24 @@ class TimerQueue : noncopyable
   ///
   /// Schedules the callback to be run at given time,
   /// repeats if @c interval > 0.0.
+  /// It may run up to @c slack seconds late, see Timer::coalesce().
   ///
   /// Must be thread safe. Usually be called from other threads.
   // 添加一个定时器，一定是线程安全的，可以跨线程调用。通常情况下被其他线程调用。
-  TimerId addTimer(TimerCallback cb,
+  TimerId addTimer(InplaceFunction<void ()> cb,
                    Timestamp when,
-                   double interval);
+                   double interval,
+                   double slack = 0.0);
 
 // 取消一个定时器，传入一个TimerId外部类
   void cancel(TimerId timerId);
 
+  ///
+  /// Indexes timers with a TimingWheel of @c tickMicroSeconds ticks
+  /// instead of the sets, pending timers are moved over.
+  /// Must be called in loop thread.
+  void useTimingWheel(int64_t tickMicroSeconds);
+
  private:
 
   // FIXME: use unique_ptr<Timer> instead of raw pointers.
@@ -84,6 +95,8 @@ class TimerQueue : noncopyable
   void reset(const std::vector<Entry>& expired, Timestamp now);
 
   bool insert(Timer* timer);
+  // keeps a finished timer for this thread to reuse, or deletes it
+  void recycle(Timer* timer);
 
   EventLoop* loop_; //所属的EventLoop
   const int timerfd_; //所创建的定时器描述符
@@ -95,6 +108,8 @@ class TimerQueue : noncopyable
   // timers与activeTimers_保存的是相同的数据
   // timers_是按到期时间排序，activeTimers_是按对象地址排序
   ActiveTimerSet activeTimers_;
+  // replaces timers_ and activeTimers_ if set
+  std::unique_ptr<TimingWheel> wheel_;
   bool callingExpiredTimers_; /* atomic *///是否处于调用处理那些到期定时器中
   ActiveTimerSet cancelingTimers_; //保存的是被取消的定时器
 };
@@ -0,0 +1,306 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/TimingWheel.h>
+
+#include <muduo/net/Timer.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <assert.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+const size_t kMinBuckets = 64;
+
+uint64_t bit(int64_t index)
+{
+  return static_cast<uint64_t>(1) << index;
+}
+
+}  // namespace
+
+TimingWheel::TimingWheel(int64_t tickMicroSeconds, Timestamp now)
+  : tickMicroSeconds_(tickMicroSeconds),
+    currentTick_(now.microSecondsSinceEpoch() / tickMicroSeconds),
+    size_(0),
+    buckets_(kMinBuckets)
+{
+  assert(tickMicroSeconds_ > 0);
+  std::fill(occupied_, occupied_ + kLevels, 0);
+}
+
+TimingWheel::~TimingWheel()
+{
+  std::vector<Timer*> timers;
+  takeAll(&timers);
+  for (Timer* timer : timers)
+  {
+    delete timer;
+  }
+}
+
+// rounds up, never fires early
+int64_t TimingWheel::expirationTick(const Timer* timer) const
+{
+  int64_t us = timer->expiration().microSecondsSinceEpoch();
+  return (us + tickMicroSeconds_ - 1) / tickMicroSeconds_;
+}
+
+void TimingWheel::insert(Timer* timer)
+{
+  assert(timer->wheelSlot_ < 0);
+  link(timer, currentTick_ + 1);
+  if (++size_ > buckets_.size())
+  {
+    rehash(buckets_.size() * 2);
+  }
+  hash(timer);
+}
+
+bool TimingWheel::erase(Timer* timer, int64_t sequence)
+{
+  // only timers in the wheel are dereferenced, @c timer may be gone
+  for (Timer** it = bucket(sequence); *it; it = &(*it)->hashNext_)
+  {
+    if (*it == timer && timer->sequence() == sequence)
+    {
+      *it = timer->hashNext_;
+      timer->hashNext_ = NULL;
+      unlink(timer);
+      --size_;
+      return true;
+    }
+  }
+  return false;
+}
+
+Timer** TimingWheel::bucket(int64_t sequence)
+{
+  return &buckets_[static_cast<size_t>(sequence) & (buckets_.size() - 1)];
+}
+
+void TimingWheel::hash(Timer* timer)
+{
+  Timer** head = bucket(timer->sequence());
+  timer->hashNext_ = *head;
+  *head = timer;
+}
+
+void TimingWheel::unhash(Timer* timer)
+{
+  Timer** it = bucket(timer->sequence());
+  while (*it != timer)
+  {
+    assert(*it);
+    it = &(*it)->hashNext_;
+  }
+  *it = timer->hashNext_;
+  timer->hashNext_ = NULL;
+}
+
+void TimingWheel::rehash(size_t buckets)
+{
+  std::vector<Timer*> old(buckets);
+  buckets_.swap(old);
+  for (Timer* head : old)
+  {
+    while (head)
+    {
+      Timer* next = head->hashNext_;
+      hash(head);
+      head = next;
+    }
+  }
+}
+
+// Level l takes timers due in [64^l, 64^(l+1)) ticks, in slot (when >> 6l) % 64,
+// which cascades down at tick (when >> 6l) << 6l, after now and before when.
+// Timers due before @c earliest go to its slot.
+void TimingWheel::link(Timer* timer, int64_t earliest)
+{
+  int64_t when = std::max(expirationTick(timer), earliest);
+  int64_t delta = when - currentTick_;
+  int level = 0;
+  while (level < kLevels - 1 && delta >= (static_cast<int64_t>(1) << (kSlotBits * (level + 1))))
+  {
+    ++level;
+  }
+  const int64_t range = static_cast<int64_t>(1) << (kSlotBits * kLevels);
+  if (delta >= range)
+  {
+    when = currentTick_ + range - 1;  // parked, placed again when it cascades
+  }
+  int64_t index = (when >> (kSlotBits * level)) & kSlotMask;
+
+  Slot& slot = slots_[level][index];
+  timer->wheelPrev_ = NULL;
+  timer->wheelNext_ = slot.head;
+  if (slot.head)
+  {
+    slot.head->wheelPrev_ = timer;
+  }
+  slot.head = timer;
+  occupied_[level] |= bit(index);
+  timer->wheelSlot_ = static_cast<int>(level * kSlots + index);
+}
+
+void TimingWheel::unlink(Timer* timer)
+{
+  assert(timer->wheelSlot_ >= 0);
+  int level = timer->wheelSlot_ / kSlots;
+  int index = timer->wheelSlot_ % kSlots;
+  Slot& slot = slots_[level][index];
+  if (timer->wheelPrev_)
+  {
+    timer->wheelPrev_->wheelNext_ = timer->wheelNext_;
+  }
+  else
+  {
+    assert(slot.head == timer);
+    slot.head = timer->wheelNext_;
+  }
+  if (timer->wheelNext_)
+  {
+    timer->wheelNext_->wheelPrev_ = timer->wheelPrev_;
+  }
+  if (!slot.head)
+  {
+    occupied_[level] &= ~bit(index);
+  }
+  timer->wheelPrev_ = NULL;
+  timer->wheelNext_ = NULL;
+  timer->wheelSlot_ = -1;
+}
+
+void TimingWheel::takeSlot(int level, int index, std::vector<Timer*>* timers)
+{
+  Slot& slot = slots_[level][index];
+  for (Timer* timer = slot.head; timer; )
+  {
+    Timer* next = timer->wheelNext_;
+    timer->wheelPrev_ = NULL;
+    timer->wheelNext_ = NULL;
+    timer->wheelSlot_ = -1;
+    timers->push_back(timer);
+    timer = next;
+  }
+  slot.head = NULL;
+  occupied_[level] &= ~bit(index);
+}
+
+// called when level 0 wraps, moves the due slot of each level down
+void TimingWheel::cascade()
+{
+  std::vector<Timer*> timers;
+  for (int level = 1; level < kLevels; ++level)
+  {
+    int index = static_cast<int>((currentTick_ >> (kSlotBits * level)) & kSlotMask);
+    if (occupied_[level] & bit(index))
+    {
+      timers.clear();
+      takeSlot(level, index, &timers);
+      for (Timer* timer : timers)
+      {
+        // slot 0 of currentTick_ is taken right after
+        link(timer, currentTick_);
+      }
+    }
+    if (index != 0)
+    {
+      break;
+    }
+  }
+}
+
+void TimingWheel::takeExpired(Timestamp now, std::vector<Timer*>* expired)
+{
+  const int64_t nowTick = now.microSecondsSinceEpoch() / tickMicroSeconds_;
+  while (currentTick_ < nowTick)
+  {
+    // jumps to the next non-empty slot of level 0, or to where it wraps
+    const int64_t next = currentTick_ + 1;
+    const int64_t index = next & kSlotMask;
+    const uint64_t pending = occupied_[0] & (~static_cast<uint64_t>(0) << index);
+    int64_t target = next - index + kSlots;
+    if (index == 0)
+    {
+      target = next;
+    }
+    else if (pending)
+    {
+      target = next - index + __builtin_ctzll(pending);
+    }
+    if (target > nowTick)
+    {
+      currentTick_ = nowTick;
+      break;
+    }
+
+    currentTick_ = target;
+    if ((currentTick_ & kSlotMask) == 0)
+    {
+      cascade();
+    }
+    size_t begin = expired->size();
+    takeSlot(0, static_cast<int>(currentTick_ & kSlotMask), expired);
+    for (size_t i = begin; i < expired->size(); ++i)
+    {
+      unhash((*expired)[i]);
+    }
+    size_ -= expired->size() - begin;
+  }
+}
+
+Timestamp TimingWheel::nextExpiration() const
+{
+  if (size_ == 0)
+  {
+    return Timestamp::invalid();
+  }
+  int64_t earliest = std::numeric_limits<int64_t>::max();
+  for (int level = 0; level < kLevels; ++level)
+  {
+    if (occupied_[level] == 0)
+    {
+      continue;
+    }
+    // the k-th slot after the current one is due at tick (base + k) << 6l
+    const int64_t base = currentTick_ >> (kSlotBits * level);
+    const int shift = static_cast<int>((base & kSlotMask) + 1);
+    uint64_t rotated = occupied_[level];
+    if (shift < kSlots)
+    {
+      rotated = (rotated >> shift) | (rotated << (kSlots - shift));
+    }
+    int64_t k = __builtin_ctzll(rotated) + 1;
+    earliest = std::min(earliest, (base + k) << (kSlotBits * level));
+  }
+  return Timestamp(earliest * tickMicroSeconds_);
+}
+
+void TimingWheel::takeAll(std::vector<Timer*>* timers)
+{
+  const size_t begin = timers->size();
+  for (int level = 0; level < kLevels; ++level)
+  {
+    for (int index = 0; index < kSlots; ++index)
+    {
+      if (occupied_[level] & bit(index))
+      {
+        takeSlot(level, index, timers);
+      }
+    }
+  }
+  for (size_t i = begin; i < timers->size(); ++i)
+  {
+    (*timers)[i]->hashNext_ = NULL;
+  }
+  std::vector<Timer*>(kMinBuckets).swap(buckets_);
+  size_ = 0;
+}
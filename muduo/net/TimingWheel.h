@@ -0,0 +1,86 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMINGWHEEL_H
+#define MUDUO_NET_TIMINGWHEEL_H
+
+#include <muduo/base/Timestamp.h>
+#include <muduo/base/noncopyable.h>
+
+#include <vector>
+
+namespace muduo
+{
+namespace net
+{
+
+class Timer;
+
+///
+/// Hierarchical timing wheel, an alternative index for TimerQueue.
+///
+/// kLevels levels of 64 slots, a slot of level l spans 64^l ticks, so with
+/// 1ms ticks it covers 12 days, farther timers are parked in the last level
+/// and placed again when it cascades.  Insert and erase are O(1), slots are
+/// intrusive lists through Timer, and a bitmap per level finds the next
+/// non-empty slot without scanning.  An intrusive hash by sequence finds
+/// a timer for erase() without touching the one a TimerId points at.
+///
+/// A timer never fires before its expiration, but up to one tick after it.
+///
+class TimingWheel : noncopyable
+{
+ public:
+  explicit TimingWheel(int64_t tickMicroSeconds, Timestamp now);
+  ~TimingWheel();  // deletes the timers still in it
+
+  void insert(Timer* timer);
+  /// Removes the timer if it is in the wheel with @c sequence, returns
+  /// false otherwise.  @c timer is only compared, it may be deleted or
+  /// reused for another one.
+  bool erase(Timer* timer, int64_t sequence);
+  /// Moves out all timers expired at @c now, in expiration order of ticks.
+  void takeExpired(Timestamp now, std::vector<Timer*>* expired);
+  /// When takeExpired() has anything to do next, invalid if empty.
+  Timestamp nextExpiration() const;
+
+  size_t size() const { return size_; }
+  /// Appends all timers, for moving them to another index.
+  void takeAll(std::vector<Timer*>* timers);
+
+ private:
+  static const int kLevels = 5;
+  static const int kSlotBits = 6;
+  static const int kSlots = 1 << kSlotBits;
+  static const int64_t kSlotMask = kSlots - 1;
+
+  struct Slot
+  {
+    Slot() : head(NULL) { }
+    Timer* head;
+  };
+
+  int64_t expirationTick(const Timer* timer) const;
+  void link(Timer* timer, int64_t earliest);
+  void unlink(Timer* timer);
+  void cascade();
+  void takeSlot(int level, int index, std::vector<Timer*>* timers);
+  Timer** bucket(int64_t sequence);
+  void hash(Timer* timer);
+  void unhash(Timer* timer);
+  void rehash(size_t buckets);
+
+  const int64_t tickMicroSeconds_;
+  int64_t currentTick_;  // every tick up to and including it is taken
+  Slot slots_[kLevels][kSlots];
+  uint64_t occupied_[kLevels];  // bitmap of non-empty slots
+  size_t size_;
+  std::vector<Timer*> buckets_;  // by sequence, a power of two of them
+};
+
+}  // namespace net
+}  // namespace muduo
+
+#endif  // MUDUO_NET_TIMINGWHEEL_H
@@ -9,6 +9,11 @@
 #include <muduo/net/Poller.h>
 #include <muduo/net/poller/PollPoller.h>
 #include <muduo/net/poller/EPollPoller.h>
+#ifndef NO_IO_URING
+#include <muduo/net/poller/IoUringPoller.h>
+#endif
+
+#include <muduo/base/Logging.h>
 
 #include <stdlib.h>
 
@@ -20,6 +25,17 @@ Poller* Poller::newDefaultPoller(EventLoop* loop)
   {
     return new PollPoller(loop);
   }
+#ifndef NO_IO_URING
+  else if (::getenv("MUDUO_USE_IOURING"))
+  {
+    if (IoUringPoller::available())
+    {
+      return new IoUringPoller(loop);
+    }
+    LOG_WARN << "io_uring is not available, fall back to epoll";
+    return new EPollPoller(loop);
+  }
+#endif
   else
   {
     return new EPollPoller(loop);
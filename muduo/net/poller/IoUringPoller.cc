@@ -0,0 +1,613 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#ifndef NO_IO_URING
+
+#include <muduo/net/poller/IoUringPoller.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/Channel.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+// user_data of POLL_REMOVE requests, their completions are dropped.
+const uint64_t kCancelUserData = ~static_cast<uint64_t>(0);
+
+int sysIoUringSetup(unsigned entries, struct io_uring_params* params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sysIoUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete,
+                    unsigned flags, const void* arg, size_t argSize)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, toSubmit,
+                                    minComplete, flags, arg, argSize));
+}
+
+#ifdef IORING_RECV_MULTISHOT
+int sysIoUringRegister(int ringFd, unsigned opcode, void* arg, unsigned nrArgs)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_register, ringFd, opcode,
+                                    arg, nrArgs));
+}
+#endif
+
+const uint16_t kRecvBufferGroup = 0;
+const uint32_t kCqeBufferFlag = IORING_CQE_F_BUFFER;
+const uint32_t kCqeMoreFlag = IORING_CQE_F_MORE;
+const unsigned kCqeBufferShift = IORING_CQE_BUFFER_SHIFT;
+
+template<typename T>
+T* ringField(void* ring, unsigned offset)
+{
+  return static_cast<T*>(static_cast<void*>(static_cast<char*>(ring) + offset));
+}
+
+// NODROP: completions are never lost when the CQ ring overflows.
+// EXT_ARG: io_uring_enter(2) takes a wait timeout directly.
+const unsigned kRequiredFeatures = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+}  // namespace
+
+bool IoUringPoller::available()
+{
+  static const bool supported = []
+  {
+    struct io_uring_params params;
+    memZero(&params, sizeof params);
+    int fd = sysIoUringSetup(4, &params);
+    if (fd < 0)
+    {
+      return false;
+    }
+    ::close(fd);
+    return (params.features & kRequiredFeatures) == kRequiredFeatures;
+  }();
+  return supported;
+}
+
+IoUringPoller::IoUringPoller(EventLoop* loop)
+  : Poller(loop),
+    ringFd_(-1),
+    sqEntries_(0),
+    sqRingPtr_(NULL),
+    sqRingSize_(0),
+    cqRingPtr_(NULL),
+    cqRingSize_(0),
+    sqes_(NULL),
+    sqesSize_(0),
+    sqHead_(NULL),
+    sqTail_(NULL),
+    sqMask_(0),
+    sqArray_(NULL),
+    cqHead_(NULL),
+    cqTail_(NULL),
+    cqMask_(0),
+    cqes_(NULL),
+    sqLocalTail_(0),
+    round_(0),
+    recvSupported_(false),
+    recvRing_(NULL),
+    recvBuffers_(NULL),
+    recvRingTail_(0)
+{
+  struct io_uring_params params;
+  memZero(&params, sizeof params);
+  // every armed fd may have one poll and one cancel completion in flight
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = kRingEntries * 8;
+  ringFd_ = sysIoUringSetup(kRingEntries, &params);
+  if (ringFd_ < 0)
+  {
+    LOG_SYSFATAL << "IoUringPoller::IoUringPoller - io_uring_setup";
+  }
+  if ((params.features & kRequiredFeatures) != kRequiredFeatures)
+  {
+    LOG_FATAL << "IoUringPoller::IoUringPoller - kernel lacks NODROP/EXT_ARG";
+  }
+
+  sqEntries_ = params.sq_entries;
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap)
+  {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+
+  sqRingPtr_ = ::mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+  if (sqRingPtr_ == MAP_FAILED)
+  {
+    LOG_SYSFATAL << "IoUringPoller::IoUringPoller - mmap sq ring";
+  }
+  if (singleMmap)
+  {
+    cqRingPtr_ = sqRingPtr_;
+  }
+  else
+  {
+    cqRingPtr_ = ::mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+    if (cqRingPtr_ == MAP_FAILED)
+    {
+      LOG_SYSFATAL << "IoUringPoller::IoUringPoller - mmap cq ring";
+    }
+  }
+  sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED)
+  {
+    LOG_SYSFATAL << "IoUringPoller::IoUringPoller - mmap sqes";
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  sqHead_ = ringField<unsigned>(sqRingPtr_, params.sq_off.head);
+  sqTail_ = ringField<unsigned>(sqRingPtr_, params.sq_off.tail);
+  sqMask_ = *ringField<unsigned>(sqRingPtr_, params.sq_off.ring_mask);
+  sqArray_ = ringField<unsigned>(sqRingPtr_, params.sq_off.array);
+  cqHead_ = ringField<unsigned>(cqRingPtr_, params.cq_off.head);
+  cqTail_ = ringField<unsigned>(cqRingPtr_, params.cq_off.tail);
+  cqMask_ = *ringField<unsigned>(cqRingPtr_, params.cq_off.ring_mask);
+  cqes_ = ringField<struct io_uring_cqe>(cqRingPtr_, params.cq_off.cqes);
+  sqLocalTail_ = *sqTail_;
+  setupRecvBuffers();
+}
+
+IoUringPoller::~IoUringPoller()
+{
+  ::munmap(sqes_, sqesSize_);
+  if (cqRingPtr_ != sqRingPtr_)
+  {
+    ::munmap(cqRingPtr_, cqRingSize_);
+  }
+  ::munmap(sqRingPtr_, sqRingSize_);
+  ::close(ringFd_);
+  if (recvRing_)
+  {
+    ::munmap(recvRing_, kRecvBufferCount * sizeof(struct io_uring_buf));
+    ::munmap(recvBuffers_, kRecvBufferCount * kRecvBufferSize);
+  }
+}
+
+void IoUringPoller::setupRecvBuffers()
+{
+#ifdef IORING_RECV_MULTISHOT
+  void* ring = ::mmap(NULL, kRecvBufferCount * sizeof(struct io_uring_buf),
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  void* buffers = ::mmap(NULL, kRecvBufferCount * kRecvBufferSize,
+                         PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ring == MAP_FAILED || buffers == MAP_FAILED)
+  {
+    LOG_SYSFATAL << "IoUringPoller::setupRecvBuffers - mmap";
+  }
+  struct io_uring_buf_reg reg;
+  memZero(&reg, sizeof reg);
+  reg.ring_addr = reinterpret_cast<uintptr_t>(ring);
+  reg.ring_entries = kRecvBufferCount;
+  reg.bgid = kRecvBufferGroup;
+  if (sysIoUringRegister(ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+  {
+    // kernel older than 5.19, completion mode silently degrades to polling
+    LOG_SYSERR << "IoUringPoller::setupRecvBuffers - IORING_REGISTER_PBUF_RING";
+    ::munmap(ring, kRecvBufferCount * sizeof(struct io_uring_buf));
+    ::munmap(buffers, kRecvBufferCount * kRecvBufferSize);
+    return;
+  }
+  recvRing_ = static_cast<struct io_uring_buf_ring*>(ring);
+  recvBuffers_ = static_cast<char*>(buffers);
+  for (unsigned bid = 0; bid < kRecvBufferCount; ++bid)
+  {
+    recycleRecvBuffer(bid);
+  }
+  __atomic_store_n(&recvRing_->tail, recvRingTail_, __ATOMIC_RELEASE);
+  recvSupported_ = true;
+#endif
+}
+
+void IoUringPoller::recycleRecvBuffer(unsigned bid)
+{
+  assert(bid < kRecvBufferCount);
+  // not recvRing_->bufs, g++ lays the flexible array member out at offset 8
+  struct io_uring_buf* bufs = static_cast<struct io_uring_buf*>(
+      static_cast<void*>(recvRing_));
+  struct io_uring_buf* buf = &bufs[recvRingTail_ & (kRecvBufferCount - 1)];
+  buf->addr = reinterpret_cast<uintptr_t>(recvBuffers_ + bid * kRecvBufferSize);
+  buf->len = kRecvBufferSize;
+  buf->bid = static_cast<uint16_t>(bid);
+  ++recvRingTail_;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+  LOG_TRACE << "fd total count " << channels_.size();
+  flushChanges();
+  // completions left over from the last round must not block us
+  const bool pending = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+  int ret = submit(pending ? 0 : 1, timeoutMs);
+  int savedErrno = errno;
+  Timestamp now(Timestamp::now());
+  if (ret < 0 && savedErrno != EINTR && savedErrno != ETIME)
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "IoUringPoller::poll()";
+  }
+  int numEvents = reapCompletions(activeChannels);
+  if (numEvents > 0)
+  {
+    LOG_TRACE << numEvents << " events happened";
+  }
+  else
+  {
+    LOG_TRACE << "nothing happened";
+  }
+  return now;
+}
+
+int IoUringPoller::submit(unsigned minComplete, int timeoutMs)
+{
+  const unsigned toSubmit = sqLocalTail_ - *sqTail_;
+  __atomic_store_n(sqTail_, sqLocalTail_, __ATOMIC_RELEASE);
+
+  unsigned flags = 0;
+  const void* arg = NULL;
+  size_t argSize = 0;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg getEventsArg;
+  if (minComplete > 0)
+  {
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+    memZero(&getEventsArg, sizeof getEventsArg);
+    getEventsArg.sigmask_sz = _NSIG / 8;
+    getEventsArg.ts = reinterpret_cast<uintptr_t>(&ts);
+    arg = &getEventsArg;
+    argSize = sizeof getEventsArg;
+  }
+  else if (toSubmit == 0)
+  {
+    return 0;
+  }
+  return sysIoUringEnter(ringFd_, toSubmit, minComplete, flags, arg, argSize);
+}
+
+int IoUringPoller::reapCompletions(ChannelList* activeChannels)
+{
+  int numEvents = 0;
+  ++round_;
+  const uint16_t oldRecvRingTail = recvRingTail_;
+  unsigned head = *cqHead_;
+  const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head)
+  {
+    const struct io_uring_cqe& cqe = cqes_[head & cqMask_];
+    if (cqe.user_data == kCancelUserData)
+    {
+      continue;
+    }
+    const int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    if (implicit_cast<size_t>(fd) >= registrations_.size())
+    {
+      continue;
+    }
+    Registration& reg = registrations_[fd];
+    if (cqe.user_data == reg.pollUserData)
+    {
+      // one-shot, re-arm in the next batch
+      reg.pollUserData = 0;
+      reg.pollEvents = 0;
+      markDirty(fd);
+      if (cqe.res < 0)
+      {
+        if (cqe.res != -ECANCELED)
+        {
+          errno = -cqe.res;
+          LOG_SYSERR << "IoUringPoller::poll() fd = " << fd;
+        }
+        continue;
+      }
+      ChannelMap::const_iterator it = channels_.find(fd);
+      assert(it != channels_.end());
+      activate(it->second, cqe.res, activeChannels, &numEvents);
+    }
+    else if (cqe.user_data == reg.recvUserData
+             || (cqe.flags & kCqeBufferFlag))
+    {
+      handleRecvCompletion(cqe, fd, activeChannels, &numEvents);
+    }
+    // else cancelled or re-armed since, the kernel raced us
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+  if (recvRingTail_ != oldRecvRingTail)
+  {
+    __atomic_store_n(&recvRing_->tail, recvRingTail_, __ATOMIC_RELEASE);
+  }
+  return numEvents;
+}
+
+void IoUringPoller::handleRecvCompletion(const struct io_uring_cqe& cqe, int fd,
+                                         ChannelList* activeChannels, int* numEvents)
+{
+  Registration& reg = registrations_[fd];
+  const bool current = cqe.user_data == reg.recvUserData;
+  if (current && !(cqe.flags & kCqeMoreFlag))
+  {
+    // multishot recv terminated: EOF, error or out of buffers
+    reg.recvUserData = 0;
+    markDirty(fd);
+  }
+
+  // a cancelled recv may have consumed bytes already, keep them
+  // unless they belong to a channel which has gone.
+  Channel* channel = NULL;
+  const uint32_t generation = static_cast<uint32_t>(cqe.user_data >> 32);
+  // not below the epoch, modulo 2^32, generations of a busy fd wrap
+  if (static_cast<int32_t>(generation - reg.epoch) >= 0)
+  {
+    ChannelMap::const_iterator it = channels_.find(fd);
+    if (it != channels_.end() && it->second->recvBuffer())
+    {
+      channel = it->second;
+    }
+  }
+
+  if (cqe.flags & kCqeBufferFlag)
+  {
+    const unsigned bid = cqe.flags >> kCqeBufferShift;
+    if (channel && cqe.res > 0)
+    {
+      channel->recvBuffer()->append(recvBuffers_ + bid * kRecvBufferSize,
+                                    implicit_cast<size_t>(cqe.res));
+    }
+    recycleRecvBuffer(bid);
+  }
+
+  if (!channel || cqe.res == -ENOBUFS || cqe.res == -ECANCELED)
+  {
+    return;
+  }
+  if (cqe.res == -EINVAL && current)
+  {
+    LOG_WARN << "IoUringPoller - multishot recv unsupported, fall back to poll";
+    recvSupported_ = false;
+    return;
+  }
+  if (current || (cqe.res > 0 && channel->isReading()))
+  {
+    channel->addRecvResult(cqe.res);
+    activate(channel, POLLIN, activeChannels, numEvents);
+  }
+}
+
+void IoUringPoller::activate(Channel* channel, int revents,
+                             ChannelList* activeChannels, int* numEvents)
+{
+  Registration& reg = registrations_[channel->fd()];
+  if (reg.round != round_)
+  {
+    reg.round = round_;
+    channel->set_revents(revents);
+    activeChannels->push_back(channel);
+    ++*numEvents;
+  }
+  else
+  {
+    channel->set_revents(channel->revents() | revents);
+  }
+}
+
+void IoUringPoller::updateChannel(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  const int index = channel->index();
+  const int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd
+    << " events = " << channel->events() << " index = " << index;
+  if (index == kNew)
+  {
+    assert(channels_.find(fd) == channels_.end());
+    channels_[fd] = channel;
+    Registration& reg = registration(fd);
+    reg.epoch = reg.generation + 1;
+  }
+  else
+  {
+    assert(channels_.find(fd) != channels_.end());
+    assert(channels_[fd] == channel);
+  }
+  channel->set_index(channel->isNoneEvent() ? kDeleted : kAdded);
+  markDirty(fd);
+}
+
+void IoUringPoller::removeChannel(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd;
+  assert(channels_.find(fd) != channels_.end());
+  assert(channels_[fd] == channel);
+  assert(channel->isNoneEvent());
+  int index = channel->index();
+  assert(index == kAdded || index == kDeleted);
+  (void)index;
+  size_t n = channels_.erase(fd);
+  (void)n;
+  assert(n == 1);
+
+  // Queues the cancels, they are submitted with the next poll().  The fd
+  // may be closed and reused before that, completions of the old requests
+  // then match no user data of the registration, and bytes they received
+  // carry a generation below the epoch of the new channel, so both are
+  // dropped.
+  Registration& reg = registration(fd);
+  if (reg.pollUserData != 0)
+  {
+    cancelPoll(&reg);
+  }
+  if (reg.recvUserData != 0)
+  {
+    cancelRecv(&reg);
+  }
+  channel->set_index(kNew);
+}
+
+IoUringPoller::Registration& IoUringPoller::registration(int fd)
+{
+  assert(fd >= 0);
+  if (implicit_cast<size_t>(fd) >= registrations_.size())
+  {
+    registrations_.resize(fd * 2 + 1);
+  }
+  return registrations_[fd];
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+  Registration& reg = registration(fd);
+  if (!reg.dirty)
+  {
+    reg.dirty = true;
+    dirtyFds_.push_back(fd);
+  }
+}
+
+void IoUringPoller::flushChanges()
+{
+  for (int fd : dirtyFds_)
+  {
+    Registration& reg = registrations_[fd];
+    reg.dirty = false;
+    ChannelMap::const_iterator it = channels_.find(fd);
+    Channel* channel = it == channels_.end() ? NULL : it->second;
+    const int events = channel ? channel->events() : 0;
+    const bool recv = recvSupported_ && channel && channel->recvBuffer()
+                      && (events & POLLIN);
+    const int pollEvents = recv ? events & ~(POLLIN | POLLPRI) : events;
+
+    if (recv && reg.recvUserData == 0)
+    {
+      armRecv(channel, &reg);
+    }
+    else if (!recv && reg.recvUserData != 0)
+    {
+      cancelRecv(&reg);
+    }
+
+    if (reg.pollUserData != 0 && reg.pollEvents != pollEvents)
+    {
+      cancelPoll(&reg);
+    }
+    if (reg.pollUserData == 0 && pollEvents != 0)
+    {
+      armPoll(channel, pollEvents, &reg);
+    }
+  }
+  dirtyFds_.clear();
+}
+
+uint64_t IoUringPoller::nextUserData(int fd, Registration* reg)
+{
+  ++reg->generation;
+  if (reg->generation == 0)
+  {
+    ++reg->generation;  // never produce user_data 0 or kCancelUserData
+  }
+  return (static_cast<uint64_t>(reg->generation) << 32)
+         | static_cast<uint32_t>(fd);
+}
+
+void IoUringPoller::armPoll(Channel* channel, int events, Registration* reg)
+{
+  reg->pollUserData = nextUserData(channel->fd(), reg);
+  reg->pollEvents = events;
+
+  LOG_TRACE << "poll_add fd = " << channel->fd()
+            << " event = { " << channel->eventsToString() << " }";
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = channel->fd();
+  sqe->poll32_events = static_cast<uint32_t>(events);
+  sqe->user_data = reg->pollUserData;
+}
+
+void IoUringPoller::armRecv(Channel* channel, Registration* reg)
+{
+#ifdef IORING_RECV_MULTISHOT
+  reg->recvUserData = nextUserData(channel->fd(), reg);
+
+  LOG_TRACE << "recv_multishot fd = " << channel->fd();
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = channel->fd();
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = kRecvBufferGroup;
+  sqe->user_data = reg->recvUserData;
+#else
+  assert(false && "recvSupported_ must be false");
+#endif
+}
+
+void IoUringPoller::cancelPoll(Registration* reg)
+{
+  assert(reg->pollUserData != 0);
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = reg->pollUserData;
+  sqe->user_data = kCancelUserData;
+  reg->pollUserData = 0;
+  reg->pollEvents = 0;
+}
+
+void IoUringPoller::cancelRecv(Registration* reg)
+{
+  assert(reg->recvUserData != 0);
+  struct io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = reg->recvUserData;
+  sqe->user_data = kCancelUserData;
+  reg->recvUserData = 0;
+}
+
+struct io_uring_sqe* IoUringPoller::getSqe()
+{
+  if (sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+  {
+    // submission queue full, hand the batch to the kernel without waiting
+    if (submit(0, 0) < 0)
+    {
+      LOG_SYSFATAL << "IoUringPoller::getSqe - io_uring_enter";
+    }
+  }
+  const unsigned index = sqLocalTail_ & sqMask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memZero(sqe, sizeof *sqe);
+  sqArray_[index] = index;
+  ++sqLocalTail_;
+  return sqe;
+}
+
+#endif  // NO_IO_URING
@@ -0,0 +1,127 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_POLLER_IOURINGPOLLER_H
+#define MUDUO_NET_POLLER_IOURINGPOLLER_H
+
+#include <muduo/net/Poller.h>
+
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// IO Multiplexing with io_uring(7) poll requests.
+///
+/// Interest changes made through updateChannel() are not applied at once,
+/// they are recorded and flushed as SQEs right before the next wait, so
+/// all epoll_ctl()-equivalents of one loop iteration and the wait itself
+/// cost a single io_uring_enter(2).  An enableWriting() followed by a
+/// disableWriting() in the same iteration costs nothing at all.
+///
+/// Poll requests are armed one-shot and re-armed in the next batch after
+/// they fire, which keeps the level-triggered semantics the rest of muduo
+/// relies on (e.g. Buffer::readFd() does not read until EAGAIN).
+///
+/// Channels with a recvBuffer() are read in completion mode instead: a
+/// multishot recv picks a buffer from a ring shared by the whole loop,
+/// the poller appends the bytes to recvBuffer() and recycles the buffer
+/// before the read callback runs, so an idle connection pins no receive
+/// memory in the kernel nor in the loop.
+///
+class IoUringPoller : public Poller
+{
+ public:
+  IoUringPoller(EventLoop* loop);
+  ~IoUringPoller() override;
+
+  Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+  void updateChannel(Channel* channel) override;
+  void removeChannel(Channel* channel) override;
+
+  /// Whether the running kernel supports what this poller needs.
+  static bool available();
+
+ private:
+  static const unsigned kRingEntries = 1024;
+  static const unsigned kRecvBufferCount = 256;  // power of 2
+  static const unsigned kRecvBufferSize = 16 * 1024;
+
+  // per-fd bookkeeping, indexed by fd
+  struct Registration
+  {
+    Registration()
+      : pollUserData(0), pollEvents(0), recvUserData(0),
+        generation(0), epoch(0), round(0), dirty(false)
+    { }
+    uint64_t pollUserData;  // user_data of the armed poll request, 0 if none
+    int pollEvents;         // events of the armed poll request
+    uint64_t recvUserData;  // user_data of the armed multishot recv, 0 if none
+    uint32_t generation;    // bumped on every arm, filters stale completions
+    uint32_t epoch;         // first generation of the current channel
+    int64_t round;          // last reapCompletions() it went active in
+    bool dirty;             // queued in dirtyFds_
+  };
+
+  Registration& registration(int fd);
+  void markDirty(int fd);
+  void flushChanges();
+  uint64_t nextUserData(int fd, Registration* reg);
+  void armPoll(Channel* channel, int events, Registration* reg);
+  void armRecv(Channel* channel, Registration* reg);
+  void cancelPoll(Registration* reg);
+  void cancelRecv(Registration* reg);
+  io_uring_sqe* getSqe();
+  int submit(unsigned minComplete, int timeoutMs);
+  int reapCompletions(ChannelList* activeChannels);
+  void handleRecvCompletion(const io_uring_cqe& cqe, int fd,
+                            ChannelList* activeChannels, int* numEvents);
+  void activate(Channel* channel, int revents,
+                ChannelList* activeChannels, int* numEvents);
+  void setupRecvBuffers();
+  void recycleRecvBuffer(unsigned bid);
+
+  int ringFd_;
+  unsigned sqEntries_;
+
+  // mmap(2)ed rings
+  void* sqRingPtr_;
+  size_t sqRingSize_;
+  void* cqRingPtr_;
+  size_t cqRingSize_;
+  io_uring_sqe* sqes_;
+  size_t sqesSize_;
+
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned* sqArray_;
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe* cqes_;
+
+  unsigned sqLocalTail_;  // SQEs filled but not yet published
+  int64_t round_;
+  std::vector<Registration> registrations_;
+  std::vector<int> dirtyFds_;
+
+  // provided buffers for completion mode receiving
+  bool recvSupported_;
+  io_uring_buf_ring* recvRing_;
+  char* recvBuffers_;
+  uint16_t recvRingTail_;
+};
+
+}  // namespace net
+}  // namespace muduo
+#endif  // MUDUO_NET_POLLER_IOURINGPOLLER_H
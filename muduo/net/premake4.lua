@@ -8,6 +8,7 @@ project "net"
     headersdir('muduo/net')
     headers {
         'Buffer.h',
+        'BufferPool.h',
         'Callbacks.h',
         'Channel.h',
         'Endian.h',
@@ -24,6 +25,8 @@ project "net"
     files {
         'Acceptor.cc',
         'Buffer.cc',
+        'BufferPool.cc',
+        'BufferSearch.cc',
         'Channel.cc',
         'Connector.cc',
         'EventLoop.cc',
@@ -33,6 +36,7 @@ project "net"
         'Poller.cc',
         'poller/DefaultPoller.cc',
         'poller/EPollPoller.cc',
+        'poller/IoUringPoller.cc',
         'poller/PollPoller.cc',
         'Socket.cc',
         'SocketsOps.cc',
@@ -41,5 +45,6 @@ project "net"
         'TcpServer.cc',
         'Timer.cc',
         'TimerQueue.cc',
+        'TimingWheel.cc',
      }
 
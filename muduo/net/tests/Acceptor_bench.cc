@@ -0,0 +1,117 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <memory>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// A connection storm against a TcpServer in the same process: client
+// threads connect bursts of sockets to it and close them, the server
+// counts accepted connections per second and wakeups of its loops.
+//
+// Usage: acceptor_bench [io_threads] [accept_budget] [perloop] [clients] [seconds]
+
+AtomicInt64 g_accepted;
+AtomicInt64 g_connectFailed;
+AtomicInt32 g_stop;
+const int kBurst = 128;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_accepted.increment();
+  }
+}
+
+void storm(const InetAddress& serverAddr)
+{
+  std::vector<int> fds;
+  fds.reserve(kBurst);
+  while (g_stop.get() == 0)
+  {
+    for (int i = 0; i < kBurst; ++i)
+    {
+      int fd = ::socket(serverAddr.family(), SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+      if (::connect(fd, serverAddr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in))) == 0)
+      {
+        fds.push_back(fd);
+      }
+      else
+      {
+        g_connectFailed.increment();
+        ::close(fd);
+      }
+    }
+    for (int fd : fds)
+    {
+      ::close(fd);
+    }
+    fds.clear();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+  int budget = argc > 2 ? atoi(argv[2]) : 1;
+  bool perLoop = argc > 3 && atoi(argv[3]) != 0;
+  int numClients = argc > 4 ? atoi(argv[4]) : 4;
+  int seconds = argc > 5 ? atoi(argv[5]) : 5;
+
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  InetAddress listenAddr("127.0.0.1", 23456);
+  TcpServer server(&loop, listenAddr, "AcceptorBench",
+                   perLoop ? TcpServer::kReusePortPerLoop : TcpServer::kReusePort);
+  server.setConnectionCallback(onConnection);
+  server.setThreadNum(numThreads);
+  server.setAcceptBudget(budget);
+  server.start();
+
+  std::vector<std::unique_ptr<Thread>> clients;
+  for (int i = 0; i < numClients; ++i)
+  {
+    clients.emplace_back(new Thread(std::bind(storm, listenAddr), "storm"));
+    clients.back()->start();
+  }
+
+  Timestamp start = Timestamp::now();
+  loop.runAfter(seconds, [&loop]() { g_stop.getAndSet(1); loop.quit(); });
+  loop.loop();
+  double elapsed = timeDifference(Timestamp::now(), start);
+  for (auto& thr : clients)
+  {
+    thr->join();
+  }
+
+  int64_t wakeups = 0;
+  for (EventLoop* ioLoop : server.threadPool()->getAllLoops())
+  {
+    if (ioLoop != &loop)
+    {
+      wakeups += ioLoop->iteration();
+    }
+  }
+  printf("%d io threads, budget %d, %s: %.0f accepted/s, "
+         "%.2f base loop and %.2f io loop wakeups per connection, %lld connects failed\n",
+         numThreads, budget, perLoop ? "per-loop acceptors" : "one acceptor",
+         static_cast<double>(g_accepted.get()) / elapsed,
+         static_cast<double>(loop.iteration()) / static_cast<double>(g_accepted.get()),
+         static_cast<double>(wakeups) / static_cast<double>(g_accepted.get()),
+         static_cast<long long>(g_connectFailed.get()));
+}
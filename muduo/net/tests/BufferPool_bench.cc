@@ -0,0 +1,208 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/BufferPool.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+
+#include <set>
+#include <vector>
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Connection churn against an echo server like EchoServer_unittest:
+// batches of clients connect, send one message, read the echo and
+// close, so every connection creates and drops its two Buffers, and
+// the input Buffer grows past its initial size for bigger messages.
+// Then as many connections stay open idle after one small message each,
+// for the memory footprint of an idle connection.
+//
+// Usage: bufferpool_bench [pool|heap] [connections] [concurrency] [message_bytes]
+
+std::set<TcpConnectionPtr> g_connections;
+
+void onConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected())
+  {
+    g_connections.insert(conn);
+  }
+  else
+  {
+    g_connections.erase(conn);
+  }
+}
+
+void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  string msg(buf->retrieveAllAsString());
+  conn->send(msg);
+}
+
+long residentKiB()
+{
+  long pages = 0;
+  FILE* fp = ::fopen("/proc/self/statm", "r");
+  if (fp)
+  {
+    long size = 0;
+    if (::fscanf(fp, "%ld %ld", &size, &pages) != 2)
+    {
+      pages = 0;
+    }
+    ::fclose(fp);
+  }
+  return pages * ::sysconf(_SC_PAGESIZE) / 1024;
+}
+
+int connectTo(const InetAddress& addr)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (::connect(fd, addr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in))) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  return fd;
+}
+
+void sendMessage(int fd, const string& message)
+{
+  if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size()))
+  {
+    LOG_SYSFATAL << "write";
+  }
+}
+
+void readEcho(int fd, std::vector<char>* echo)
+{
+  size_t got = 0;
+  while (got < echo->size())
+  {
+    ssize_t n = ::read(fd, &*echo->begin() + got, echo->size() - got);
+    if (n <= 0)
+    {
+      LOG_SYSFATAL << "read";
+    }
+    got += static_cast<size_t>(n);
+  }
+}
+
+void churn(EventLoop* loop, const InetAddress& addr,
+           int numConnections, int concurrency, size_t messageBytes)
+{
+  string message(messageBytes, 'm');
+  std::vector<char> echo(messageBytes);
+  std::vector<int> fds;
+  for (int done = 0; done < numConnections; done += concurrency)
+  {
+    int batch = std::min(concurrency, numConnections - done);
+    fds.clear();
+    for (int i = 0; i < batch; ++i)
+    {
+      fds.push_back(connectTo(addr));
+    }
+    for (int fd : fds)
+    {
+      sendMessage(fd, message);
+    }
+    for (int fd : fds)
+    {
+      readEcho(fd, &echo);
+      ::close(fd);
+    }
+  }
+  loop->runInLoop([loop]() { loop->quit(); });
+}
+
+void reportIdle(CountDownLatch* latch)
+{
+  size_t total = 0;
+  for (const TcpConnectionPtr& conn : g_connections)
+  {
+    total += conn->memoryFootprint();
+  }
+  printf("%zd idle connections: %zd bytes each\n",
+         g_connections.size(),
+         g_connections.empty() ? 0 : total / g_connections.size());
+  latch->countDown();
+}
+
+void idle(EventLoop* loop, const InetAddress& addr, int numConnections)
+{
+  string heartbeat(64, 'h');
+  std::vector<char> echo(heartbeat.size());
+  std::vector<int> fds;
+  for (int i = 0; i < numConnections; ++i)
+  {
+    fds.push_back(connectTo(addr));
+    sendMessage(fds.back(), heartbeat);
+    readEcho(fds.back(), &echo);
+  }
+  CountDownLatch latch(1);
+  loop->runInLoop(std::bind(reportIdle, &latch));
+  latch.wait();
+  for (int fd : fds)
+  {
+    ::close(fd);
+  }
+  loop->runAfter(0.1, [loop]() { loop->quit(); });
+}
+
+int main(int argc, char* argv[])
+{
+  bool pooled = argc <= 1 || strcmp(argv[1], "heap") != 0;
+  int numConnections = argc > 2 ? atoi(argv[2]) : 100000;
+  int concurrency = argc > 3 ? atoi(argv[3]) : 1000;
+  size_t messageBytes = argc > 4 ? static_cast<size_t>(atoi(argv[4])) : 4096;
+
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  if (!pooled)
+  {
+    loop.setBufferPool(std::shared_ptr<BufferPool>());
+  }
+  InetAddress listenAddr("127.0.0.1", 23459);
+  TcpServer server(&loop, listenAddr, "EchoServer");
+  server.setConnectionCallback(onConnection);
+  server.setMessageCallback(onMessage);
+  server.start();
+
+  Thread client(std::bind(churn, &loop, listenAddr, numConnections, concurrency, messageBytes),
+                "churn");
+  Timestamp start(Timestamp::now());
+  client.start();
+  loop.loop();
+  double elapsed = timeDifference(Timestamp::now(), start);
+  client.join();
+
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  printf("%s: %d connections of %zd bytes, %d at a time: %.2f s, %.0f connections/s, %.1f MiB/s\n",
+         pooled ? "pool" : "heap", numConnections, messageBytes, concurrency,
+         elapsed, numConnections / elapsed,
+         static_cast<double>(numConnections) * static_cast<double>(messageBytes) / elapsed / 1024 / 1024);
+  printf("resident %ld KiB, peak %ld KiB\n", residentKiB(), usage.ru_maxrss);
+  if (pooled)
+  {
+    const BufferPool& pool = *loop.bufferPool();
+    printf("pool: %lld blocks allocated, %lld reused, %zd KiB cached\n",
+           static_cast<long long>(pool.numAllocated()),
+           static_cast<long long>(pool.numReused()),
+           pool.cachedBytes() / 1024);
+  }
+
+  Thread idler(std::bind(idle, &loop, listenAddr, concurrency), "idle");
+  idler.start();
+  loop.loop();
+  idler.join();
+}
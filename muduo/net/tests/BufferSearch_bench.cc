@@ -0,0 +1,126 @@
+#include <muduo/net/Buffer.h>
+#include <muduo/net/BufferSearch.h>
+
+#include <muduo/base/Timestamp.h>
+
+#include <algorithm>
+
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Delimiter search over lines of several lengths: std::search as
+// findCRLF() used to, then every kernel of this CPU.  Lines where CR is
+// rare, and lines where every third byte is a CR, i.e. a candidate.
+// Then a long line arriving in segments, searched after every segment
+// by Buffer, which resumes, and by rescanning from peek().
+
+const char kCRLF[] = "\r\n";
+
+string makeLines(size_t lineLength, size_t total, bool dense = false)
+{
+  string line;
+  while (line.size() < lineLength - 2)
+  {
+    line += dense && line.size() % 3 == 2 ? '\r' : 'x';
+  }
+  line.append(kCRLF, 2);
+  string data;
+  while (data.size() < total)
+  {
+    data += line;
+  }
+  return data;
+}
+
+template<typename Find>
+void bench(const char* name, const string& data, size_t lineLength, Find find)
+{
+  const char* end = data.data() + data.size();
+  const int kRounds = 20;
+  int64_t found = 0;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < kRounds; ++i)
+  {
+    const char* p = data.data();
+    while ((p = find(p, end)) != NULL)
+    {
+      ++found;
+      p += 2;
+    }
+  }
+  double seconds = timeDifference(Timestamp::now(), start);
+  printf("%6zd %-13s %8.0f MiB/s %7.1f ns per line\n", lineLength, name,
+         static_cast<double>(data.size()) * kRounds / seconds / 1024 / 1024,
+         seconds * 1e9 / static_cast<double>(found));
+}
+
+void benchLines(size_t lineLength, bool dense)
+{
+  const string data(makeLines(lineLength, 4 * 1024 * 1024, dense));
+  bench("std::search", data, lineLength, [](const char* p, const char* end) {
+    const char* crlf = std::search(p, end, kCRLF, kCRLF + 2);
+    return crlf == end ? NULL : crlf;
+  });
+  for (const search::Kernels& kernels : search::supportedKernels())
+  {
+    bench(kernels.name, data, lineLength, [&kernels](const char* p, const char* end) {
+      return kernels.findPair(p, end, '\r', '\n');
+    });
+  }
+  for (const search::Kernels& kernels : search::supportedKernels())
+  {
+    if (!dense)
+    {
+      string name = string(kernels.name) + " '\\n'";
+      bench(name.c_str(), data, lineLength, [&kernels](const char* p, const char* end) {
+        const char* lf = kernels.findByte(p, end, '\n');
+        return lf ? lf - 1 : NULL;
+      });
+    }
+  }
+}
+
+void benchSegments(size_t lineLength, size_t segment)
+{
+  const string data(makeLines(lineLength, lineLength));
+  const int kRounds = 100;
+  double seconds[2] = { 0, 0 };
+  for (int resume = 0; resume < 2; ++resume)
+  {
+    Timestamp start(Timestamp::now());
+    for (int i = 0; i < kRounds; ++i)
+    {
+      Buffer buf;
+      const char* crlf = NULL;
+      for (size_t off = 0; crlf == NULL; off += segment)
+      {
+        buf.append(data.data() + off, std::min(segment, data.size() - off));
+        crlf = resume ? buf.findCRLF()
+                      : search::findPair(buf.peek(), buf.beginWrite(), '\r', '\n');
+      }
+    }
+    seconds[resume] = timeDifference(Timestamp::now(), start);
+  }
+  printf("%zd byte line in %zd byte segments: rescan %.1f us, resume %.1f us\n",
+         lineLength, segment,
+         seconds[0] * 1e6 / kRounds, seconds[1] * 1e6 / kRounds);
+}
+
+int main()
+{
+  printf("findCRLF() uses %s\n", search::supportedKernels().back().name);
+  const size_t lengths[] = { 16, 64, 256, 1024, 8192 };
+  for (size_t len : lengths)
+  {
+    benchLines(len, false);
+  }
+  printf("every third byte CR\n");
+  for (size_t len : lengths)
+  {
+    benchLines(len, true);
+  }
+  benchSegments(64 * 1024, 1460);
+  benchSegments(1024 * 1024, 1460);
+}
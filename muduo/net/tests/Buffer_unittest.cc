@@ -1,4 +1,5 @@
 #include <muduo/net/Buffer.h>
+#include <muduo/net/BufferSearch.h>
 
 //#define BOOST_TEST_MODULE BufferTest
 #define BOOST_TEST_MAIN
@@ -7,6 +8,7 @@
 
 using muduo::string;
 using muduo::net::Buffer;
+using muduo::net::BufferPool;
 
 BOOST_AUTO_TEST_CASE(testBufferAppendRetrieve)
 {
@@ -168,3 +170,185 @@ BOOST_AUTO_TEST_CASE(testMove)
   // printf("Buffer at %p, inner %p\n", &buf, inner);
   output(std::move(buf), inner);
 }
+
+BOOST_AUTO_TEST_CASE(testBufferPool)
+{
+  std::shared_ptr<BufferPool> pool(new BufferPool);
+  const void* inner = NULL;
+  {
+    Buffer buf(pool);
+    inner = buf.peek();
+  }
+  BOOST_CHECK_EQUAL(pool->numAllocated(), 1);
+  BOOST_CHECK_EQUAL(pool->cachedBytes(), BufferPool::kMinBlockSize);
+
+  Buffer buf(pool);
+  BOOST_CHECK_EQUAL(buf.peek(), inner);
+  BOOST_CHECK_EQUAL(pool->numReused(), 1);
+  BOOST_CHECK_EQUAL(pool->cachedBytes(), 0);
+
+  // grown storage goes back when drained
+  buf.append(string(5000, 'y'));
+  BOOST_CHECK_GT(buf.internalCapacity(), BufferPool::kMinBlockSize);
+  buf.retrieve(4000);
+  BOOST_CHECK_GT(buf.internalCapacity(), BufferPool::kMinBlockSize);
+  buf.retrieveAll();
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+  BOOST_CHECK_GT(pool->cachedBytes(), 0);
+
+  buf.append(string(5000, 'z'));
+  BOOST_CHECK_GT(pool->numReused(), 1);
+  buf.retrieve(4500);
+  buf.shrink(0);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), BufferPool::kMinBlockSize);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(500, 'z'));
+
+  // a copy is on the heap, a swap takes the pool along
+  Buffer copy(buf);
+  BOOST_CHECK(!copy.pool());
+  copy.swap(buf);
+  BOOST_CHECK(copy.pool() == pool);
+  BOOST_CHECK(!buf.pool());
+
+  pool->trim();
+  BOOST_CHECK_EQUAL(pool->cachedBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPoolLimit)
+{
+  std::shared_ptr<BufferPool> pool(new BufferPool(2 * BufferPool::kMinBlockSize));
+  {
+    Buffer b1(pool), b2(pool), b3(pool);
+    Buffer small(pool, 0);  // exactly on the heap
+    Buffer large(pool, 1024 * 1024);
+  }
+  BOOST_CHECK_EQUAL(pool->numAllocated(), 3);
+  BOOST_CHECK_EQUAL(pool->cachedBytes(), 2 * BufferPool::kMinBlockSize);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferPoolIdle)
+{
+  std::shared_ptr<BufferPool> pool(new BufferPool);
+  pool->setMaxIdleCapacity(16 * 1024);
+  Buffer buf(pool, 0);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 0);
+  BOOST_CHECK(buf.peek() == buf.beginWrite());
+
+  buf.append(string(200, 'a'));
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), string(200, 'a'));
+  size_t kept = buf.internalCapacity();
+  BOOST_CHECK_GE(kept, 208);
+
+  buf.append(string(10000, 'b'));
+  buf.retrieveAll();
+  BOOST_CHECK_GT(buf.internalCapacity(), kept);  // within maxIdleCapacity
+
+  buf.append(string(20000, 'c'));
+  buf.retrieveAll();
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), Buffer::kCheapPrepend);
+  buf.prependInt32(42);
+  BOOST_CHECK_EQUAL(buf.readInt32(), 42);
+}
+
+const char* naiveFind(const char* begin, const char* end, const char* delim, size_t len)
+{
+  for (const char* p = begin; p + len <= end; ++p)
+  {
+    if (memcmp(p, delim, len) == 0)
+    {
+      return p;
+    }
+  }
+  return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(testSearchKernels)
+{
+  // mostly delimiter bytes, so matches and near misses land everywhere,
+  // across the 16 and 32 byte blocks and their tails
+  const char alphabet[] = "ab\r\n\xff";
+  string data;
+  unsigned seed = 1;
+  for (int i = 0; i < 4096; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    data += alphabet[(seed >> 16) % 5];
+  }
+  const char* pairs[] = { "\r\n", "\n\r", "\xff\xff", "bb" };
+  for (const muduo::net::search::Kernels& kernels : muduo::net::search::supportedKernels())
+  {
+    BOOST_TEST_MESSAGE("kernels " << kernels.name);
+    for (size_t offset = 0; offset < 40; ++offset)
+    {
+      for (size_t len = 0; len < 200; len += (len < 70 ? 1 : 13))
+      {
+        const char* begin = data.data() + offset * 97 % 3000;
+        const char* end = begin + len;
+        for (const char* pair : pairs)
+        {
+          BOOST_CHECK(kernels.findPair(begin, end, pair[0], pair[1])
+                      == naiveFind(begin, end, pair, 2));
+          BOOST_CHECK(kernels.findByte(begin, end, pair[1])
+                      == naiveFind(begin, end, pair + 1, 1));
+        }
+      }
+    }
+    const string none(1000, 'a');
+    BOOST_CHECK(kernels.findPair(none.data(), none.data() + none.size(), '\r', '\n') == NULL);
+    BOOST_CHECK(kernels.findByte(none.data(), none.data() + none.size(), '\0') == NULL);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testFindDelimiterResume)
+{
+  Buffer buf;
+  const char* null = NULL;
+  buf.append(string(100, 'h'));
+  buf.append("\r");
+  BOOST_CHECK(buf.findCRLF() == null);
+  buf.append("\nHost: muduo\r\n");  // the CR before is a delimiter now
+  const char* crlf = buf.findCRLF();
+  BOOST_CHECK(crlf == buf.peek() + 100);
+  BOOST_CHECK(buf.findCRLF() == crlf);
+  BOOST_CHECK(buf.findCRLF(crlf + 2) == buf.beginWrite() - 2);
+
+  // another delimiter, then back
+  BOOST_CHECK(buf.findDelimiter(" ") == buf.peek() + 107);
+  BOOST_CHECK(buf.findDelimiter(":") == buf.peek() + 106);
+  BOOST_CHECK(buf.findCRLF() == crlf);
+  // other lengths are not cached
+  BOOST_CHECK(buf.findDelimiter("") == null);
+  BOOST_CHECK(buf.findDelimiter("\r\nHost") == crlf);
+  BOOST_CHECK(buf.findDelimiter("\r\nX") == null);
+  BOOST_CHECK(buf.findCRLF() == crlf);
+
+  buf.retrieveUntil(crlf + 2);
+  BOOST_CHECK(buf.findCRLF() == buf.peek() + 11);
+  buf.unwrite(2);
+  BOOST_CHECK(buf.findCRLF() == null);
+  buf.append("\r\n");
+  BOOST_CHECK(buf.findCRLF() == buf.peek() + 11);
+  buf.retrieve(11);
+  BOOST_CHECK(buf.findCRLF() == buf.peek());
+
+  buf.retrieveAll();
+  buf.append("01234567\rX");
+  BOOST_CHECK(buf.findCRLF() == null);
+  buf.unwrite(1);
+  buf.append("\n");
+  BOOST_CHECK(buf.findCRLF() == buf.peek() + 8);
+
+  buf.retrieveAll();
+  buf.append("xyz");
+  BOOST_CHECK(buf.findEOL() == null);
+  buf.prependInt8('\n');
+  BOOST_CHECK(buf.findEOL() == buf.peek());
+
+  Buffer other;
+  other.append("a\nb");
+  buf.swap(other);
+  BOOST_CHECK(buf.findEOL() == buf.peek() + 1);
+  BOOST_CHECK(other.findEOL() == other.peek());
+}
@@ -0,0 +1,162 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Atomic.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+
+#include <memory>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Flooding connections and one echo connection on a single loop,
+// level-triggered or edge-triggered: the discard server counts bytes
+// and loop iterations, the echo client measures round trips stuck
+// behind the flooders.
+//
+// Usage: edgetriggered_bench [edge] [flooders] [seconds] [read_budget_kb]
+
+AtomicInt64 g_discarded;
+AtomicInt32 g_stop;
+size_t g_readBudget = 0;
+
+void onFloodConnection(const TcpConnectionPtr& conn)
+{
+  if (conn->connected() && g_readBudget > 0)
+  {
+    conn->setReadBudget(g_readBudget);
+  }
+}
+
+void onFloodMessage(const TcpConnectionPtr&, Buffer* buf, Timestamp)
+{
+  g_discarded.add(static_cast<int64_t>(buf->readableBytes()));
+  buf->retrieveAll();
+}
+
+void onEchoMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+{
+  conn->send(buf);
+}
+
+int connectTo(const InetAddress& addr)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+  if (::connect(fd, addr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in))) < 0)
+  {
+    LOG_SYSFATAL << "connect";
+  }
+  return fd;
+}
+
+void flood(const InetAddress& addr)
+{
+  int fd = connectTo(addr);
+  std::vector<char> chunk(64 * 1024, 'x');
+  while (g_stop.get() == 0)
+  {
+    if (::write(fd, chunk.data(), chunk.size()) < 0)
+    {
+      break;
+    }
+  }
+  ::close(fd);
+}
+
+void echo(const InetAddress& addr, int64_t* rounds, int64_t* totalUs, int64_t* maxUs)
+{
+  int fd = connectTo(addr);
+  int one = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, static_cast<socklen_t>(sizeof one));
+  char message[16] = "ping";
+  while (g_stop.get() == 0)
+  {
+    Timestamp start(Timestamp::now());
+    if (::write(fd, message, sizeof message) != sizeof message)
+    {
+      break;
+    }
+    size_t got = 0;
+    while (got < sizeof message)
+    {
+      ssize_t n = ::read(fd, message + got, sizeof message - got);
+      if (n <= 0)
+      {
+        ::close(fd);
+        return;
+      }
+      got += static_cast<size_t>(n);
+    }
+    int64_t us = Timestamp::now().microSecondsSinceEpoch() - start.microSecondsSinceEpoch();
+    ++*rounds;
+    *totalUs += us;
+    *maxUs = std::max(*maxUs, us);
+    ::usleep(1000);
+  }
+  ::close(fd);
+}
+
+int main(int argc, char* argv[])
+{
+  bool edge = argc > 1 && atoi(argv[1]) != 0;
+  int numFlooders = argc > 2 ? atoi(argv[2]) : 4;
+  int seconds = argc > 3 ? atoi(argv[3]) : 5;
+  g_readBudget = argc > 4 ? static_cast<size_t>(atoi(argv[4])) * 1024 : 0;
+
+  Logger::setLogLevel(Logger::WARN);
+  EventLoop loop;
+  InetAddress floodAddr("127.0.0.1", 23457);
+  InetAddress echoAddr("127.0.0.1", 23458);
+  TcpServer floodServer(&loop, floodAddr, "Discard");
+  floodServer.setConnectionCallback(onFloodConnection);
+  floodServer.setMessageCallback(onFloodMessage);
+  floodServer.setEdgeTriggered(edge);
+  floodServer.start();
+  TcpServer echoServer(&loop, echoAddr, "Echo");
+  echoServer.setMessageCallback(onEchoMessage);
+  echoServer.setEdgeTriggered(edge);
+  echoServer.start();
+
+  std::vector<std::unique_ptr<Thread>> clients;
+  for (int i = 0; i < numFlooders; ++i)
+  {
+    clients.emplace_back(new Thread(std::bind(flood, floodAddr), "flood"));
+  }
+  int64_t rounds = 0, totalUs = 0, maxUs = 0;
+  clients.emplace_back(new Thread(std::bind(echo, echoAddr, &rounds, &totalUs, &maxUs), "echo"));
+  for (auto& thr : clients)
+  {
+    thr->start();
+  }
+
+  Timestamp start = Timestamp::now();
+  int64_t startIteration = loop.iteration();
+  loop.runAfter(seconds, [&loop]() { g_stop.getAndSet(1); loop.quit(); });
+  loop.loop();
+  double elapsed = timeDifference(Timestamp::now(), start);
+  int64_t iterations = loop.iteration() - startIteration;
+  // unblocks the flooders
+  loop.runAfter(0.1, [&loop]() { loop.quit(); });
+  loop.loop();
+  for (auto& thr : clients)
+  {
+    thr->join();
+  }
+
+  double mb = static_cast<double>(g_discarded.get()) / (1024 * 1024);
+  printf("%s, %d flooders: %.1f MiB/s, %.2f loop iterations per MiB, "
+         "echo round trip avg %.0f us max %lld us\n",
+         edge ? "edge-triggered" : "level-triggered", numFlooders,
+         mb / elapsed, static_cast<double>(iterations) / mb,
+         rounds > 0 ? static_cast<double>(totalUs) / static_cast<double>(rounds) : 0.0,
+         static_cast<long long>(maxUs));
+}
@@ -1,7 +1,14 @@
+#undef NDEBUG
 #include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/Channel.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/base/ProcessInfo.h>
 #include <muduo/base/Thread.h>
 
+#include <memory>
+#include <vector>
+
+#include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
 
@@ -25,7 +32,6 @@ int main()
   print();
 
   EventLoop loop;
-  loop.runAfter(11, std::bind(&EventLoop::quit, &loop));
 
   {
     printf("Single thread %p:\n", &loop);
@@ -63,6 +69,58 @@ int main()
     assert(nextLoop == model.getNextLoop());
   }
 
-  loop.loop();
+  {
+    printf("Least connections:\n");
+    EventLoopThreadPool model(&loop, "least");
+    model.setThreadNum(3);
+    model.setLoopSelector(EventLoopThreadPool::leastConnections());
+    model.start(init);
+    std::vector<EventLoop*> loops = model.getAllLoops();
+    std::vector<std::unique_ptr<Channel>> channels;
+    channels.emplace_back(new Channel(loops[0], -1));
+    channels.emplace_back(new Channel(loops[0], -1));
+    channels.emplace_back(new Channel(loops[1], -1));
+    assert(model.getNextLoop() == loops[2]);
+    channels.emplace_back(new Channel(loops[2], -1));
+    channels.emplace_back(new Channel(loops[2], -1));
+    assert(model.getNextLoop() == loops[1]);
+    channels.clear();
+    printf("channels %d %d %d\n", loops[0]->numChannels(),
+           loops[1]->numChannels(), loops[2]->numChannels());
+  }
+
+  {
+    printf("Least recently busy:\n");
+    EventLoopThreadPool model(&loop, "busy");
+    model.setThreadNum(2);
+    // samples once, at the first pick
+    model.setLoopSelector(EventLoopThreadPool::leastRecentlyBusy(3600));
+    model.start(init);
+    std::vector<EventLoop*> loops = model.getAllLoops();
+    loops[0]->runInLoop(std::bind(::usleep, 200 * 1000));
+    while (loops[0]->busyMicroSeconds() < 200 * 1000)
+    {
+      ::usleep(10 * 1000);
+    }
+    // two loops, so it always compares both
+    assert(model.getNextLoop() == loops[1]);
+    assert(model.getNextLoop() == loops[1]);
+  }
+
+  {
+    printf("Placement:\n");
+    std::vector<ThreadPlacement> plan = ThreadPlacement::perCpu();
+    EventLoopThreadPool model(&loop, "placed");
+    model.setThreadNum(3);
+    model.setThreadPlacement(plan);
+    int started = 0;  // loops start one after another
+    model.start([&plan, &started](EventLoop*) {
+      std::vector<int> cpus = ProcessInfo::allowedCpus();
+      printf("loop %d on cpu %d\n", started, cpus.empty() ? -1 : cpus[0]);
+      assert(cpus == plan[started % plan.size()].cpus);
+      ++started;
+    });
+    assert(started == 3);
+  }
 }
 
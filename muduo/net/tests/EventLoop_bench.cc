@@ -0,0 +1,196 @@
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/SocketsOps.h>
+#include <muduo/net/TcpServer.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Measures cross thread EventLoop::queueInLoop() throughput:
+// each producer thread posts functors to the loops round-robin.
+// Then counts heap allocations per TcpConnection::send() from another thread.
+
+std::atomic<int64_t> g_allocations(0);
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  free(p);
+}
+
+int64_t g_counts[64];  // modified in loop threads only
+
+void count(int loop)
+{
+  ++g_counts[loop];
+}
+
+void benchPost(int numProducers, int numLoops, int postsPerProducer)
+{
+  EventLoop baseLoop;
+  EventLoopThreadPool pool(&baseLoop, "bench");
+  pool.setThreadNum(numLoops);
+  pool.start();
+  std::vector<EventLoop*> loops = pool.getAllLoops();
+  std::vector<int64_t> iterations;
+  for (EventLoop* loop : loops)
+  {
+    iterations.push_back(loop->iteration());
+  }
+
+  CountDownLatch start(1);
+  CountDownLatch done(numProducers * numLoops);
+  std::vector<std::unique_ptr<Thread>> producers;
+  for (int i = 0; i < numProducers; ++i)
+  {
+    producers.emplace_back(new Thread([&] {
+      start.wait();
+      for (int j = 0; j < postsPerProducer; ++j)
+      {
+        int idx = j % numLoops;
+        loops[idx]->queueInLoop(std::bind(count, idx));
+      }
+      for (EventLoop* loop : loops)
+      {
+        loop->queueInLoop(std::bind(&CountDownLatch::countDown, &done));
+      }
+    }));
+    producers.back()->start();
+  }
+
+  int64_t allocations = g_allocations.load();
+  Timestamp begin(Timestamp::now());
+  start.countDown();
+  done.wait();
+  double seconds = timeDifference(Timestamp::now(), begin);
+  allocations = g_allocations.load() - allocations;
+  for (auto& thr : producers)
+  {
+    thr->join();
+  }
+
+  int64_t total = static_cast<int64_t>(numProducers) * postsPerProducer;
+  int64_t wakeups = 0;
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    wakeups += loops[i]->iteration() - iterations[i];
+  }
+  printf("%d producers, %d loops: %lld posts in %.3f s, %.2f M posts/s, "
+         "%lld loop iterations, %.2f allocations per post\n",
+         numProducers, numLoops, static_cast<long long>(total), seconds,
+         static_cast<double>(total) / seconds / 1e6,
+         static_cast<long long>(wakeups),
+         static_cast<double>(allocations) / static_cast<double>(total));
+}
+
+void benchSend(int numSends)
+{
+  const int kBurst = 100;
+  EventLoop loop;
+  InetAddress serverAddr("127.0.0.1", 2222);
+  TcpServer server(&loop, serverAddr, "SendBench");
+  TcpConnectionPtr connection;
+  CountDownLatch connected(1);
+  server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->connected())
+    {
+      connection = conn;
+      connected.countDown();
+    }
+  });
+  server.start();
+
+  int client = sockets::createNonblockingOrDie(AF_INET);
+  sockets::connect(client, serverAddr.getSockAddr());
+  Thread reader([client] {
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(client, buf, sizeof buf)) != 0)
+    {
+      if (n < 0)
+      {
+        usleep(100);
+      }
+    }
+  });
+  reader.start();
+
+  Thread sender([&] {
+    connected.wait();
+    const string message(100, 'x');
+    int64_t allocations = g_allocations.load();
+    Timestamp begin(Timestamp::now());
+    for (int i = 0; i < numSends; ++i)
+    {
+      string copy(message);  // one allocation, what a caller owns anyway
+      connection->send(std::move(copy));
+      if (i % kBurst == kBurst - 1)
+      {
+        // like a request-response server, the loop keeps up with senders
+        CountDownLatch drained(1);
+        loop.runInLoop(std::bind(&CountDownLatch::countDown, &drained));
+        drained.wait();
+      }
+    }
+    loop.runInLoop([&, allocations, begin] {
+      double seconds = timeDifference(Timestamp::now(), begin);
+      double perSend = static_cast<double>(g_allocations.load() - allocations - numSends) / numSends;
+      printf("cross thread send: %d sends in %.3f s, %.2f allocations per send\n",
+             numSends, seconds, perSend);
+      connection->shutdown();
+      connection.reset();
+      loop.quit();
+    });
+  });
+  sender.start();
+
+  loop.loop();
+  sender.join();
+  reader.join();
+  ::close(client);
+}
+
+int main(int argc, char* argv[])
+{
+  int numProducers = argc > 1 ? atoi(argv[1]) : 16;
+  int numLoops = argc > 2 ? atoi(argv[2]) : 4;
+  int postsPerProducer = argc > 3 ? atoi(argv[3]) : 1000 * 1000;
+  if (numLoops < 1 || numLoops > 64)
+  {
+    fprintf(stderr, "Usage: %s [producers] [loops(1-64)] [posts_per_producer]\n", argv[0]);
+    return 1;
+  }
+
+  Logger::setLogLevel(Logger::WARN);
+  benchPost(numProducers, numLoops, postsPerProducer);
+  benchSend(postsPerProducer);
+}
@@ -0,0 +1,216 @@
+#undef NDEBUG
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/ProcessInfo.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Loopback tests of the output path, also run with MUDUO_USE_IOURING.
+
+namespace
+{
+
+const size_t kTotal = 8 * 1024 * 1024;
+
+char patternAt(size_t i)
+{
+  return static_cast<char>((i * 2654435761u) >> 13);
+}
+
+int connectTo(const InetAddress& addr)
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  assert(sockfd >= 0);
+  int ret = ::connect(sockfd, addr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in)));
+  assert(ret == 0); (void)ret;
+  return sockfd;
+}
+
+}  // namespace
+
+// The server echoes what it receives with send(StringPiece), send(shared_ptr)
+// and sendFile() in turn, pieces of odd sizes, some of the blocks large
+// enough for MSG_ZEROCOPY.  The client starts reading late, so most of it
+// is queued, and must get back exactly what it sent.
+void testSendOrder()
+{
+  EventLoop loop;
+  InetAddress addr(29871, true);
+  TcpServer server(&loop, addr, "order");
+  server.setRecvCompletion(true);
+  server.setZeroCopyThreshold(64 * 1024);
+
+  char path[] = "/tmp/tcpconnection_unittest.XXXXXX";
+  int fileFd = ::mkstemp(path);
+  assert(fileFd >= 0);
+  ::unlink(path);
+  off_t fileOffset = 0;
+  size_t turn = 0;
+  server.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, Timestamp) {
+    while (buf->readableBytes() > 0)
+    {
+      size_t len = std::min(buf->readableBytes(), 1 + turn * 7919 % (256 * 1024));
+      switch (turn++ % 3)
+      {
+        case 0:
+          conn->send(StringPiece(buf->peek(), static_cast<int>(len)));
+          break;
+        case 1:
+          conn->send(std::make_shared<const string>(buf->peek(), len));
+          break;
+        default:
+          {
+            ssize_t n = ::pwrite(fileFd, buf->peek(), len, fileOffset);
+            assert(n == static_cast<ssize_t>(len)); (void)n;
+            conn->sendFile(fileFd, fileOffset, len);
+            fileOffset += static_cast<off_t>(len);
+          }
+      }
+      buf->retrieve(len);
+    }
+  });
+  server.start();
+
+  bool ok = false;
+  Thread client([&]() {
+    int sockfd = connectTo(addr);
+    Thread writer([sockfd]() {
+      string data(64 * 1024, '\0');
+      for (size_t sent = 0; sent < kTotal; )
+      {
+        size_t len = std::min(data.size(), kTotal - sent);
+        for (size_t i = 0; i < len; ++i)
+        {
+          data[i] = patternAt(sent + i);
+        }
+        ssize_t n = ::write(sockfd, data.data(), len);
+        assert(n > 0);
+        sent += static_cast<size_t>(n);
+      }
+    }, "writer");
+    writer.start();
+    ::usleep(100 * 1000);
+
+    size_t received = 0;
+    char buf[65536];
+    ok = true;
+    while (received < kTotal)
+    {
+      ssize_t n = ::read(sockfd, buf, sizeof buf);
+      assert(n > 0);
+      for (ssize_t i = 0; i < n && ok; ++i)
+      {
+        if (buf[i] != patternAt(received + i))
+        {
+          printf("WRONG: byte %zu differs\n", received + i);
+          ok = false;
+        }
+      }
+      received += static_cast<size_t>(n);
+    }
+    writer.join();
+    ::close(sockfd);
+    loop.queueInLoop([&loop] { loop.quit(); });
+  }, "client");
+  client.start();
+  loop.loop();
+  client.join();
+  ::close(fileFd);
+  printf("send order: %zu pieces, %s\n", turn, ok ? "ok" : "WRONG");
+  if (!ok)
+  {
+    exit(1);
+  }
+}
+
+// forceClose() with MSG_ZEROCOPY blocks the peer has not taken: the blocks
+// stay alive while the kernel may read them, and go with the dup of the
+// socket once the peer closes.
+void testForceCloseZeroCopy()
+{
+  const int openedFiles = ProcessInfo::openedFiles();
+  std::vector<std::weak_ptr<const string>> blocks;
+  size_t pending = 0;
+  int alive = 0;
+  {
+    EventLoop loop;
+    InetAddress addr(29872, true);
+    TcpServer server(&loop, addr, "zerocopy");
+    server.setZeroCopyThreshold(64 * 1024);
+    server.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+      if (conn->connected())
+      {
+        for (int i = 0; i < 4; ++i)
+        {
+          std::shared_ptr<const string> block(new string(4 * 1024 * 1024, 'z'));
+          blocks.push_back(block);
+          conn->send(block);
+        }
+        loop.runAfter(0.2, [conn, &pending] {
+          pending = conn->zeroCopyPendingBlocks();
+          conn->forceClose();
+        });
+      }
+    });
+    server.start();
+
+    Thread client([addr]() {
+      int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      int rcvbuf = 4096;
+      ::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+      int ret = ::connect(sockfd, addr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in)));
+      assert(ret == 0); (void)ret;
+      ::usleep(500 * 1000);
+      ::close(sockfd);  // unread, resets the connection
+    }, "client");
+    client.start();
+
+    loop.runEvery(0.05, [&] {
+      alive = 0;
+      for (const auto& block : blocks)
+      {
+        alive += !block.expired();
+      }
+      if (!blocks.empty() && alive == 0)
+      {
+        loop.quit();
+      }
+    });
+    loop.runAfter(5.0, [&loop] { loop.quit(); });
+    loop.loop();
+    client.join();
+  }
+  printf("forceClose with %zu zerocopy blocks pending, %d left\n", pending, alive);
+  if (blocks.size() != 4 || alive != 0)
+  {
+    printf("WRONG: zerocopy blocks not released\n");
+    exit(1);
+  }
+  if (ProcessInfo::openedFiles() != openedFiles)
+  {
+    printf("WRONG: %d files open, %d before\n", ProcessInfo::openedFiles(), openedFiles);
+    exit(1);
+  }
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::WARN);
+  testSendOrder();
+  testForceCloseZeroCopy();
+}
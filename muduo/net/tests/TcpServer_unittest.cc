@@ -0,0 +1,96 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/ProcessInfo.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+
+#include <atomic>
+#include <memory>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Destroys TcpServers while a client keeps connecting and closing, so the
+// I/O loops have connections, and batches of accepted ones, in flight.
+
+void testDestroyWhileConnecting(TcpServer::Option option, bool placement)
+{
+  const int openedFiles = ProcessInfo::openedFiles();
+  InetAddress addr(29873, true);
+  std::atomic<bool> stop(false);
+  Thread client([&]() {
+    while (!stop)
+    {
+      int sockfds[16];
+      for (int& sockfd : sockfds)
+      {
+        sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        ::connect(sockfd, addr.getSockAddr(), static_cast<socklen_t>(sizeof(struct sockaddr_in)));
+      }
+      ::usleep(1000);
+      for (int sockfd : sockfds)
+      {
+        ::close(sockfd);
+      }
+    }
+  }, "client");
+  client.start();
+
+  std::atomic<int> connections(0);
+  {
+    EventLoop loop;
+    for (int round = 0; round < 30; ++round)
+    {
+      std::unique_ptr<TcpServer> server(new TcpServer(&loop, addr, "destroy", option));
+      server->setThreadNum(4);
+      if (placement)
+      {
+        server->setThreadPlacement(ThreadPlacement::perCpu());
+        server->setAcceptBudget(16);
+      }
+      server->setConnectionCallback([&connections](const TcpConnectionPtr& conn) {
+        if (conn->connected())
+        {
+          // some close themselves, queued behind their destruction
+          if (++connections % 2 == 0)
+          {
+            conn->forceClose();
+          }
+        }
+      });
+      server->start();
+      loop.runAfter(0.02, [&] {
+        loop.queueInLoop([&] {
+          server.reset();
+          loop.quit();
+        });
+      });
+      loop.loop();
+    }
+  }
+  stop = true;
+  client.join();
+
+  printf("option %d%s: %d connections\n", option,
+         placement ? " placed" : "", connections.load());
+  if (ProcessInfo::openedFiles() != openedFiles)
+  {
+    printf("WRONG: %d files open, %d before\n", ProcessInfo::openedFiles(), openedFiles);
+    exit(1);
+  }
+}
+
+int main()
+{
+  Logger::setLogLevel(Logger::ERROR);
+  testDestroyWhileConnecting(TcpServer::kReusePort, false);
+  testDestroyWhileConnecting(TcpServer::kReusePort, true);
+  testDestroyWhileConnecting(TcpServer::kReusePortPerLoop, true);
+}
@@ -0,0 +1,100 @@
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/Timestamp.h>
+
+#include <random>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Adds N timers due in 1 to 2 seconds, cancels half of them, and lets the
+// rest fire, with the default set based TimerQueue or with a timing wheel,
+// optionally with slack, which cuts the loop iterations.
+//
+// Usage: timerqueue_bench [num_timers] [set|wheel] [slack_seconds]
+
+int g_remaining = 0;
+int64_t g_maxLateUs = 0;
+EventLoop* g_loop = NULL;
+
+double cpuSeconds()
+{
+  struct rusage usage;
+  ::getrusage(RUSAGE_THREAD, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+      + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void onTimer(Timestamp when)
+{
+  int64_t late = Timestamp::now().microSecondsSinceEpoch() - when.microSecondsSinceEpoch();
+  if (late > g_maxLateUs)
+  {
+    g_maxLateUs = late;
+  }
+  if (--g_remaining == 0)
+  {
+    g_loop->quit();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int numTimers = argc > 1 ? atoi(argv[1]) : 1000 * 1000;
+  bool wheel = argc > 2 && strcmp(argv[2], "wheel") == 0;
+  double slack = argc > 3 ? atof(argv[3]) : 0.0;
+
+  EventLoop loop;
+  g_loop = &loop;
+  if (wheel)
+  {
+    loop.useTimingWheel(0.001);
+  }
+
+  std::mt19937 rng(42);
+  std::vector<Timestamp> whens;
+  whens.reserve(numTimers);
+  Timestamp base(addTime(Timestamp::now(), 1.0));
+  for (int i = 0; i < numTimers; ++i)
+  {
+    whens.push_back(Timestamp(base.microSecondsSinceEpoch() + rng() % 1000000));
+  }
+  std::vector<TimerId> ids;
+  ids.reserve(numTimers);
+
+  double start = cpuSeconds();
+  for (int i = 0; i < numTimers; ++i)
+  {
+    if (slack > 0.0)
+    {
+      double delay = timeDifference(whens[i], Timestamp::now());
+      ids.push_back(loop.runAfter(delay, slack, std::bind(onTimer, whens[i])));
+    }
+    else
+    {
+      ids.push_back(loop.runAt(whens[i], std::bind(onTimer, whens[i])));
+    }
+  }
+  double added = cpuSeconds();
+  for (int i = 0; i < numTimers; i += 2)
+  {
+    loop.cancel(ids[i]);
+  }
+  double cancelled = cpuSeconds();
+  g_remaining = numTimers / 2;
+
+  loop.loop();
+  double fired = cpuSeconds();
+
+  printf("%s, slack %g, %d timers: add %.3f s, cancel half %.3f s, fire rest %.3f s cpu, "
+         "%lld loop iterations, max late %lld us\n",
+         wheel ? "wheel" : "set", slack, numTimers,
+         added - start, cancelled - added, fired - cancelled,
+         static_cast<long long>(loop.iteration()),
+         static_cast<long long>(g_maxLateUs));
+}
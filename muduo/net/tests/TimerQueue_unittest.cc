@@ -2,7 +2,10 @@
 #include <muduo/net/EventLoopThread.h>
 #include <muduo/base/Thread.h>
 
+#include <atomic>
+
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 using namespace muduo;
@@ -32,6 +35,47 @@ void cancel(TimerId timer)
   printf("cancelled at %s\n", Timestamp::now().toString().c_str());
 }
 
+// One thread cancels the timers it adds, which mostly fired already, while
+// another adds timers it never cancels.  A TimerId with the sequence of
+// another timer would cancel one of the latter.
+void testCrossThreadCancel(bool wheel)
+{
+  const int kTimers = 100000;
+  std::atomic<int> fired(0);
+  EventLoopThread loopThread;
+  EventLoop* loop = loopThread.startLoop();
+  if (wheel)
+  {
+    loop->runInLoop(std::bind(&EventLoop::useTimingWheel, loop, 0.001));
+  }
+  Thread canceller([loop]() {
+    for (int i = 0; i < kTimers; ++i)
+    {
+      loop->cancel(loop->runAfter(0, [] { }));
+    }
+  }, "canceller");
+  Thread adder([loop, &fired]() {
+    for (int i = 0; i < kTimers; ++i)
+    {
+      loop->runAfter(0, [&fired] { ++fired; });
+    }
+  }, "adder");
+  canceller.start();
+  adder.start();
+  canceller.join();
+  adder.join();
+  for (int i = 0; i < 500 && fired < kTimers; ++i)
+  {
+    usleep(10 * 1000);
+  }
+  printf("%s: %d of %d timers fired\n", wheel ? "wheel" : "sets", fired.load(), kTimers);
+  if (fired != kTimers)
+  {
+    printf("WRONG: a timer was cancelled by another's TimerId\n");
+    exit(1);
+  }
+}
+
 int main()
 {
   printTid();
@@ -63,4 +107,6 @@ int main()
     sleep(3);
     print("thread loop exits");
   }
+  testCrossThreadCancel(false);
+  testCrossThreadCancel(true);
 }
@@ -0,0 +1,126 @@
+#undef NDEBUG
+#include <muduo/net/TimingWheel.h>
+#include <muduo/net/Timer.h>
+
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// Drives a TimingWheel with simulated time and checks that every timer is
+// taken at the first step at or after its expiration, within one tick.
+
+const int64_t kTick = 1000;  // 1ms
+
+int main()
+{
+  std::mt19937_64 rng(42);
+  const int64_t start = 1000000000LL * Timestamp::kMicroSecondsPerSecond + 123;
+  int64_t now = start;
+  TimingWheel wheel(kTick, Timestamp(now));
+  std::map<int64_t, Timer*> pending;  // by sequence
+  std::set<std::pair<int64_t, int64_t>> byExpiration;  // (when, sequence)
+
+  auto addTimers = [&](int count, int64_t maxDelay) {
+    for (int i = 0; i < count; ++i)
+    {
+      int64_t delay = static_cast<int64_t>(rng() % static_cast<uint64_t>(maxDelay));
+      Timer* timer = new Timer(InplaceFunction<void ()>(), Timestamp(now + delay), 0.0);
+      wheel.insert(timer);
+      pending[timer->sequence()] = timer;
+      byExpiration.insert(std::make_pair(now + delay, timer->sequence()));
+    }
+  };
+
+  // 1 second to 20 days, the latter are beyond the range of 5 levels
+  addTimers(10000, 1000 * 1000);
+  addTimers(10000, 3600LL * 1000 * 1000);
+  addTimers(1000, 20LL * 86400 * 1000 * 1000);
+  assert(wheel.size() == pending.size());
+
+  // cancel every 7th
+  for (auto it = pending.begin(); it != pending.end(); )
+  {
+    if (it->first % 7 == 0)
+    {
+      bool erased = wheel.erase(it->second, it->first);
+      assert(erased); (void)erased;
+      assert(!wheel.erase(it->second, it->first + 1));
+      byExpiration.erase(std::make_pair(it->second->expiration().microSecondsSinceEpoch(), it->first));
+      delete it->second;
+      it = pending.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  assert(wheel.size() == pending.size());
+
+  int64_t fired = 0;
+  int steps = 0;
+  std::vector<Timer*> expired;
+  while (!pending.empty())
+  {
+    Timestamp next = wheel.nextExpiration();
+    assert(next.valid());
+    assert(next.microSecondsSinceEpoch() > now - kTick);
+    int64_t earliest = byExpiration.begin()->first;
+    // never sleeps past a due timer
+    assert(next.microSecondsSinceEpoch() <= earliest + kTick);
+
+    // steps of random length, sometimes straight to the next expiration
+    int64_t step = static_cast<int64_t>(rng() % 3 == 0
+        ? rng() % static_cast<uint64_t>(30 * kTick)
+        : rng() % static_cast<uint64_t>(100LL * 1000 * 1000));
+    int64_t previous = now;
+    now = std::max(now + 1, std::min(now + step, next.microSecondsSinceEpoch()));
+    if (++steps < 10000 && rng() % 5 == 0)
+    {
+      addTimers(10, 2 * 1000 * 1000);  // keeps adding for a while
+    }
+
+    expired.clear();
+    wheel.takeExpired(Timestamp(now), &expired);
+    for (Timer* timer : expired)
+    {
+      int64_t when = timer->expiration().microSecondsSinceEpoch();
+      assert(when <= now);
+      assert(when + kTick > previous);  // not late by a step
+      size_t n = pending.erase(timer->sequence());
+      assert(n == 1); (void)n;
+      byExpiration.erase(std::make_pair(when, timer->sequence()));
+      delete timer;
+      ++fired;
+    }
+    // nothing due is left behind
+    assert(byExpiration.empty() || byExpiration.begin()->first > now - kTick);
+    assert(wheel.size() == pending.size());
+    assert(byExpiration.size() == pending.size());
+  }
+  assert(!wheel.nextExpiration().valid());
+
+  // a stale sequence misses a timer taken out, and the same one reused
+  {
+    Timer timer(InplaceFunction<void ()>(), Timestamp(now + kTick), 0.0);
+    int64_t stale = timer.sequence();
+    wheel.insert(&timer);
+    std::vector<Timer*> all;
+    wheel.takeAll(&all);
+    assert(all.size() == 1 && wheel.size() == 0);
+    assert(!wheel.erase(&timer, stale));
+    timer.reuse(InplaceFunction<void ()>(), Timestamp(now + kTick), 0.0, 0.0);
+    wheel.insert(&timer);
+    assert(!wheel.erase(&timer, stale));
+    assert(wheel.erase(&timer, timer.sequence()));
+    assert(wheel.size() == 0);
+  }
+  printf("%lld timers fired over %.1f days\n", static_cast<long long>(fired),
+         static_cast<double>(now - start) / 86400e6);
+}